@@ -0,0 +1,235 @@
+#include "b-plus-tree/tree.hpp"
+#include "b-plus-tree/utility.hpp"
+#include "definitions.h"
+#include "path-oram/oram.hpp"
+#include "path-oram/utility.hpp"
+#include "utility.hpp"
+
+#include <benchmark/benchmark.h>
+#include <future>
+#include <map>
+#include <random>
+
+using namespace std;
+
+// End-to-end query pipeline (padding, B+ tree, DP noise, ORAMs) over a synthetic dataset on InMemory storage.
+// Each iteration is one query, timed manually; latency percentiles and per-stage means (ns) are reported as counters,
+// throughput as items_per_second. Use --benchmark_format=json (or --benchmark_out) for machine-readable output.
+
+namespace DPORAM
+{
+	const number COUNT			 = 1 << 14;
+	const number QUERIES		 = 200;
+	const number WARMUP_QUERIES	 = 20;
+	const number ORAM_Z			 = 3;
+	const number TREE_BLOCK_SIZE = 3208;
+	const number DP_BETA		 = 20;
+	const double DP_EPSILON		 = 0.693;
+
+	class Pipeline
+	{
+		public:
+		Pipeline(number oramsNumber, number blockSize, number fanout, number selectivity) :
+			oramsNumber(oramsNumber),
+			fanout(fanout)
+		{
+			// salaries are uniform in [0, 100000) dollars, records are "salary,index"
+			mt19937_64 generator(0);
+			vector<vector<pair<number, bytes>>> oramsIndex(oramsNumber);
+			vector<pair<number, bytes>> treeIndex;
+			for (auto i = 0uLL; i < COUNT; i++)
+			{
+				auto text	= to_string(generator() % 100'000) + "." + to_string(generator() % 100);
+				auto salary = salaryToNumber(text);
+
+				minValue = min(minValue, salary);
+				maxValue = max(maxValue, salary);
+
+				auto oramId	 = PathORAM::hashToNumber(BPlusTree::bytesFromNumber(salary), oramsNumber);
+				auto blockId = oramsIndex[oramId].size();
+				oramsIndex[oramId].push_back({blockId, PathORAM::fromText(text + "," + to_string(i), blockSize)});
+				treeIndex.push_back({salary, BPlusTree::concatNumbers(2, oramId, blockId)});
+			}
+
+			auto logCapacity = max((number)ceil(log2(COUNT / oramsNumber / ORAM_Z)) + 1, 1uLL);
+			for (auto&& index : oramsIndex)
+			{
+				blockNumbers.push_back(index.size());
+
+				auto storage = make_shared<PathORAM::InMemoryStorageAdapter>((1 << logCapacity) + ORAM_Z, blockSize, PathORAM::getRandomBlock(KEYSIZE), ORAM_Z);
+				auto map	 = make_shared<PathORAM::InMemoryPositionMapAdapter>(((1 << logCapacity) * ORAM_Z) + ORAM_Z);
+				auto stash	 = make_shared<PathORAM::InMemoryStashAdapter>(3 * logCapacity * ORAM_Z);
+				auto oram	 = make_shared<PathORAM::ORAM>(logCapacity, blockSize, ORAM_Z, storage, map, stash, true, ULONG_MAX);
+				oram->load(index);
+				orams.push_back(oram);
+			}
+
+			tree = make_shared<BPlusTree::Tree>(make_shared<BPlusTree::InMemoryStorageAdapter>(TREE_BLOCK_SIZE), treeIndex);
+
+			// DP parameters as main chooses them, for the Gamma method (a single noise tree)
+			auto domain = (maxValue - minValue) / 100;
+			auto range	= max(domain * selectivity / 100, 1uLL);
+			buckets		= 1;
+			while (buckets * fanout <= domain)
+			{
+				buckets *= fanout;
+			}
+			auto maxBuckets = (range * buckets + domain - 1) / domain;
+			levels			= max((number)ceil(log(maxBuckets) / log(fanout)), 1uLL);
+			auto mu			= optimalMu(1.0 / (1 << DP_BETA), fanout, buckets, DP_EPSILON, levels, 1);
+
+			auto atLevel = buckets;
+			for (auto l = 0uLL; l < levels; l++)
+			{
+				for (auto j = 0uLL; j < atLevel; j++)
+				{
+					noise[{l, j}] = (int)sampleLaplace(mu, levels / DP_EPSILON);
+				}
+				atLevel /= fanout;
+			}
+
+			// queries of the given width (in dollars) at uniformly random positions
+			for (auto i = 0uLL; i < QUERIES + WARMUP_QUERIES; i++)
+			{
+				auto from = minValue + generator() % max(maxValue - minValue - range * 100, 1uLL);
+				queries.push_back({from, from + range * 100});
+			}
+		}
+
+		// runs the query, adds the time of each stage and returns the number of matching records
+		number query(pair<number, number> query, vector<number>& stages)
+		{
+			auto stage = [&stages](number i, chrono::steady_clock::time_point& since) {
+				auto now = chrono::steady_clock::now();
+				stages[i] += chrono::duration_cast<chrono::nanoseconds>(now - since).count();
+				since = now;
+			};
+			auto since = chrono::steady_clock::now();
+
+			auto [fromBucket, toBucket, from, to] = padToBuckets(query, minValue, maxValue, buckets);
+			auto nodes							  = BRC(fanout, fromBucket, toBucket);
+			stage(0, since);
+
+			locators.clear();
+			tree->search(from, to, locators);
+			for (auto&& ids : blockIds)
+			{
+				ids.clear();
+			}
+			blockIds.resize(oramsNumber);
+			for (auto&& locator : locators)
+			{
+				auto fromTree = BPlusTree::deconstructNumbers(locator);
+				blockIds[fromTree[0]].push_back(fromTree[1]);
+			}
+			stage(1, since);
+
+			auto kZeroTilda = (number)locators.size();
+			for (auto&& node : nodes)
+			{
+				auto found = noise.find(node);
+				kZeroTilda += found != noise.end() ? found->second : 0;
+			}
+			auto maxRecords = gammaNodes(oramsNumber, 1.0 / (1 << DP_BETA), max(kZeroTilda, 1uLL));
+			for (auto i = 0uLL; i < oramsNumber; i++)
+			{
+				auto extra = blockIds[i].size() < maxRecords ? maxRecords - blockIds[i].size() : 0;
+				addFakeRequests(blockIds[i], blockNumbers[i], extra);
+			}
+			stage(2, since);
+
+			vector<future<number>> results;
+			for (auto i = 0uLL; i < oramsNumber; i++)
+			{
+				results.push_back(async(launch::async, [this, i, query]() {
+					vector<pair<number, bytes>> requests;
+					for (auto&& id : blockIds[i])
+					{
+						requests.emplace_back(id, bytes());
+					}
+					vector<bytes> answer;
+					orams[i]->multiple(requests, answer);
+
+					auto count = 0uLL;
+					for (auto&& record : answer)
+					{
+						auto salary = salaryFromRecord(record);
+						if (salary >= query.first && salary <= query.second)
+						{
+							count++;
+						}
+					}
+					return count;
+				}));
+			}
+			auto count = 0uLL;
+			for (auto&& result : results)
+			{
+				count += result.get();
+			}
+			stage(3, since);
+
+			return count;
+		}
+
+		vector<pair<number, number>> queries;
+
+		private:
+		number oramsNumber;
+		number fanout;
+		number buckets;
+		number levels;
+		number minValue = ULLONG_MAX;
+		number maxValue = 0;
+
+		vector<number> blockNumbers;
+		vector<shared_ptr<PathORAM::ORAM>> orams;
+		shared_ptr<BPlusTree::Tree> tree;
+		map<pair<number, number>, number> noise;
+
+		vector<bytes> locators;
+		vector<vector<number>> blockIds;
+	};
+
+	// ORAMs, record size, fanout, selectivity (% of domain)
+	static void BM_EndToEnd(benchmark::State& state)
+	{
+		Pipeline pipeline(state.range(0), state.range(1), state.range(2), state.range(3));
+
+		vector<number> stages(4, 0);
+		for (auto i = 0uLL; i < WARMUP_QUERIES; i++)
+		{
+			pipeline.query(pipeline.queries[i], stages);
+		}
+		fill(stages.begin(), stages.end(), 0);
+
+		vector<number> latencies;
+		auto records = 0uLL;
+		auto next	 = WARMUP_QUERIES;
+		for (auto _ : state)
+		{
+			auto start = chrono::steady_clock::now();
+			records += pipeline.query(pipeline.queries[next], stages);
+			auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+			latencies.push_back(elapsed);
+			state.SetIterationTime(elapsed / 1e9);
+			next = next + 1 < pipeline.queries.size() ? next + 1 : WARMUP_QUERIES;
+		}
+
+		state.SetItemsProcessed(state.iterations());
+		state.counters["p50"]	  = percentile(latencies, 50);
+		state.counters["p90"]	  = percentile(latencies, 90);
+		state.counters["p99"]	  = percentile(latencies, 99);
+		state.counters["records"] = benchmark::Counter(records, benchmark::Counter::kAvgIterations);
+
+		vector<string> names = {"pad", "tree", "noise", "orams"};
+		for (auto i = 0uLL; i < names.size(); i++)
+		{
+			state.counters[names[i]] = benchmark::Counter(stages[i], benchmark::Counter::kAvgIterations);
+		}
+	}
+	BENCHMARK(BM_EndToEnd)->ArgsProduct({{1, 4, 16}, {256, 4096}, {4, 16}, {1, 5}})->Iterations(QUERIES)->UseManualTime()->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK_MAIN();
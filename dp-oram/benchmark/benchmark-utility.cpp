@@ -0,0 +1,139 @@
+#include "definitions.h"
+#include "path-oram/utility.hpp"
+#include "utility.hpp"
+
+#include <benchmark/benchmark.h>
+#include <numeric>
+
+using namespace std;
+
+namespace DPORAM
+{
+	// range of width percents of the domain, starting at a fixed offset
+	pair<number, number> range(number domain, number percents)
+	{
+		auto width = max(domain * percents / 100, 1uLL);
+		auto from  = (domain - width) / 3;
+		return {from, from + width - 1};
+	}
+
+	// fanout, buckets, range width (% of buckets)
+	static void BM_BRC(benchmark::State& state)
+	{
+		auto [from, to] = range(state.range(1), state.range(2));
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(BRC(state.range(0), from, to));
+		}
+	}
+	BENCHMARK(BM_BRC)->ArgsProduct({{2, 4, 16, 64}, {1 << 10, 1 << 16, 1 << 20}, {1, 10, 50}});
+
+	// buckets, range width (% of domain)
+	static void BM_PadToBuckets(benchmark::State& state)
+	{
+		const number MIN = 100, MAX = 100'000'000;
+		auto [from, to]	 = range(MAX - MIN, state.range(1));
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(padToBuckets({MIN + from, MIN + to}, MIN, MAX, state.range(0)));
+		}
+	}
+	BENCHMARK(BM_PadToBuckets)->ArgsProduct({{1 << 10, 1 << 16, 1 << 20}, {1, 10, 50}});
+
+	// fanout, buckets, ORAMs
+	static void BM_OptimalMu(benchmark::State& state)
+	{
+		auto levels = (number)ceil(log(state.range(1)) / log(state.range(0)));
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(optimalMu(1.0 / (1 << 20), state.range(0), state.range(1), 0.693, levels, state.range(2)));
+		}
+	}
+	BENCHMARK(BM_OptimalMu)->ArgsProduct({{2, 16, 64}, {1 << 10, 1 << 20}, {1, 64}});
+
+	// ORAMs, real records
+	static void BM_GammaNodes(benchmark::State& state)
+	{
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(gammaNodes(state.range(0), 1.0 / (1 << 20), state.range(1)));
+		}
+	}
+	BENCHMARK(BM_GammaNodes)->ArgsProduct({{1, 16, 64}, {10, 10'000}});
+
+	static void BM_SampleLaplace(benchmark::State& state)
+	{
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(sampleLaplace(100, 20 / 0.693));
+		}
+	}
+	BENCHMARK(BM_SampleLaplace);
+
+	static void BM_SalaryToNumber(benchmark::State& state)
+	{
+		string salary = "123456.78";
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(salaryToNumber(salary));
+		}
+	}
+	BENCHMARK(BM_SalaryToNumber);
+
+	// blocks in partition, real blocks (% of partition), fake blocks (% of partition)
+	static void BM_AddFakeRequests(benchmark::State& state)
+	{
+		number blocks = state.range(0);
+
+		srand(0);
+		vector<number> real(blocks * state.range(1) / 100);
+		generate(real.begin(), real.end(), [blocks]() { return rand() % blocks; });
+		auto fakes = blocks * state.range(2) / 100;
+
+		vector<number> requests;
+		for (auto _ : state)
+		{
+			requests = real;
+			addFakeRequests(requests, blocks, fakes);
+			benchmark::DoNotOptimize(requests.data());
+		}
+		state.SetItemsProcessed(state.iterations() * (real.size() + fakes));
+	}
+	BENCHMARK(BM_AddFakeRequests)->ArgsProduct({{1 << 10, 1 << 16}, {1, 10}, {1, 10}});
+
+	// records, record size, range width (% of domain); the step applied to every block an ORAM returns
+	static void BM_ParseAndFilter(benchmark::State& state)
+	{
+		srand(0);
+		vector<bytes> records(state.range(0));
+		for (auto&& record : records)
+		{
+			record = PathORAM::fromText(to_string(rand() % 100'000) + "." + to_string(rand() % 100) + ",row", state.range(1));
+		}
+
+		const number MIN = salaryToNumber("0"), MAX = salaryToNumber("100000");
+		auto [from, to]	 = range(MAX - MIN, state.range(2));
+
+		for (auto _ : state)
+		{
+			auto count = 0uLL;
+			for (auto&& record : records)
+			{
+				auto salary = salaryFromRecord(record);
+				if (salary >= MIN + from && salary <= MIN + to)
+				{
+					count++;
+				}
+			}
+			benchmark::DoNotOptimize(count);
+		}
+		state.SetItemsProcessed(state.iterations() * records.size());
+	}
+	BENCHMARK(BM_ParseAndFilter)->ArgsProduct({{1000, 100'000}, {256, 4096}, {1, 50}});
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "definitions.h"
+#include "snapshot.hpp"
+
+#include <condition_variable>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	/**
+	 * @brief What changed in one ORAM client state between two checkpoints
+	 *
+	 * Applied in order: positions are set, removed blocks leave the stash, stashed blocks are added or updated.
+	 */
+	struct oramDelta
+	{
+		vector<pair<number, number>> positions;
+		vector<number> removed;
+		vector<pair<number, bytes>> stashed;
+	};
+
+	/**
+	 * @brief Computes deltas of an ORAM client state, starting from the state at construction
+	 *
+	 * Position map changes are recorded by the map itself, the (small) stash is compared by block checksums.
+	 * Must not be used while the ORAM is being accessed.
+	 */
+	class StateTracker
+	{
+		public:
+		StateTracker(shared_ptr<SnapshotPositionMapAdapter> positionMap, shared_ptr<PathORAM::AbsStashAdapter> stash);
+
+		/**
+		 * @brief the delta since the previous call (or construction)
+		 */
+		oramDelta changes();
+
+		private:
+		shared_ptr<SnapshotPositionMapAdapter> positionMap;
+		shared_ptr<PathORAM::AbsStashAdapter> stash;
+
+		// block ID -> checksum of the block as of the previous call
+		map<number, number> stashed;
+	};
+
+	/**
+	 * @brief apply the delta to the position map and stash of an ORAM
+	 */
+	void applyDelta(const oramDelta& delta, const shared_ptr<PathORAM::AbsPositionMapAdapter>& positionMap, const shared_ptr<PathORAM::AbsStashAdapter>& stash);
+
+	/**
+	 * @brief Append-only journal of checkpoints on top of a snapshot, written by a background thread
+	 *
+	 * Each checkpoint is one record (of all ORAMs that changed) with a checksum, synced to disk when written.
+	 * The journal is truncated on construction and tied to the snapshot generation,
+	 * so that it is never replayed on top of a different snapshot.
+	 */
+	class CheckpointJournal
+	{
+		public:
+		CheckpointJournal(const string& path, number generation, number blockSize);
+
+		/**
+		 * @brief write out everything submitted and stop the writer
+		 */
+		~CheckpointJournal();
+
+		CheckpointJournal(const CheckpointJournal&) = delete;
+		CheckpointJournal& operator=(const CheckpointJournal&) = delete;
+
+		/**
+		 * @brief queue a checkpoint of pair<ORAM ID, delta>, returns immediately
+		 */
+		void submit(vector<pair<number, oramDelta>> deltas);
+
+		/**
+		 * @brief block until every submitted checkpoint is on disk, rethrows a write failure
+		 */
+		void flush();
+
+		/**
+		 * @brief the number of checkpoints written to disk so far
+		 */
+		number written();
+
+		private:
+		int descriptor;
+		number generation;
+		number blockSize;
+
+		mutex stateMutex;
+		condition_variable wakeUp;
+		condition_variable done;
+		vector<vector<pair<number, oramDelta>>> queue;
+		bool stopping	 = false;
+		number submitted = 0;
+		number completed = 0;
+		string failure;
+
+		thread worker;
+
+		void run();
+	};
+
+	/**
+	 * @brief read the journal written on top of the snapshot of the given generation
+	 *
+	 * Returns the deltas of each ORAM in checkpoint order.
+	 * Reading stops at the first torn or corrupted record (e.g. the process crashed mid-write).
+	 * A missing journal, or a journal of another generation, yields no deltas.
+	 */
+	map<number, vector<oramDelta>> readJournal(const string& path, number generation, number blockSize);
+}
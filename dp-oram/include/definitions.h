@@ -144,11 +144,36 @@ namespace DPORAM
 
 	PROGRAM_OPTIONS_ENUM(
 		QUERY_MULTIPLE_T,
-		QFirst COMMA QSecond COMMA QMultiple,
-		L"First" COMMA L"Second" COMMA L"Multiple")
+		QFirst COMMA QSecond COMMA QMultiple COMMA QBoth,
+		L"First" COMMA L"Second" COMMA L"Multiple" COMMA L"Both")
 
 	PROGRAM_OPTIONS_ENUM(
 		ORAM_BACKEND,
 		InMemory COMMA FileSystem COMMA Redis,
 		L"InMemory" COMMA L"FileSystem" COMMA L"Redis")
+
+	PROGRAM_OPTIONS_ENUM(
+		VALUE_DISTRIBUTION,
+		Uniform COMMA Normal COMMA Zipf COMMA Duplicates,
+		L"Uniform" COMMA L"Normal" COMMA L"Zipf" COMMA L"Duplicates")
+
+	PROGRAM_OPTIONS_ENUM(
+		TUNING_OBJECTIVE,
+		Latency COMMA Bandwidth,
+		L"Latency" COMMA L"Bandwidth")
+
+	PROGRAM_OPTIONS_ENUM(
+		COLUMN_ENCODING,
+		Decimal COMMA Integer COMMA Text,
+		L"Decimal" COMMA L"Integer" COMMA L"Text")
+
+	PROGRAM_OPTIONS_ENUM(
+		AGGREGATE_FUNCTION,
+		ANone COMMA ACount COMMA ASum COMMA AMin COMMA AMax COMMA AAvg,
+		L"None" COMMA L"Count" COMMA L"Sum" COMMA L"Min" COMMA L"Max" COMMA L"Avg")
+
+	PROGRAM_OPTIONS_ENUM(
+		PARTITION_STRATEGY,
+		PValue COMMA PRecord COMMA PRoundRobin COMMA PBalanced,
+		L"Value" COMMA L"Record" COMMA L"RoundRobin" COMMA L"Balanced")
 }
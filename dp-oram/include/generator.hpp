@@ -0,0 +1,83 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <string>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	/**
+	 * @brief Parameters of a synthetic dataset
+	 *
+	 * Values are salaries in dollars (with cents) within [minValue, maxValue].
+	 * Normal uses mean and deviation, Zipf ranks distinct values by skew (in (0, 1)),
+	 * Duplicates draws uniformly among distinct values.
+	 */
+	struct datasetConfig
+	{
+		VALUE_DISTRIBUTION distribution = Uniform;
+		number count					= 1000;
+		number attributes				= 1;
+		// the length of a record text, filled up after the values (0 for values only)
+		number recordLength = 0;
+
+		double minValue	 = 0;
+		double maxValue	 = 100000;
+		double mean		 = 50000;
+		double deviation = 15000;
+		double skew		 = 0.8;
+		number distinct	 = 1000;
+
+		number seed = 0;
+	};
+
+	/**
+	 * @brief Reproducible synthetic dataset of arbitrary size, generated on demand
+	 *
+	 * Every value is a function of the seed and its position only,
+	 * so records can be generated in any order (and in parallel) without materializing the dataset.
+	 */
+	class DatasetGenerator
+	{
+		public:
+		explicit DatasetGenerator(datasetConfig config);
+
+		number size() const;
+
+		/**
+		 * @brief the attribute of the record, in salaryToNumber representation
+		 */
+		number value(number record, number attribute = 0) const;
+
+		/**
+		 * @brief the comma-separated record: its attributes, the record index and the filler
+		 */
+		string record(number record) const;
+
+		/**
+		 * @brief range queries over the attribute, each matching about selectivity of the records
+		 *
+		 * Query positions are uniform in the value quantiles, except that a hotspot share of the queries
+		 * falls within a hotspot window of hotspotWidth of the quantiles.
+		 * Quantiles are estimated from a sample, so the dataset is not materialized.
+		 */
+		vector<pair<number, number>> queries(number count, double selectivity, double hotspot = 0, double hotspotWidth = 0.1, number attribute = 0) const;
+
+		private:
+		datasetConfig config;
+
+		// normalization constants of the Zipf sampler
+		double zeta		 = 0;
+		double alpha	 = 0;
+		double eta		 = 0;
+		double threshold = 0;
+
+		// uniform in [0, 1) determined by the seed, the position and the stream
+		double uniform(number position, number stream) const;
+
+		// the attribute of the record as text, in dollars with cents
+		string text(number record, number attribute) const;
+	};
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "definitions.h"
+#include "schema.hpp"
+
+#include <functional>
+#include <string>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	/**
+	 * @brief Read-only memory mapping of a whole file
+	 *
+	 * Throws if the file cannot be opened or mapped.
+	 * An empty file is valid and yields a null data pointer and zero size.
+	 */
+	class MappedFile
+	{
+		public:
+		explicit MappedFile(const string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* data() const;
+		number size() const;
+
+		private:
+		int descriptor	   = -1;
+		const char* mapped = nullptr;
+		number length	   = 0;
+	};
+
+	/**
+	 * @brief Per-ORAM records spilled to disk, to be read back in chunks
+	 *
+	 * Records are appended unpadded and length-prefixed to one run file per ORAM.
+	 * Appends are buffered up to bufferBytes in total and then written out,
+	 * so the number of simultaneously open files does not depend on the number of ORAMs.
+	 * Run files are removed on destruction.
+	 */
+	class PartitionRuns
+	{
+		public:
+		PartitionRuns(number orams, function<string(number)> runFile, number bufferBytes = 64uLL << 20);
+		~PartitionRuns();
+
+		PartitionRuns(const PartitionRuns&) = delete;
+		PartitionRuns& operator=(const PartitionRuns&) = delete;
+
+		void append(number oram, bytes record);
+
+		/**
+		 * @brief the number of records appended to the ORAM run so far
+		 */
+		number size(number oram) const;
+
+		/**
+		 * @brief write out the buffered records, must be called before reading
+		 */
+		void seal();
+
+		/**
+		 * @brief read the ORAM run in order, in chunks of at most maxRecords
+		 *
+		 * Records are padded to blockSize and get consecutive block IDs starting from 0,
+		 * the same as the in-memory loader would assign.
+		 * Safe to call concurrently after seal.
+		 */
+		void read(number oram, number blockSize, number maxRecords, function<void(vector<pair<number, bytes>>&)> handler) const;
+
+		private:
+		function<string(number)> runFile;
+		number bufferBytes;
+		number buffered = 0;
+		vector<number> sizes;
+		vector<vector<bytes>> pending;
+
+		void flush();
+	};
+
+	/**
+	 * @brief The dataset partitioned into ORAMs along with the B+ tree indices
+	 *
+	 * oramsIndex[i] holds pair<blockId, padded record> of ORAM i,
+	 * treeIndices[a] holds pair<value, bytes(ORAMid, blockId)> of indexed column a in file order,
+	 * minValues[a] and maxValues[a] are its bounds.
+	 */
+	struct ingestedDataset
+	{
+		vector<vector<pair<number, bytes>>> oramsIndex;
+		vector<vector<pair<number, bytes>>> treeIndices;
+
+		vector<number> minValues;
+		vector<number> maxValues;
+	};
+
+	/**
+	 * @brief split the buffer into at most chunks line-aligned [from, to) ranges
+	 *
+	 * Each range, except possibly the last one, ends right after a newline.
+	 * Empty ranges are not returned.
+	 */
+	vector<pair<number, number>> lineChunks(const char* data, number size, number chunks);
+
+	/**
+	 * @brief read the CSV dataset and partition it into ORAMs
+	 *
+	 * Maps the file into memory, parses and pads line-aligned chunks on threads (0 for all cores),
+	 * and assembles the chunks in file order.
+	 * The result is identical to reading the file line by line on a single thread.
+	 *
+	 * @param path the dataset file
+	 * @param orams the number of ORAMs to partition records into
+	 * @param blockSize the ORAM block size records are padded to
+	 * @param schema the leading fields of the lines, its indexed columns are parsed into tree indices
+	 * @param threads the number of threads to use (0 for hardware concurrency)
+	 */
+	ingestedDataset ingestDataset(const string& path, number orams, number blockSize, const datasetSchema& schema, number threads = 0);
+
+	/**
+	 * @brief read the CSV dataset and spill its ORAM partitions to disk
+	 *
+	 * Same as the in-memory version, except that records are appended to runs instead of oramsIndex,
+	 * and the file is processed in waves of chunks such that a wave takes at most a quarter of budget bytes.
+	 * Only the tree indices are kept in memory.
+	 *
+	 * @param budget the memory budget in bytes
+	 * @param runs the (empty) runs to spill records to, sealed on return
+	 */
+	ingestedDataset ingestDataset(const string& path, number orams, const datasetSchema& schema, number threads, number budget, PartitionRuns& runs);
+
+	/**
+	 * @brief move the records between ORAMs according to the partitioning strategy
+	 *
+	 * Records are identified by their position in treeIndices[0] (file order) and go to
+	 * - PValue: the hash of the first indexed value (as ingestDataset assigns them, so all equal values share an ORAM),
+	 * - PRecord: the hash of the record position,
+	 * - PRoundRobin: the record position modulo the number of ORAMs,
+	 * - PBalanced: groups of equal first indexed values, largest first, to the least loaded ORAM,
+	 *   split where a group overflows the even share of ceil(records / ORAMs).
+	 * Block IDs are consecutive in every ORAM, and the locators of the tree indices are updated accordingly.
+	 */
+	void partitionRecords(vector<vector<pair<number, bytes>>>& oramsIndex, vector<vector<pair<number, bytes>>>& treeIndices, PARTITION_STRATEGY strategy);
+
+	/**
+	 * @brief pack the records of every ORAM into as few blocks as they fit, in the order of the first indexed column
+	 *
+	 * Records are joined by newlines (see nextRecord) and zero-padded to blockSize, as single records are,
+	 * so that the records of a DP bucket tend to share blocks.
+	 * The locators of the tree indices become bytes(ORAMid, blockId, slot).
+	 * Throws if a record does not fit a block with a terminator.
+	 *
+	 * @return the number of records packed
+	 */
+	number packRecords(vector<vector<pair<number, bytes>>>& oramsIndex, vector<vector<pair<number, bytes>>>& treeIndices, number blockSize);
+
+	/**
+	 * @brief move the records into ORAM groups by their length, one group of ORAMs per size class
+	 *
+	 * The ORAMs are split into sizeClasses.size() groups of equal size, group c holds the records
+	 * shorter than sizeClasses[c] (with a terminator) but not than sizeClasses[c - 1], padded to sizeClasses[c].
+	 * A record of ORAM i goes to ORAM i modulo the group size of its class group, with the next block ID there.
+	 * The locators of the tree indices are updated accordingly.
+	 * Throws if a record does not fit the largest class.
+	 *
+	 * @param blockSize the size records are currently padded to
+	 * @return the number of records in each class
+	 */
+	vector<number> assignSizeClasses(vector<vector<pair<number, bytes>>>& oramsIndex, vector<vector<pair<number, bytes>>>& treeIndices, const vector<number>& sizeClasses, number blockSize);
+
+	/**
+	 * @brief the log capacity of the ORAMs of each size class (of classOrams consecutive ORAMs)
+	 *
+	 * A class is sized for its fullest ORAM, not the average, so a skewed partition leaves every ORAM
+	 * at most half full (capacity is 2^L * z blocks).
+	 *
+	 * @param blockNumbers the number of blocks in each ORAM
+	 */
+	vector<number> sizeClassLogCapacities(const vector<number>& blockNumbers, number classOrams, number z);
+
+	/**
+	 * @brief read only the first attribute of the CSV dataset, in file order
+	 *
+	 * The values are the same as salaryToNumber of each line, parsed in place on threads (0 for all cores),
+	 * without building records or indices.
+	 */
+	vector<number> ingestKeys(const string& path, number threads = 0);
+}
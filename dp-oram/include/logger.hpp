@@ -0,0 +1,62 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <string>
+
+/**
+ * @brief Log the message if level passes the verbosity filter
+ *
+ * The message expression (e.g. a boost::wformat chain) is evaluated only if the level passes,
+ * so filtered out messages cost a single comparison.
+ * CRITICAL messages are always logged, flushed, and terminate the program.
+ */
+#define LOG(level, message)                                                \
+	do                                                                     \
+	{                                                                      \
+		if ((level) >= DPORAM::__logLevel || (level) == DPORAM::CRITICAL) \
+		{                                                                  \
+			DPORAM::logMessage((level), message);                          \
+		}                                                                  \
+	} while (false)
+
+namespace DPORAM
+{
+	using namespace std;
+
+	/**
+	 * @brief Hand the message over to the background writer
+	 *
+	 * Messages are appended to a per-thread buffer which the writer thread drains,
+	 * orders by arrival and prints along with the timestamp.
+	 * Use LOG macro instead, so that filtered out messages are not formatted.
+	 */
+	void logMessage(LOG_LEVEL level, wstring message);
+
+	void logMessage(LOG_LEVEL level, const boost::wformat& message);
+
+	/**
+	 * @brief duplicate the log stream to the file (opened for writing)
+	 */
+	void logToFile(const string& fileName);
+
+	/**
+	 * @brief enable or disable printing to standard output (enabled by default)
+	 */
+	void logToConsole(bool enabled);
+
+	/**
+	 * @brief if set, keep the (UTF-8) log lines in memory, see logLines
+	 */
+	void collectLogLines(bool enabled);
+
+	/**
+	 * @brief block until every message logged before the call is written out
+	 */
+	void flushLog();
+
+	/**
+	 * @brief the log lines kept if collectLogLines is set (flushes first)
+	 */
+	vector<string> logLines();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <map>
+#include <set>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	/**
+	 * @brief Records inserted, updated and deleted on top of the B+ trees, which are built once and never change
+	 *
+	 * Records are identified by ID: the records of the dataset in file order, then the inserted ones in order.
+	 * The overlay keeps the locator of every live record, the locators whose tree entries are deleted,
+	 * the indexed values of the records inserted since the trees were built,
+	 * and the free blocks of every ORAM: the blocks of deleted records (reused first) and the never used ones up to the capacity.
+	 * An update is a delete and an insert of the same ID, possibly into another block.
+	 */
+	class IndexOverlay
+	{
+		public:
+		/**
+		 * @param index the tree index of the first indexed column, pair<value, bytes(ORAMid, blockId)> of the dataset records in file order
+		 * @param used the number of blocks the dataset occupies in each ORAM
+		 * @param capacities the number of blocks each ORAM can hold
+		 * @param attributes the number of indexed columns
+		 */
+		IndexOverlay(const vector<pair<number, bytes>>& index, const vector<number>& used, const vector<number>& capacities, number attributes);
+
+		/**
+		 * @brief the number of blocks an ORAM of 2^logCapacity buckets of z blocks can hold
+		 *
+		 * Half of the slots, as ingestion provisions them: past that the stash of the ORAM overflows.
+		 * Inserts beyond it need the indices regenerated (with the records in the dataset) for bigger ORAMs.
+		 */
+		static number capacity(number logCapacity, number z);
+
+		/**
+		 * @brief restore the overlay from length bytes of serialize output (e.g. a snapshot section), throws if it is malformed
+		 */
+		IndexOverlay(const uchar* serialized, number length, const vector<number>& capacities);
+
+		/**
+		 * @brief add a record with the indexed values to a free block of the ORAM, throws if the ORAM is full
+		 *
+		 * @return pair<ID, blockId> of the new record
+		 */
+		pair<number, number> insert(const vector<number>& values, number oram);
+
+		/**
+		 * @brief move a live record to a free block of the ORAM with new indexed values
+		 *
+		 * Throws before changing anything if the ID is not live or the ORAM is full
+		 * (a record staying in its ORAM can always take its own block back).
+		 *
+		 * @return pair<ORAMid, blockId> of the freed block and the block ID of the record
+		 */
+		pair<pair<number, number>, number> update(number id, const vector<number>& values, number oram);
+
+		/**
+		 * @brief delete a live record, throws if there is none with the ID
+		 *
+		 * @return pair<ORAMid, blockId> of the freed block
+		 */
+		pair<number, number> remove(number id);
+
+		/**
+		 * @brief bring the tree search result of the indexed column range up to date
+		 *
+		 * Drops the locators of deleted records and appends those of the inserted records with values in [from, to].
+		 */
+		void search(number attribute, number from, number to, vector<bytes>& result) const;
+
+		/**
+		 * @brief the number of IDs issued so far, live or deleted
+		 */
+		number records() const;
+
+		/**
+		 * @brief the number of blocks of the ORAM ever used (fake requests are drawn from them)
+		 */
+		number used(number oram) const;
+
+		/**
+		 * @brief the number of live records in the ORAM
+		 */
+		number live(number oram) const;
+
+		/**
+		 * @brief the number of bytes serialize writes
+		 */
+		number serializedLength() const;
+
+		/**
+		 * @brief write serializedLength bytes to output (e.g. straight into a snapshot section)
+		 */
+		void serialize(uchar* output) const;
+
+		bytes serialize() const;
+
+		private:
+		number attributes;
+		vector<number> capacities;
+
+		// ID -> pair<ORAMid, blockId>, ORAMid is ULLONG_MAX if deleted
+		vector<pair<number, number>> directory;
+		// ID -> indexed values of the records inserted on top of the trees
+		map<number, vector<number>> insertedValues;
+		// per indexed column, value -> ID of the inserted records
+		vector<multimap<number, number>> inserted;
+		// the locators whose tree entries are deleted
+		set<pair<number, number>> removed;
+
+		vector<number> usedBlocks;
+		vector<number> liveRecords;
+		vector<vector<number>> freeBlocks;
+
+		// a free block of the ORAM, throws if there is none
+		number allocate(number oram);
+		// puts the record with a new or just deleted ID into a free block, returns the block ID
+		number place(number id, const vector<number>& values, number oram);
+	};
+}
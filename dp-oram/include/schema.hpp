@@ -0,0 +1,150 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <string>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	/**
+	 * @brief A column of the dataset
+	 *
+	 * Indexed columns get a B+ tree and a DP index and can be queried, Text columns are only carried in records.
+	 */
+	struct column
+	{
+		string name;
+		COLUMN_ENCODING encoding = Decimal;
+		bool indexed			 = false;
+	};
+
+	/**
+	 * @brief The columns of a dataset, the leading comma-separated fields of every line
+	 *
+	 * The rest of a line is the record payload.
+	 * Records are partitioned into ORAMs by the value of the first indexed column.
+	 */
+	struct datasetSchema
+	{
+		vector<column> columns;
+		vector<number> indexed; // positions of the indexed columns, in schema order
+	};
+
+	/**
+	 * @brief a range over a column, tuple<field, encoding, from, to> where field is the column position
+	 */
+	using rangeCondition = tuple<number, number, number, number>;
+
+	/**
+	 * @brief parse a schema description
+	 *
+	 * Columns are comma-separated, each is name[:encoding][:indexed] (Decimal by default),
+	 * e.g. "salary:Decimal:indexed,age:Integer:indexed,name:Text".
+	 * Throws on unknown encodings, repeated names, indexed Text columns and schemas without indexed columns.
+	 */
+	datasetSchema parseSchema(const string& description);
+
+	/**
+	 * @brief the schema of the original datasets, attributes indexed Decimal columns
+	 */
+	datasetSchema defaultSchema(number attributes);
+
+	/**
+	 * @brief the position of the named column, throws if there is none
+	 */
+	number columnPosition(const datasetSchema& schema, const string& name);
+
+	/**
+	 * @brief encode the field text, order-preserving and shifted by OFFSET as salaryToNumber
+	 *
+	 * Decimal values are stored in cents (exactly as salaryToNumber), Integer values in units.
+	 * Throws for Text and for values that do not parse.
+	 */
+	number encodeValue(const string& text, COLUMN_ENCODING encoding);
+
+	/**
+	 * @brief the number of encoded units in a unit of the value (100 cents in a dollar), domains are computed in values
+	 */
+	number encodingScale(COLUMN_ENCODING encoding);
+
+	/**
+	 * @brief the encoded value of the field of a (padded) text record
+	 */
+	number valueFromRecord(const bytes& record, number field, COLUMN_ENCODING encoding);
+
+	/**
+	 * @brief the next record of a block, records of a packed block are separated by newlines (see packRecords)
+	 *
+	 * Copies the record at position (without the separator and padding) and moves position past it.
+	 *
+	 * @return false if there are no more records in the block
+	 */
+	bool nextRecord(const bytes& block, number& position, bytes& record);
+
+	/**
+	 * @brief whether the record is within all of the ranges
+	 */
+	bool matchesConditions(const bytes& record, const vector<rangeCondition>& conditions);
+
+	/**
+	 * @brief a partial aggregate of a column over the records of one ORAM, tuple<count, sum, min, max>
+	 *
+	 * The sum is of the encoded units without OFFSET (cents for Decimal), min and max are encoded values.
+	 * Partials of different ORAMs are merged into the aggregate of the query.
+	 */
+	using partialAggregate = tuple<number, long long, number, number>;
+
+	/**
+	 * @brief the aggregate of no records
+	 */
+	partialAggregate emptyAggregate();
+
+	/**
+	 * @brief add the record to the aggregate, the value of a Text column is not read (only counted)
+	 */
+	void aggregateRecord(partialAggregate& aggregate, const bytes& record, number field, COLUMN_ENCODING encoding);
+
+	/**
+	 * @brief add the other partial aggregate to the aggregate
+	 */
+	void mergeAggregates(partialAggregate& aggregate, const partialAggregate& other);
+
+	/**
+	 * @brief the value of the function over the aggregate, in values (dollars for Decimal), 0 for Min, Max and Avg of no records
+	 */
+	double aggregateValue(const partialAggregate& aggregate, AGGREGATE_FUNCTION function, COLUMN_ENCODING encoding);
+
+	/**
+	 * @brief a column of a projection, pair<field, encoding> where field is the column position
+	 */
+	using projectedColumn = pair<number, number>;
+
+	/**
+	 * @brief the projected columns of records, column by column in projection order
+	 *
+	 * Decimal and Integer columns are encoded values (first), Text columns are the field texts (second).
+	 */
+	using projectedValues = pair<vector<vector<number>>, vector<vector<string>>>;
+
+	/**
+	 * @brief the text of the field of a (padded) text record
+	 */
+	string textFromRecord(const bytes& record, number field);
+
+	/**
+	 * @brief the projection of no records
+	 */
+	projectedValues emptyProjection(const vector<projectedColumn>& columns);
+
+	/**
+	 * @brief append the columns of the record to the projection
+	 */
+	void projectRecord(projectedValues& projection, const bytes& record, const vector<projectedColumn>& columns);
+
+	/**
+	 * @brief the number of records in the projection
+	 */
+	number projectedRows(const projectedValues& projection);
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	// bump whenever the layout or the meaning of a section changes
+	const number SNAPSHOT_VERSION = 3;
+
+	/**
+	 * @brief Kinds of snapshot sections, each kind may have one section per ID (e.g. ORAM ID)
+	 */
+	enum SNAPSHOT_SECTION : number
+	{
+		SnapshotStatistics,
+		SnapshotQueries,
+		SnapshotBlockNumbers,
+		SnapshotKey,
+		SnapshotStrawmanKey,
+		SnapshotPositionMap,
+		SnapshotStash,
+		SnapshotNoiseParameters,
+		SnapshotNoise,
+		SnapshotGeneration,
+		SnapshotOverlay
+	};
+
+	/**
+	 * @brief 64-bit FNV-1a hash of the parts (each followed by a separator)
+	 */
+	number fingerprint(const vector<string>& parts);
+
+	/**
+	 * @brief 64-bit checksum of the buffer, processed a word at a time
+	 */
+	number checksum(const uchar* data, number length);
+
+	/**
+	 * @brief Client state snapshot, memory-mapped copy-on-write
+	 *
+	 * The file is a header, a table of sections (with checksums) and the sections themselves, page-aligned.
+	 * Sections are used in place; writing into a section modifies the mapping, not the file.
+	 * Throws if the file cannot be mapped, is not a snapshot or has a different version.
+	 * Opening does not read the sections, see verify.
+	 */
+	class Snapshot
+	{
+		public:
+		explicit Snapshot(const string& path);
+		~Snapshot();
+
+		Snapshot(const Snapshot&) = delete;
+		Snapshot& operator=(const Snapshot&) = delete;
+
+		/**
+		 * @brief the fingerprint the snapshot was written with
+		 */
+		number fingerprint() const;
+
+		bool has(SNAPSHOT_SECTION type, number id = 0) const;
+
+		/**
+		 * @brief check the checksums of all sections on threads (0 for all cores), throws on mismatch
+		 *
+		 * Must be called before any section is modified.
+		 */
+		void verify(number threads = 0) const;
+
+		/**
+		 * @brief the section as pair<data, length in bytes>, throws if it does not exist
+		 */
+		pair<uchar*, number> section(SNAPSHOT_SECTION type, number id = 0) const;
+
+		/**
+		 * @brief copy of a section holding an array of trivially copyable values
+		 */
+		template <class T>
+		vector<T> values(SNAPSHOT_SECTION type, number id = 0) const
+		{
+			auto [data, length] = section(type, id);
+			vector<T> result(length / sizeof(T));
+			if (result.size() > 0)
+			{
+				memcpy((void*)result.data(), data, result.size() * sizeof(T));
+			}
+			return result;
+		}
+
+		private:
+		uchar* mapped = nullptr;
+		number length = 0;
+		number stamp  = 0;
+
+		// pair<type, ID> -> tuple<offset, length, checksum>
+		map<pair<number, number>, tuple<number, number, number>> sections;
+	};
+
+	/**
+	 * @brief Accumulates sections and writes them out as a snapshot
+	 *
+	 * Sections are produced and filled right before writing, in parallel, directly into the mapped output file,
+	 * so large sections (e.g. position maps) are never copied into an intermediate buffer.
+	 * The snapshot is written next to the path, synced, renamed over it and the directory synced,
+	 * so a crash while writing leaves the previous snapshot intact and a returned write is durable.
+	 */
+	class SnapshotWriter
+	{
+		public:
+		explicit SnapshotWriter(number fingerprint);
+
+		/**
+		 * @brief add a section of length bytes, to be filled in place by fill on write
+		 */
+		void add(SNAPSHOT_SECTION type, number id, number length, function<void(uchar*)> fill);
+
+		/**
+		 * @brief add a section whose length is not known in advance, produce is called on write
+		 */
+		void add(SNAPSHOT_SECTION type, number id, function<bytes()> produce);
+
+		/**
+		 * @brief add a section holding an array of trivially copyable values
+		 */
+		template <class T>
+		void add(SNAPSHOT_SECTION type, number id, vector<T> values)
+		{
+			auto length = values.size() * sizeof(T);
+			add(type, id, length, [values = move(values), length](uchar* destination) {
+				if (length > 0)
+				{
+					memcpy(destination, (const void*)values.data(), length);
+				}
+			});
+		}
+
+		/**
+		 * @brief drop a section added before, if any
+		 */
+		void remove(SNAPSHOT_SECTION type, number id);
+
+		/**
+		 * @brief produce, fill and checksum the sections on threads (0 for all cores) and write the snapshot
+		 */
+		void write(const string& path, number threads = 0) const;
+
+		private:
+		struct pendingSection
+		{
+			number length = 0;
+			function<void(uchar*)> fill;
+			function<bytes()> produce;
+		};
+
+		number stamp;
+		map<pair<number, number>, pendingSection> sections;
+	};
+
+	/**
+	 * @brief Position map stored as a plain array, either owned or borrowed from a snapshot
+	 *
+	 * A borrowed map is read straight from the (copy-on-write) snapshot mapping,
+	 * so loading it costs nothing until the pages are touched.
+	 * Optionally records which entries were set, for incremental checkpoints.
+	 */
+	class SnapshotPositionMapAdapter : public PathORAM::AbsPositionMapAdapter
+	{
+		public:
+		explicit SnapshotPositionMapAdapter(number capacity);
+		SnapshotPositionMapAdapter(shared_ptr<Snapshot> snapshot, number oram, number capacity);
+
+		number get(const number block) const final;
+		void set(const number block, const number leaf) final;
+
+		const number* data() const;
+		number size() const;
+
+		/**
+		 * @brief start recording the blocks whose positions are set
+		 */
+		void track();
+
+		/**
+		 * @brief pair<block, leaf> of the entries set since the previous call (or track), in no particular order
+		 */
+		vector<pair<number, number>> changes();
+
+		private:
+		vector<number> owned;
+		shared_ptr<Snapshot> snapshot;
+		number* positions;
+		number capacity;
+
+		bool tracking = false;
+		vector<bool> dirty;
+		vector<number> changed;
+	};
+
+	/**
+	 * @brief serialize the stash as tuple<block ID, block of blockSize bytes> records
+	 */
+	bytes stashToSection(const shared_ptr<PathORAM::AbsStashAdapter>& stash, number blockSize);
+
+	/**
+	 * @brief add the blocks serialized by stashToSection to the stash
+	 */
+	void stashFromSection(const shared_ptr<PathORAM::AbsStashAdapter>& stash, const Snapshot& snapshot, number oram, number blockSize);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <string>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	/**
+	 * @brief What the hardware costs, the inputs of the latency model
+	 *
+	 * Set by hand (e.g. from storage-overhead results) or measured by the calibrate functions.
+	 */
+	struct hardwareProfile
+	{
+		double roundTrip   = 0;	  // ns per storage request
+		double bandwidth   = 1e9; // bytes per second between client and storage
+		double byteCost	   = 0;	  // ns of client work (encryption, stash) per byte moved
+		number parallelism = 1;	  // ORAMs served concurrently
+		number batchSize   = 15000;
+	};
+
+	/**
+	 * @brief The space to search and the privacy target
+	 */
+	struct tuningSpace
+	{
+		vector<number> oramsNumbers = {1, 2, 4, 8, 16, 32, 64};
+		vector<number> fanouts		= {2, 4, 8, 16, 32, 64};
+		vector<number> blockSizes	= {256, 512, 1024, 2048, 4096};
+		number z					= 3;
+		bool batched				= true; // ORAM batch processing (--useOramOptimization)
+
+		double epsilon = 0.693;
+		number beta	   = 20; // beta = 2^{-beta}
+		bool gamma	   = true;
+
+		TUNING_OBJECTIVE objective = Latency;
+	};
+
+	/**
+	 * @brief One point of the space and its predicted per-query cost (averaged over the sample queries)
+	 */
+	struct tuningResult
+	{
+		number oramsNumber;
+		number fanout;
+		number buckets;
+		number levels;
+		number blockSize;
+		number mu;
+
+		double real;	// records matching the padded query
+		double records; // records fetched from all ORAMs, real + padding + noise
+		double bytes;	// bytes moved between client and storage
+		double latency; // ns
+	};
+
+	/**
+	 * @brief Predicted cost of one query
+	 */
+	struct costPrediction
+	{
+		double bytes;	// moved between client and storage, both directions
+		double latency; // ns
+	};
+
+	/**
+	 * @brief the expected number of distinct buckets on the paths of the records in a Path ORAM of logCapacity levels
+	 *
+	 * Batched (multiple) requests read the union of the paths once, otherwise each record reads its own path.
+	 */
+	double pathBuckets(number records, number logCapacity, bool batched);
+
+	/**
+	 * @brief predict the cost of fetching perOram[i] records from each of the Path ORAMs
+	 *
+	 * The path buckets are read and written back, in storage batches if batched and one request per path otherwise.
+	 * ORAM i is served by worker i % parallelism (as ORAMs are distributed among RPC hosts),
+	 * and the query takes as long as the busiest worker.
+	 */
+	costPrediction predictCost(const vector<number>& perOram, number logCapacity, number z, number blockSize, bool batched, const hardwareProfile& hardware);
+
+	/**
+	 * @brief predict the cost of a configuration over the sample queries
+	 *
+	 * Values are the (sorted) salaries of the dataset, the queries are in the same units.
+	 * The DP tree has the fewest levels that the sample queries need; the result is not feasible (has no levels)
+	 * if they need more than main allows for these buckets.
+	 */
+	tuningResult estimate(const vector<number>& values, const vector<pair<number, number>>& queries, number oramsNumber, number fanout, number buckets, number blockSize, const tuningSpace& space, const hardwareProfile& hardware);
+
+	/**
+	 * @brief estimate every feasible configuration of the space, best (by the objective) first
+	 *
+	 * Buckets are the powers of the fanout up to the domain (in dollars, as main computes it),
+	 * block sizes smaller than the longest record (plus a terminator) are skipped.
+	 */
+	vector<tuningResult> tune(vector<number> values, const vector<pair<number, number>>& queries, number longestRecord, const tuningSpace& space, const hardwareProfile& hardware);
+
+	/**
+	 * @brief measure the client work per byte with a short run of an in-memory ORAM
+	 */
+	void calibrateClient(hardwareProfile& hardware, number blockSize, number z, number requests = 256);
+
+	/**
+	 * @brief measure the round trip and bandwidth of a storage backend with single-block and full-batch reads
+	 *
+	 * The storage must have at least hardware.batchSize locations.
+	 */
+	void calibrateStorage(hardwareProfile& hardware, const shared_ptr<PathORAM::AbsStorageAdapter>& storage, number rounds = 10);
+}
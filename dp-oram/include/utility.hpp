@@ -12,20 +12,58 @@ namespace DPORAM
 
 	number optimalMu(double beta, number k, number N, double epsilon, number levels, number orams);
 
+	/**
+	 * @brief optimalMu for the product of two DP trees (of N and N2 buckets), whose nodes are pairs of their nodes
+	 *
+	 * A record is in levels * levels2 nodes of the product, which is the sensitivity.
+	 */
+	number optimalMu2D(double beta, number k, number N, number N2, double epsilon, number levels, number levels2, number orams);
+
 	vector<pair<number, number>> BRC(number fanout, number from, number to, number maxLevel = ULONG_MAX);
 
+	/**
+	 * @brief the largest L such that fanout^L <= value, in integers (floating point logarithms are not exact for some powers)
+	 */
+	number floorLog(number fanout, number value);
+
+	/**
+	 * @brief decompose the [from, to] x [from2, to2] rectangle of buckets into nodes of the product of two BRC trees
+	 *
+	 * A node is a pair of BRC nodes, one per dimension; the nodes cover each bucket of the rectangle exactly once.
+	 */
+	vector<pair<pair<number, number>, pair<number, number>>> BRC2D(number fanout, number from, number to, number from2, number to2);
+
 	double sampleLaplace(double mu, double lambda);
 
 	number gammaNodes(number m, double beta, number kZero);
 
+	/**
+	 * @brief append fakesNumber block IDs (less than maxBlocks) that are not among the (real) blocks
+	 *
+	 * Sorts the blocks.
+	 */
+	void addFakeRequests(vector<number>& blocks, number maxBlocks, number fakesNumber);
+
 	string exec(string cmd);
 
 	wstring timeToString(long long time);
 
+	/**
+	 * @brief the p-th (0 to 100) nearest-rank percentile of the values, 0 if there are none
+	 */
+	number percentile(vector<number> values, double p);
+
 	wstring bytesToString(long long bytes);
 
 	number salaryToNumber(string salary);
 
+	/**
+	 * @brief parse the field-th (0-based) comma-separated salary of a padded record in place
+	 *
+	 * Same result as salaryToNumber over the field of PathORAM::toText(record), but without copies.
+	 */
+	number salaryFromRecord(const bytes& record, number field = 0);
+
 	double numberToSalary(number salary);
 
 	string redishost(string host, int i);
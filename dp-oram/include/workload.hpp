@@ -0,0 +1,43 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <string>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	/**
+	 * @brief How a query workload falls on the buckets of a dataset
+	 *
+	 * Buckets split the [smallest, largest] key range as padToBuckets does, so they are the DP buckets of main.
+	 */
+	struct workloadHistograms
+	{
+		vector<number> records; // keys in each bucket
+		vector<number> queries; // queries overlapping each bucket
+		vector<number> spans;	// spans[s] queries cover s buckets, spans[0] are those outside the key range
+	};
+
+	/**
+	 * @brief sort the keys on threads (0 for all cores)
+	 *
+	 * Contiguous runs are sorted in parallel and then merged pairwise, also in parallel.
+	 */
+	void parallelSort(vector<number>& keys, number threads = 0);
+
+	/**
+	 * @brief the number of sorted keys within each (inclusive) query range
+	 *
+	 * Two binary searches per query, queries are split among threads (0 for all cores).
+	 */
+	vector<number> rangeCounts(const vector<number>& keys, const vector<pair<number, number>>& queries, number threads = 0);
+
+	/**
+	 * @brief the per-bucket and the span histograms of the queries over the sorted keys
+	 *
+	 * Query endpoints outside the key range are clamped to it.
+	 */
+	workloadHistograms histograms(const vector<number>& keys, const vector<pair<number, number>>& queries, number buckets, number threads = 0);
+}
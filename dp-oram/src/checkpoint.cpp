@@ -0,0 +1,337 @@
+#include "checkpoint.hpp"
+
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	namespace
+	{
+		const number JOURNAL_MAGIC = 0x4C4E524A4D524F44uLL; // "DORMJRNL"
+
+		// every record is a header, a payload and the checksum of the payload
+		struct recordHeader
+		{
+			number magic;
+			number generation;
+			number sequence;
+			number length;
+		};
+
+		void putNumber(bytes& output, number value)
+		{
+			auto position = output.size();
+			output.resize(position + sizeof(number));
+			memcpy(output.data() + position, &value, sizeof(number));
+		}
+
+		// reads a number at position, advancing it, throws past the end
+		number getNumber(const bytes& input, number& position)
+		{
+			if (input.size() - position < sizeof(number))
+			{
+				throw Exception("Checkpoint record is truncated");
+			}
+			number value;
+			memcpy(&value, input.data() + position, sizeof(number));
+			position += sizeof(number);
+			return value;
+		}
+
+		// payload: ORAMs count, then per ORAM its ID, positions, removed IDs and stashed blocks (each prefixed with count)
+		bytes serialize(const vector<pair<number, oramDelta>>& deltas, number blockSize)
+		{
+			bytes result;
+			putNumber(result, deltas.size());
+			for (auto&& [oram, delta] : deltas)
+			{
+				putNumber(result, oram);
+
+				putNumber(result, delta.positions.size());
+				for (auto&& [block, leaf] : delta.positions)
+				{
+					putNumber(result, block);
+					putNumber(result, leaf);
+				}
+
+				putNumber(result, delta.removed.size());
+				for (auto&& block : delta.removed)
+				{
+					putNumber(result, block);
+				}
+
+				putNumber(result, delta.stashed.size());
+				for (auto&& [block, data] : delta.stashed)
+				{
+					putNumber(result, block);
+					auto position = result.size();
+					result.resize(position + blockSize, 0);
+					memcpy(result.data() + position, data.data(), min((number)data.size(), blockSize));
+				}
+			}
+
+			return result;
+		}
+
+		vector<pair<number, oramDelta>> deserialize(const bytes& payload, number blockSize)
+		{
+			number position = 0;
+			vector<pair<number, oramDelta>> result(getNumber(payload, position));
+			for (auto&& [oram, delta] : result)
+			{
+				oram = getNumber(payload, position);
+
+				delta.positions.resize(getNumber(payload, position));
+				for (auto&& [block, leaf] : delta.positions)
+				{
+					block = getNumber(payload, position);
+					leaf  = getNumber(payload, position);
+				}
+
+				delta.removed.resize(getNumber(payload, position));
+				for (auto&& block : delta.removed)
+				{
+					block = getNumber(payload, position);
+				}
+
+				delta.stashed.resize(getNumber(payload, position));
+				for (auto&& [block, data] : delta.stashed)
+				{
+					block = getNumber(payload, position);
+					if (payload.size() - position < blockSize)
+					{
+						throw Exception("Checkpoint record is truncated");
+					}
+					data = bytes(payload.begin() + position, payload.begin() + position + blockSize);
+					position += blockSize;
+				}
+			}
+
+			return result;
+		}
+	}
+
+	StateTracker::StateTracker(shared_ptr<SnapshotPositionMapAdapter> positionMap, shared_ptr<PathORAM::AbsStashAdapter> stash) :
+		positionMap(positionMap),
+		stash(stash)
+	{
+		positionMap->track();
+
+		vector<PathORAM::block> blocks;
+		stash->getAll(blocks);
+		for (auto&& [id, data] : blocks)
+		{
+			stashed[id] = checksum(data.data(), data.size());
+		}
+	}
+
+	oramDelta StateTracker::changes()
+	{
+		oramDelta result;
+		result.positions = positionMap->changes();
+
+		vector<PathORAM::block> blocks;
+		stash->getAll(blocks);
+
+		map<number, number> current;
+		for (auto&& [id, data] : blocks)
+		{
+			auto sum	= checksum(data.data(), data.size());
+			current[id] = sum;
+
+			auto previous = stashed.find(id);
+			if (previous == stashed.end() || previous->second != sum)
+			{
+				result.stashed.push_back({id, move(data)});
+			}
+		}
+		for (auto&& [id, sum] : stashed)
+		{
+			if (current.count(id) == 0)
+			{
+				result.removed.push_back(id);
+			}
+		}
+		stashed = move(current);
+
+		return result;
+	}
+
+	void applyDelta(const oramDelta& delta, const shared_ptr<PathORAM::AbsPositionMapAdapter>& positionMap, const shared_ptr<PathORAM::AbsStashAdapter>& stash)
+	{
+		for (auto&& [block, leaf] : delta.positions)
+		{
+			positionMap->set(block, leaf);
+		}
+		for (auto&& block : delta.removed)
+		{
+			if (stash->exists(block))
+			{
+				stash->remove(block);
+			}
+		}
+		for (auto&& [block, data] : delta.stashed)
+		{
+			if (stash->exists(block))
+			{
+				stash->update(block, data);
+			}
+			else
+			{
+				stash->add(block, data);
+			}
+		}
+	}
+
+	CheckpointJournal::CheckpointJournal(const string& path, number generation, number blockSize) :
+		generation(generation),
+		blockSize(blockSize)
+	{
+		descriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+		if (descriptor < 0)
+		{
+			throw Exception(boost::format("Checkpoint journal cannot be created: %1%") % path);
+		}
+
+		worker = thread(&CheckpointJournal::run, this);
+	}
+
+	CheckpointJournal::~CheckpointJournal()
+	{
+		{
+			lock_guard<mutex> guard(stateMutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		worker.join();
+		close(descriptor);
+	}
+
+	void CheckpointJournal::submit(vector<pair<number, oramDelta>> deltas)
+	{
+		{
+			lock_guard<mutex> guard(stateMutex);
+			queue.push_back(move(deltas));
+			submitted++;
+		}
+		wakeUp.notify_one();
+	}
+
+	void CheckpointJournal::flush()
+	{
+		unique_lock<mutex> guard(stateMutex);
+		done.wait(guard, [this]() { return completed >= submitted || !failure.empty(); });
+		if (!failure.empty())
+		{
+			throw Exception(failure);
+		}
+	}
+
+	number CheckpointJournal::written()
+	{
+		lock_guard<mutex> guard(stateMutex);
+		return completed;
+	}
+
+	void CheckpointJournal::run()
+	{
+		auto sequence = 0uLL;
+		while (true)
+		{
+			vector<vector<pair<number, oramDelta>>> pending;
+			{
+				unique_lock<mutex> guard(stateMutex);
+				wakeUp.wait(guard, [this]() { return stopping || !queue.empty(); });
+				if (queue.empty())
+				{
+					return;
+				}
+				pending.swap(queue);
+			}
+
+			for (auto&& deltas : pending)
+			{
+				auto payload = serialize(deltas, blockSize);
+				recordHeader header{JOURNAL_MAGIC, generation, sequence++, payload.size()};
+				auto sum = checksum(payload.data(), payload.size());
+
+				bytes record(sizeof(header) + payload.size() + sizeof(number));
+				memcpy(record.data(), &header, sizeof(header));
+				memcpy(record.data() + sizeof(header), payload.data(), payload.size());
+				memcpy(record.data() + sizeof(header) + payload.size(), &sum, sizeof(number));
+
+				auto written = 0uLL;
+				while (written < record.size())
+				{
+					auto result = ::write(descriptor, record.data() + written, record.size() - written);
+					if (result <= 0)
+					{
+						break;
+					}
+					written += result;
+				}
+
+				lock_guard<mutex> guard(stateMutex);
+				if (written < record.size() || fdatasync(descriptor) != 0)
+				{
+					failure = "Checkpoint journal cannot be written";
+				}
+				else
+				{
+					completed++;
+				}
+			}
+			done.notify_all();
+		}
+	}
+
+	map<number, vector<oramDelta>> readJournal(const string& path, number generation, number blockSize)
+	{
+		map<number, vector<oramDelta>> result;
+
+		ifstream input(path, ios::binary);
+		if (!input)
+		{
+			return result;
+		}
+		auto size = boost::filesystem::file_size(path);
+
+		for (auto sequence = 0uLL;; sequence++)
+		{
+			recordHeader header;
+			if (!input.read((char*)&header, sizeof(header)) || header.magic != JOURNAL_MAGIC || header.generation != generation || header.sequence != sequence || header.length > size)
+			{
+				break;
+			}
+
+			bytes payload(header.length);
+			number sum;
+			if (!input.read((char*)payload.data(), payload.size()) || !input.read((char*)&sum, sizeof(number)) || checksum(payload.data(), payload.size()) != sum)
+			{
+				break;
+			}
+
+			vector<pair<number, oramDelta>> deltas;
+			try
+			{
+				deltas = deserialize(payload, blockSize);
+			}
+			catch (const Exception&)
+			{
+				// written with a different block size
+				break;
+			}
+			for (auto&& [oram, delta] : deltas)
+			{
+				result[oram].push_back(move(delta));
+			}
+		}
+
+		return result;
+	}
+}
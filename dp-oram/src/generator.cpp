@@ -0,0 +1,185 @@
+#include "generator.hpp"
+
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	namespace
+	{
+		// attribute a uses streams 2a and 2a + 1, the rest are far enough
+		const number SAMPLE_STREAM	  = 1uLL << 32;
+		const number QUERY_STREAM	  = SAMPLE_STREAM + 1;
+		const number HOTSPOT_STREAM	  = SAMPLE_STREAM + 2;
+		const number HOTSPOT_POSITION = SAMPLE_STREAM + 3;
+
+		// enough to estimate quantiles at the selectivities we query
+		const number QUANTILE_SAMPLE = 100000;
+
+		number mix(number z)
+		{
+			// splitmix64 finalizer
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9uLL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBuLL;
+			return z ^ (z >> 31);
+		}
+	}
+
+	DatasetGenerator::DatasetGenerator(datasetConfig config) :
+		config(config)
+	{
+		if (config.minValue > config.maxValue || config.distinct == 0)
+		{
+			throw Exception("malformed dataset configuration");
+		}
+
+		if (config.distribution == Zipf)
+		{
+			// Gray et al., "Quickly generating billion-record synthetic databases"
+			if (config.skew <= 0 || config.skew >= 1)
+			{
+				throw Exception("Zipf skew must be in (0, 1)");
+			}
+			for (auto i = 1uLL; i <= config.distinct; i++)
+			{
+				zeta += 1.0 / pow(i, config.skew);
+			}
+			threshold = 1 + pow(0.5, config.skew);
+			alpha	  = 1 / (1 - config.skew);
+			eta		  = (1 - pow(2.0 / config.distinct, 1 - config.skew)) / (1 - threshold / zeta);
+		}
+	}
+
+	number DatasetGenerator::size() const
+	{
+		return config.count;
+	}
+
+	double DatasetGenerator::uniform(number position, number stream) const
+	{
+		return (mix(mix(config.seed ^ mix(position)) + stream) >> 11) * 0x1.0p-53;
+	}
+
+	string DatasetGenerator::text(number record, number attribute) const
+	{
+		auto u		 = uniform(record, 2 * attribute);
+		auto span	 = config.maxValue - config.minValue;
+		auto dollars = config.minValue;
+
+		// a rank among distinct values, spread over the domain so that frequent values are not adjacent
+		auto distinctValue = [this, span](number rank) {
+			auto spread = rank * 2654435761uLL % config.distinct;
+			return config.minValue + span * spread / max(config.distinct - 1, 1uLL);
+		};
+
+		switch (config.distribution)
+		{
+			case Uniform:
+				dollars = config.minValue + span * u;
+				break;
+			case Normal:
+			{
+				// Box-Muller, clipped to the domain
+				auto v	= uniform(record, 2 * attribute + 1);
+				dollars = config.mean + config.deviation * sqrt(-2 * log(1 - u)) * cos(2 * M_PI * v);
+				dollars = clamp(dollars, config.minValue, config.maxValue);
+				break;
+			}
+			case Zipf:
+			{
+				auto scaled = u * zeta;
+				number rank;
+				if (scaled < 1)
+				{
+					rank = 0;
+				}
+				else if (scaled < threshold)
+				{
+					rank = 1;
+				}
+				else
+				{
+					rank = min((number)(config.distinct * pow(eta * u - eta + 1, alpha)), config.distinct - 1);
+				}
+				dollars = distinctValue(rank);
+				break;
+			}
+			case Duplicates:
+				dollars = distinctValue(min((number)(u * config.distinct), config.distinct - 1));
+				break;
+		}
+
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%.2f", dollars);
+		return buffer;
+	}
+
+	number DatasetGenerator::value(number record, number attribute) const
+	{
+		// parsed the same way as the record text will be
+		return salaryToNumber(text(record, attribute));
+	}
+
+	string DatasetGenerator::record(number record) const
+	{
+		string result;
+		for (auto attribute = 0uLL; attribute < config.attributes; attribute++)
+		{
+			result += text(record, attribute) + ",";
+		}
+		result += to_string(record);
+
+		if (result.size() + 1 < config.recordLength)
+		{
+			result += "," + string(config.recordLength - result.size() - 1, 'x');
+		}
+
+		return result;
+	}
+
+	vector<pair<number, number>> DatasetGenerator::queries(number count, double selectivity, double hotspot, double hotspotWidth, number attribute) const
+	{
+		vector<pair<number, number>> result;
+		if (config.count == 0)
+		{
+			return result;
+		}
+
+		vector<number> sample(min(config.count, QUANTILE_SAMPLE));
+		for (auto i = 0uLL; i < sample.size(); i++)
+		{
+			auto record = sample.size() == config.count ? i : min((number)(uniform(i, SAMPLE_STREAM) * config.count), config.count - 1);
+			sample[i]	= value(record, attribute);
+		}
+		sort(sample.begin(), sample.end());
+
+		selectivity	 = clamp(selectivity, 0.0, 1.0);
+		hotspotWidth = clamp(hotspotWidth, selectivity, 1.0);
+		auto center	 = hotspotWidth / 2 + uniform(HOTSPOT_POSITION, HOTSPOT_STREAM) * (1 - hotspotWidth);
+
+		for (auto i = 0uLL; i < count; i++)
+		{
+			// the first quantile of the query
+			auto from = uniform(i, QUERY_STREAM);
+			if (uniform(i, HOTSPOT_STREAM) < hotspot)
+			{
+				from = center - hotspotWidth / 2 + from * (hotspotWidth - selectivity);
+			}
+			else
+			{
+				from *= 1 - selectivity;
+			}
+
+			auto last  = (number)sample.size() - 1;
+			auto left  = min((number)(from * sample.size()), last);
+			auto right = min((number)((from + selectivity) * sample.size()), last);
+			result.push_back({sample[left], sample[max(left, right)]});
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,702 @@
+#include "ingest.hpp"
+
+#include "b-plus-tree/utility.hpp"
+#include "path-oram/utility.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <future>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	MappedFile::MappedFile(const string& path)
+	{
+		descriptor = open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+		{
+			throw Exception(boost::format("File cannot be opened: %1%") % path);
+		}
+
+		struct stat status;
+		if (fstat(descriptor, &status) != 0)
+		{
+			close(descriptor);
+			throw Exception(boost::format("File cannot be read: %1%") % path);
+		}
+		length = status.st_size;
+
+		// mmap does not accept zero length
+		if (length > 0)
+		{
+			auto address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (address == MAP_FAILED)
+			{
+				close(descriptor);
+				throw Exception(boost::format("File cannot be mapped: %1%") % path);
+			}
+			// the file is read front to back exactly once
+			madvise(address, length, MADV_SEQUENTIAL);
+			mapped = (const char*)address;
+		}
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (mapped != nullptr)
+		{
+			munmap((void*)mapped, length);
+		}
+		if (descriptor >= 0)
+		{
+			close(descriptor);
+		}
+	}
+
+	const char* MappedFile::data() const
+	{
+		return mapped;
+	}
+
+	number MappedFile::size() const
+	{
+		return length;
+	}
+
+	vector<pair<number, number>> lineChunks(const char* data, number size, number chunks)
+	{
+		vector<pair<number, number>> result;
+		if (size == 0 || chunks == 0)
+		{
+			return result;
+		}
+
+		auto step = (size + chunks - 1) / chunks;
+		auto from = 0uLL;
+		while (from < size)
+		{
+			auto to = min(from + step, size);
+			// move the boundary right after the next newline, so that no line is split
+			while (to < size && data[to - 1] != '\n')
+			{
+				to++;
+			}
+			result.push_back({from, to});
+			from = to;
+		}
+
+		return result;
+	}
+
+	PartitionRuns::PartitionRuns(number orams, function<string(number)> runFile, number bufferBytes) :
+		runFile(runFile),
+		bufferBytes(bufferBytes)
+	{
+		sizes.resize(orams, 0);
+		pending.resize(orams);
+
+		for (auto i = 0uLL; i < orams; i++)
+		{
+			ofstream run(runFile(i), ios::out | ios::binary | ios::trunc);
+		}
+	}
+
+	PartitionRuns::~PartitionRuns()
+	{
+		for (auto i = 0uLL; i < sizes.size(); i++)
+		{
+			remove(runFile(i).c_str());
+		}
+	}
+
+	void PartitionRuns::append(number oram, bytes record)
+	{
+		buffered += record.size() + sizeof(number);
+		sizes[oram]++;
+		pending[oram].push_back(move(record));
+
+		if (buffered >= bufferBytes)
+		{
+			flush();
+		}
+	}
+
+	number PartitionRuns::size(number oram) const
+	{
+		return sizes[oram];
+	}
+
+	void PartitionRuns::seal()
+	{
+		flush();
+	}
+
+	void PartitionRuns::flush()
+	{
+		for (auto i = 0uLL; i < pending.size(); i++)
+		{
+			if (pending[i].size() == 0)
+			{
+				continue;
+			}
+
+			// open one file at a time
+			ofstream run(runFile(i), ios::out | ios::binary | ios::app);
+			for (auto&& record : pending[i])
+			{
+				number length = record.size();
+				run.write((const char*)&length, sizeof(number));
+				run.write((const char*)record.data(), length);
+			}
+			if (!run)
+			{
+				throw Exception(boost::format("Cannot write ORAM run file: %1%") % runFile(i));
+			}
+
+			pending[i].clear();
+			pending[i].shrink_to_fit();
+		}
+		buffered = 0;
+	}
+
+	void PartitionRuns::read(number oram, number blockSize, number maxRecords, function<void(vector<pair<number, bytes>>&)> handler) const
+	{
+		ifstream run(runFile(oram), ios::in | ios::binary);
+
+		vector<pair<number, bytes>> chunk;
+		chunk.reserve(min(maxRecords, sizes[oram]));
+
+		string record;
+		for (auto blockId = 0uLL; blockId < sizes[oram]; blockId++)
+		{
+			number length;
+			run.read((char*)&length, sizeof(number));
+			record.resize(length);
+			run.read(record.data(), length);
+			if (!run)
+			{
+				throw Exception(boost::format("Cannot read ORAM run file: %1%") % runFile(oram));
+			}
+
+			chunk.push_back({blockId, PathORAM::fromText(record, blockSize)});
+
+			if (chunk.size() == maxRecords)
+			{
+				handler(chunk);
+				chunk.clear();
+			}
+		}
+
+		if (chunk.size() > 0)
+		{
+			handler(chunk);
+		}
+	}
+
+	namespace
+	{
+		// per-chunk intermediate result
+		struct parsedChunk
+		{
+			// the indexed values of each line (in schema order) and its ORAM id, in line order
+			vector<number> values;
+			vector<number> oramIds;
+			// records of each ORAM in line order, padded if block size is given
+			vector<vector<bytes>> blocks;
+
+			vector<number> minValues;
+			vector<number> maxValues;
+		};
+
+		// parses [from, to) lines; blockSize of 0 keeps records as they are
+		parsedChunk parseChunk(const char* data, number from, number to, number orams, number blockSize, const datasetSchema& schema)
+		{
+			parsedChunk chunk;
+			chunk.blocks.resize(orams);
+			chunk.minValues.resize(schema.indexed.size(), ULONG_MAX);
+			chunk.maxValues.resize(schema.indexed.size(), 0);
+
+			while (from < to)
+			{
+				// same line semantics as getline: split on \n, no trailing empty line
+				auto end = from;
+				while (end < to && data[end] != '\n')
+				{
+					end++;
+				}
+				string line(data + from, end - from);
+				from = end + 1;
+
+				// the indexed fields, up to the last of them
+				auto first = chunk.values.size();
+				auto next  = 0uLL;
+				for (auto position = 0uLL, field = 0uLL, start = 0uLL; next < schema.indexed.size() && position <= line.size(); position++)
+				{
+					if (position < line.size() && line[position] != ',')
+					{
+						continue;
+					}
+					if (field == schema.indexed[next])
+					{
+						auto value = encodeValue(line.substr(start, position - start), schema.columns[field].encoding);
+
+						chunk.minValues[next] = min(value, chunk.minValues[next]);
+						chunk.maxValues[next] = max(value, chunk.maxValues[next]);
+						chunk.values.push_back(value);
+						next++;
+					}
+					field++;
+					start = position + 1;
+				}
+				if (next < schema.indexed.size())
+				{
+					throw Exception(boost::format("Line '%1%' does not have the indexed column %2%") % line % schema.columns[schema.indexed[next]].name);
+				}
+
+				auto oramId = PathORAM::hashToNumber(BPlusTree::bytesFromNumber(chunk.values[first]), orams);
+
+				chunk.oramIds.push_back(oramId);
+				chunk.blocks[oramId].push_back(blockSize > 0 ? PathORAM::fromText(line, blockSize) : bytes(line.begin(), line.end()));
+			}
+
+			return chunk;
+		}
+
+		// parses the ranges in parallel, rethrowing parsing exceptions
+		vector<parsedChunk> parseChunks(const MappedFile& file, vector<pair<number, number>>::const_iterator begin, vector<pair<number, number>>::const_iterator end, number orams, number blockSize, const datasetSchema& schema)
+		{
+			vector<future<parsedChunk>> parsing;
+			for (auto range = begin; range != end; range++)
+			{
+				parsing.push_back(async(launch::async, parseChunk, file.data(), range->first, range->second, orams, blockSize, cref(schema)));
+			}
+
+			vector<parsedChunk> chunks;
+			chunks.reserve(parsing.size());
+			for (auto&& future : parsing)
+			{
+				chunks.push_back(future.get());
+			}
+
+			return chunks;
+		}
+
+		// appends the chunks values to the tree indices (in parallel), advancing oramSizes by the chunks blocks
+		void indexChunks(ingestedDataset& result, const vector<parsedChunk>& chunks, vector<number>& oramSizes)
+		{
+			auto attributes = result.treeIndices.size();
+
+			// offsets[c][i] is the first block ID chunk c gets in ORAM i,
+			// starts[c] is the position of chunk c first record in the tree indices
+			vector<vector<number>> offsets;
+			vector<number> starts;
+			auto records = result.treeIndices[0].size();
+			for (auto&& chunk : chunks)
+			{
+				offsets.push_back(oramSizes);
+				starts.push_back(records);
+				for (auto i = 0uLL; i < oramSizes.size(); i++)
+				{
+					oramSizes[i] += chunk.blocks[i].size();
+				}
+				records += chunk.oramIds.size();
+
+				for (auto a = 0uLL; a < attributes; a++)
+				{
+					result.minValues[a] = min(result.minValues[a], chunk.minValues[a]);
+					result.maxValues[a] = max(result.maxValues[a], chunk.maxValues[a]);
+				}
+			}
+
+			// locators are independent of each other, so tree indices are filled in parallel
+			for (auto&& treeIndex : result.treeIndices)
+			{
+				treeIndex.resize(records);
+			}
+
+			auto index = [&result, &chunks, &offsets, &starts, attributes](number c) -> void {
+				auto position = starts[c];
+				auto next	  = offsets[c];
+				for (auto line = 0uLL; line < chunks[c].oramIds.size(); line++, position++)
+				{
+					auto oramId	 = chunks[c].oramIds[line];
+					auto locator = BPlusTree::concatNumbers(2, oramId, next[oramId]++);
+					for (auto a = 0uLL; a < attributes; a++)
+					{
+						result.treeIndices[a][position] = {chunks[c].values[line * attributes + a], locator};
+					}
+				}
+			};
+
+			vector<future<void>> indexing;
+			for (auto c = 0uLL; c < chunks.size(); c++)
+			{
+				indexing.push_back(async(launch::async, index, c));
+			}
+			for (auto&& future : indexing)
+			{
+				future.get();
+			}
+		}
+
+		// an empty result with a tree index per indexed column
+		ingestedDataset emptyDataset(const datasetSchema& schema)
+		{
+			ingestedDataset result;
+			result.treeIndices.resize(schema.indexed.size());
+			result.minValues.resize(schema.indexed.size(), ULONG_MAX);
+			result.maxValues.resize(schema.indexed.size(), 0);
+			return result;
+		}
+
+		number threadsOrDefault(number threads)
+		{
+			return threads > 0 ? threads : max(thread::hardware_concurrency(), 1u);
+		}
+
+		// the leading number of each [from, to) line, as salaryToNumber would parse it
+		vector<number> parseKeys(const char* data, number from, number to)
+		{
+			vector<number> keys;
+
+			// enough for any double in decimal notation
+			char buffer[64];
+			while (from < to)
+			{
+				auto end = from;
+				while (end < to && data[end] != '\n')
+				{
+					end++;
+				}
+
+				auto length = min(end - from, (number)sizeof(buffer) - 1);
+				memcpy(buffer, data + from, length);
+				buffer[length] = '\0';
+				from		   = end + 1;
+
+				char* parsed;
+				auto salary = (long long)(strtod(buffer, &parsed) * 100) + OFFSET;
+				if (parsed == buffer)
+				{
+					throw Exception(boost::format("Cannot parse salary from line: %1%") % buffer);
+				}
+				if ((number)salary >= ULLONG_MAX / 2)
+				{
+					throw Exception(boost::format("Looks like one of the data points (%1%) is smaller than minus OFFSET (-%2%)") % buffer % OFFSET);
+				}
+				keys.push_back(salary);
+			}
+
+			return keys;
+		}
+	}
+
+	ingestedDataset ingestDataset(const string& path, number orams, number blockSize, const datasetSchema& schema, number threads)
+	{
+		MappedFile file(path);
+
+		auto ranges = lineChunks(file.data(), file.size(), threadsOrDefault(threads));
+		auto chunks = parseChunks(file, ranges.begin(), ranges.end(), orams, blockSize, schema);
+
+		auto result = emptyDataset(schema);
+		vector<number> oramSizes(orams, 0);
+		indexChunks(result, chunks, oramSizes);
+
+		result.oramsIndex.resize(orams);
+		for (auto i = 0uLL; i < orams; i++)
+		{
+			result.oramsIndex[i].reserve(oramSizes[i]);
+			for (auto&& chunk : chunks)
+			{
+				for (auto&& block : chunk.blocks[i])
+				{
+					result.oramsIndex[i].push_back({result.oramsIndex[i].size(), move(block)});
+				}
+				chunk.blocks[i].clear();
+				chunk.blocks[i].shrink_to_fit();
+			}
+		}
+
+		return result;
+	}
+
+	ingestedDataset ingestDataset(const string& path, number orams, const datasetSchema& schema, number threads, number budget, PartitionRuns& runs)
+	{
+		const auto MIN_CHUNK = 64uLL << 10;
+		const auto PAGE		 = (number)sysconf(_SC_PAGESIZE);
+
+		MappedFile file(path);
+		threads = threadsOrDefault(threads);
+
+		// a wave of threads chunks takes a quarter of the budget (parsed copies and keys included)
+		auto chunkBytes = max(budget / 4 / threads, MIN_CHUNK);
+		auto ranges		= lineChunks(file.data(), file.size(), (file.size() + chunkBytes - 1) / chunkBytes);
+
+		auto result = emptyDataset(schema);
+		vector<number> oramSizes(orams, 0);
+
+		for (auto wave = 0uLL; wave < ranges.size(); wave += threads)
+		{
+			auto end	= ranges.begin() + min(wave + threads, (number)ranges.size());
+			auto chunks = parseChunks(file, ranges.begin() + wave, end, orams, 0, schema);
+
+			indexChunks(result, chunks, oramSizes);
+
+			for (auto&& chunk : chunks)
+			{
+				for (auto i = 0uLL; i < orams; i++)
+				{
+					for (auto&& record : chunk.blocks[i])
+					{
+						runs.append(i, move(record));
+					}
+				}
+			}
+
+			// the parsed pages will not be touched again
+			auto from = ranges[wave].first / PAGE * PAGE;
+			madvise((void*)(file.data() + from), (end - 1)->second - from, MADV_DONTNEED);
+		}
+		runs.seal();
+
+		return result;
+	}
+
+	void partitionRecords(vector<vector<pair<number, bytes>>>& oramsIndex, vector<vector<pair<number, bytes>>>& treeIndices, PARTITION_STRATEGY strategy)
+	{
+		auto orams	 = oramsIndex.size();
+		auto& values = treeIndices[0];
+
+		// targets[r] is the ORAM record r goes to
+		vector<number> targets(values.size());
+		switch (strategy)
+		{
+			case PValue:
+				for (auto r = 0uLL; r < values.size(); r++)
+				{
+					targets[r] = PathORAM::hashToNumber(BPlusTree::bytesFromNumber(values[r].first), orams);
+				}
+				break;
+			case PRecord:
+				for (auto r = 0uLL; r < values.size(); r++)
+				{
+					targets[r] = PathORAM::hashToNumber(BPlusTree::bytesFromNumber(r), orams);
+				}
+				break;
+			case PRoundRobin:
+				for (auto r = 0uLL; r < values.size(); r++)
+				{
+					targets[r] = r % orams;
+				}
+				break;
+			case PBalanced:
+			{
+				// groups of equal values as [from, to) of the records sorted by value
+				vector<number> order(values.size());
+				iota(order.begin(), order.end(), 0);
+				stable_sort(order.begin(), order.end(), [&values](number a, number b) { return values[a].first < values[b].first; });
+
+				vector<pair<number, number>> groups;
+				for (auto from = 0uLL, to = 0uLL; from < order.size(); from = to)
+				{
+					while (to < order.size() && values[order[to]].first == values[order[from]].first)
+					{
+						to++;
+					}
+					groups.push_back({from, to});
+				}
+				stable_sort(groups.begin(), groups.end(), [](const pair<number, number>& a, const pair<number, number>& b) { return a.second - a.first > b.second - b.first; });
+
+				// the least loaded ORAM is below the share as long as records are left
+				auto share = (values.size() + orams - 1) / orams;
+				vector<number> loads(orams, 0);
+				for (auto&& [from, to] : groups)
+				{
+					while (from < to)
+					{
+						auto oram  = min_element(loads.begin(), loads.end()) - loads.begin();
+						auto taken = min(to - from, share - loads[oram]);
+						for (auto r = from; r < from + taken; r++)
+						{
+							targets[order[r]] = oram;
+						}
+						loads[oram] += taken;
+						from += taken;
+					}
+				}
+				break;
+			}
+		}
+
+		// locators[i][blockId] is the new locator of the record at ORAM i, blockId
+		vector<vector<bytes>> locators(orams);
+		for (auto i = 0uLL; i < orams; i++)
+		{
+			locators[i].resize(oramsIndex[i].size());
+		}
+
+		vector<vector<pair<number, bytes>>> partitioned(orams);
+		for (auto r = 0uLL; r < values.size(); r++)
+		{
+			auto fromTree = BPlusTree::deconstructNumbers(values[r].second);
+			auto oram	  = targets[r];
+
+			locators[fromTree[0]][fromTree[1]] = BPlusTree::concatNumbers(2, oram, partitioned[oram].size());
+			partitioned[oram].push_back({partitioned[oram].size(), move(oramsIndex[fromTree[0]][fromTree[1]].second)});
+		}
+		oramsIndex = move(partitioned);
+
+		for (auto&& treeIndex : treeIndices)
+		{
+			for (auto&& [value, locator] : treeIndex)
+			{
+				auto fromTree = BPlusTree::deconstructNumbers(locator);
+				locator		  = locators[fromTree[0]][fromTree[1]];
+			}
+		}
+	}
+
+	number packRecords(vector<vector<pair<number, bytes>>>& oramsIndex, vector<vector<pair<number, bytes>>>& treeIndices, number blockSize)
+	{
+		// tuple<value, blockId> of every ORAM, from the first tree index
+		vector<vector<pair<number, number>>> order(oramsIndex.size());
+		for (auto&& [value, locator] : treeIndices[0])
+		{
+			auto fromTree = BPlusTree::deconstructNumbers(locator);
+			order[fromTree[0]].push_back({value, fromTree[1]});
+		}
+
+		// slots[i][blockId] is pair<packed blockId, slot> of the record
+		vector<vector<pair<number, number>>> slots(oramsIndex.size());
+		auto records = 0uLL;
+		for (auto i = 0uLL; i < oramsIndex.size(); i++)
+		{
+			stable_sort(order[i].begin(), order[i].end(), [](const pair<number, number>& a, const pair<number, number>& b) { return a.first < b.first; });
+			slots[i].resize(oramsIndex[i].size());
+
+			vector<pair<number, bytes>> packed;
+			string block;
+			auto slot = 0uLL;
+			for (auto&& [value, blockId] : order[i])
+			{
+				auto record = PathORAM::toText(oramsIndex[i][blockId].second, blockSize);
+				if (record.size() >= blockSize)
+				{
+					throw Exception(boost::format("Record of %1% bytes does not fit a block of %2%") % record.size() % blockSize);
+				}
+
+				if (slot > 0 && block.size() + 1 + record.size() >= blockSize)
+				{
+					packed.push_back({packed.size(), PathORAM::fromText(block, blockSize)});
+					block.clear();
+					slot = 0;
+				}
+				if (slot > 0)
+				{
+					block += '\n';
+				}
+				block += record;
+
+				slots[i][blockId] = {packed.size(), slot++};
+				records++;
+			}
+			if (slot > 0)
+			{
+				packed.push_back({packed.size(), PathORAM::fromText(block, blockSize)});
+			}
+
+			oramsIndex[i] = move(packed);
+		}
+
+		for (auto&& treeIndex : treeIndices)
+		{
+			for (auto&& [value, locator] : treeIndex)
+			{
+				auto fromTree		 = BPlusTree::deconstructNumbers(locator);
+				auto [blockId, slot] = slots[fromTree[0]][fromTree[1]];
+				locator				 = BPlusTree::concatNumbers(3, fromTree[0], blockId, slot);
+			}
+		}
+
+		return records;
+	}
+
+	vector<number> assignSizeClasses(vector<vector<pair<number, bytes>>>& oramsIndex, vector<vector<pair<number, bytes>>>& treeIndices, const vector<number>& sizeClasses, number blockSize)
+	{
+		auto group = oramsIndex.size() / sizeClasses.size();
+		vector<vector<pair<number, bytes>>> assigned(oramsIndex.size());
+		vector<number> records(sizeClasses.size(), 0);
+
+		// locators[i][blockId] is pair<ORAM, blockId> the record was moved to
+		vector<vector<pair<number, number>>> locators(oramsIndex.size());
+		for (auto i = 0uLL; i < oramsIndex.size(); i++)
+		{
+			for (auto&& [blockId, block] : oramsIndex[i])
+			{
+				auto record = PathORAM::toText(block, blockSize);
+				auto size	= upper_bound(sizeClasses.begin(), sizeClasses.end(), record.size()) - sizeClasses.begin();
+				if (size == (long)sizeClasses.size())
+				{
+					throw Exception(boost::format("Record of %1% bytes does not fit the largest size class of %2%") % record.size() % sizeClasses.back());
+				}
+
+				auto oram = size * group + i % group;
+				locators[i].push_back({oram, assigned[oram].size()});
+				assigned[oram].push_back({assigned[oram].size(), PathORAM::fromText(record, sizeClasses[size])});
+				records[size]++;
+			}
+		}
+		oramsIndex = move(assigned);
+
+		for (auto&& treeIndex : treeIndices)
+		{
+			for (auto&& [value, locator] : treeIndex)
+			{
+				auto fromTree		 = BPlusTree::deconstructNumbers(locator);
+				auto [oram, blockId] = locators[fromTree[0]][fromTree[1]];
+				locator				 = BPlusTree::concatNumbers(2, oram, blockId);
+			}
+		}
+
+		return records;
+	}
+
+	vector<number> sizeClassLogCapacities(const vector<number>& blockNumbers, number classOrams, number z)
+	{
+		vector<number> result;
+		for (auto first = 0uLL; first < blockNumbers.size(); first += classOrams)
+		{
+			auto largest = *max_element(blockNumbers.begin() + first, blockNumbers.begin() + min(first + classOrams, (number)blockNumbers.size()));
+			result.push_back(ceil(log2(max((largest + z - 1) / z, 1uLL))) + 1);
+		}
+		return result;
+	}
+
+	vector<number> ingestKeys(const string& path, number threads)
+	{
+		MappedFile file(path);
+
+		vector<future<vector<number>>> parsing;
+		for (auto&& range : lineChunks(file.data(), file.size(), threadsOrDefault(threads)))
+		{
+			parsing.push_back(async(launch::async, parseKeys, file.data(), range.first, range.second));
+		}
+
+		vector<number> keys;
+		for (auto&& future : parsing)
+		{
+			auto chunk = future.get();
+			keys.insert(keys.end(), chunk.begin(), chunk.end());
+		}
+
+		return keys;
+	}
+}
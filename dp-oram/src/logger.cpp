@@ -0,0 +1,313 @@
+#include "logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	namespace
+	{
+		// tuple<sequence number, level, timestamp, message>
+		using entry = tuple<number, LOG_LEVEL, time_t, wstring>;
+
+		// messages of one producer thread, drained by the writer
+		struct threadBuffer
+		{
+			mutex lock;
+			vector<entry> entries;
+			// set when the thread exits, the writer drops the buffer once it is drained
+			bool retired = false;
+		};
+
+		// owned by the thread, retires its buffer when the thread exits
+		struct bufferHolder
+		{
+			shared_ptr<threadBuffer> buffer;
+
+			~bufferHolder()
+			{
+				lock_guard<mutex> guard(buffer->lock);
+				buffer->retired = true;
+			}
+		};
+
+		// how often the writer wakes up on its own if no one notifies it
+		const auto WRITER_PERIOD = chrono::milliseconds(20);
+		// the buffer size after which the producer wakes the writer up
+		const auto WAKE_UP_SIZE = 1024uLL;
+
+		class Writer
+		{
+			public:
+			Writer()
+			{
+				worker = thread(&Writer::run, this);
+			}
+
+			~Writer()
+			{
+				{
+					lock_guard<mutex> guard(stateMutex);
+					stopping = true;
+				}
+				wakeUp.notify_all();
+				worker.join();
+			}
+
+			void push(LOG_LEVEL level, wstring&& message)
+			{
+				thread_local bufferHolder holder{subscribe()};
+				auto& buffer = holder.buffer;
+
+				auto size = 0uLL;
+				{
+					lock_guard<mutex> guard(buffer->lock);
+					buffer->entries.emplace_back(sequence++, level, time(nullptr), move(message));
+					size = buffer->entries.size();
+				}
+
+				// the writer polls anyway, so only important or piled up messages deserve a wake-up
+				if (level >= WARNING || size >= WAKE_UP_SIZE)
+				{
+					wakeUp.notify_one();
+				}
+			}
+
+			void flush()
+			{
+				auto target = sequence.load();
+
+				unique_lock<mutex> guard(stateMutex);
+				flushRequested = true;
+				wakeUp.notify_all();
+				written.wait(guard, [this, target]() { return writtenUpTo >= target; });
+			}
+
+			void setFile(const string& fileName)
+			{
+				lock_guard<mutex> guard(outputMutex);
+				file.open(fileName, ios::out);
+			}
+
+			void setConsole(bool enabled)
+			{
+				lock_guard<mutex> guard(outputMutex);
+				console = enabled;
+			}
+
+			void setCollect(bool enabled)
+			{
+				lock_guard<mutex> guard(outputMutex);
+				collect = enabled;
+			}
+
+			vector<string> collected()
+			{
+				flush();
+
+				lock_guard<mutex> guard(outputMutex);
+				return lines;
+			}
+
+			private:
+			atomic<number> sequence{0};
+
+			mutex buffersMutex;
+			vector<shared_ptr<threadBuffer>> buffers;
+
+			mutex stateMutex;
+			condition_variable wakeUp;
+			condition_variable written;
+			bool stopping		= false;
+			bool flushRequested = false;
+			number writtenUpTo	= 0;
+
+			mutex outputMutex;
+			bool console = true;
+			bool collect = false;
+			ofstream file;
+			vector<string> lines;
+
+			thread worker;
+
+			shared_ptr<threadBuffer> subscribe()
+			{
+				auto buffer = make_shared<threadBuffer>();
+
+				lock_guard<mutex> guard(buffersMutex);
+				buffers.push_back(buffer);
+
+				return buffer;
+			}
+
+			// swaps out every thread buffer, drops those of exited threads, and returns the entries ordered by arrival
+			vector<entry> drain()
+			{
+				vector<entry> result;
+
+				lock_guard<mutex> guard(buffersMutex);
+				auto retired = [&result](const shared_ptr<threadBuffer>& buffer) {
+					vector<entry> entries;
+					bool done;
+					{
+						lock_guard<mutex> bufferGuard(buffer->lock);
+						entries.swap(buffer->entries);
+						done = buffer->retired;
+					}
+					move(entries.begin(), entries.end(), back_inserter(result));
+					return done;
+				};
+				buffers.erase(remove_if(buffers.begin(), buffers.end(), retired), buffers.end());
+
+				sort(result.begin(), result.end(), [](const entry& a, const entry& b) { return get<0>(a) < get<0>(b); });
+
+				return result;
+			}
+
+			void write(const vector<entry>& entries)
+			{
+				if (entries.size() == 0)
+				{
+					return;
+				}
+
+				lock_guard<mutex> guard(outputMutex);
+
+				wstring_convert<codecvt_utf8_utf16<wchar_t>> converter;
+
+				// localtime is the same for all entries within one second
+				time_t cachedTime = 0;
+				char cachedStamp[32];
+				wchar_t cachedWideStamp[32];
+
+				for (auto&& [order, level, timestamp, message] : entries)
+				{
+					if (timestamp != cachedTime)
+					{
+						struct tm parts;
+						localtime_r(&timestamp, &parts);
+						strftime(cachedStamp, sizeof(cachedStamp), "%d/%m/%Y %H:%M:%S", &parts);
+						wcsftime(cachedWideStamp, sizeof(cachedWideStamp) / sizeof(wchar_t), L"%d/%m/%Y %H:%M:%S", &parts);
+						cachedTime = timestamp;
+					}
+
+					if (console)
+					{
+						wcout << L"[" << cachedWideStamp << L"] " << setw(10) << logLevelColors[level] << LOG_LEVEL_strings[level] << L": " << message << RESET << L"\n";
+					}
+
+					if (file.is_open() || collect)
+					{
+						stringstream ss;
+						ss << "[" << cachedStamp << "] " << setw(10) << converter.to_bytes(LOG_LEVEL_strings[level]) << ": " << converter.to_bytes(message);
+						auto line = ss.str();
+
+						if (file.is_open())
+						{
+							file << line << "\n";
+						}
+						if (collect)
+						{
+							lines.push_back(move(line));
+						}
+					}
+				}
+
+				if (console)
+				{
+					wcout.flush();
+				}
+				if (file.is_open())
+				{
+					file.flush();
+				}
+			}
+
+			void run()
+			{
+				while (true)
+				{
+					bool stop;
+					{
+						unique_lock<mutex> guard(stateMutex);
+						wakeUp.wait_for(guard, WRITER_PERIOD, [this]() { return stopping || flushRequested; });
+						stop		   = stopping;
+						flushRequested = false;
+					}
+
+					// everything with a smaller sequence number is already in the buffers
+					auto target  = sequence.load();
+					auto entries = drain();
+					write(entries);
+
+					{
+						lock_guard<mutex> guard(stateMutex);
+						writtenUpTo = max(writtenUpTo, target);
+					}
+					written.notify_all();
+
+					if (stop)
+					{
+						break;
+					}
+				}
+			}
+		};
+
+		Writer& writer()
+		{
+			// constructed on first use, destructed (drained) at exit
+			static Writer instance;
+			return instance;
+		}
+	}
+
+	void logMessage(LOG_LEVEL level, wstring message)
+	{
+		writer().push(level, move(message));
+
+		if (level == CRITICAL)
+		{
+			writer().flush();
+			exit(1);
+		}
+	}
+
+	void logMessage(LOG_LEVEL level, const boost::wformat& message)
+	{
+		logMessage(level, boost::str(message));
+	}
+
+	void logToFile(const string& fileName)
+	{
+		writer().setFile(fileName);
+	}
+
+	void logToConsole(bool enabled)
+	{
+		writer().setConsole(enabled);
+	}
+
+	void collectLogLines(bool enabled)
+	{
+		writer().setCollect(enabled);
+	}
+
+	void flushLog()
+	{
+		writer().flush();
+	}
+
+	vector<string> logLines()
+	{
+		return writer().collected();
+	}
+}
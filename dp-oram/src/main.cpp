@@ -1,14 +1,23 @@
 #include "b-plus-tree/tree.hpp"
 #include "b-plus-tree/utility.hpp"
+#include "checkpoint.hpp"
 #include "definitions.h"
+#include "generator.hpp"
+#include "ingest.hpp"
+#include "logger.hpp"
+#include "overlay.hpp"
 #include "path-oram/oram.hpp"
 #include "path-oram/utility.hpp"
+#include "schema.hpp"
+#include "snapshot.hpp"
+#include "tuner.hpp"
 #include "utility.hpp"
 
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <future>
@@ -28,22 +37,18 @@ namespace po = boost::program_options;
 namespace pt = boost::property_tree;
 
 using profile = tuple<bool, number, number, number>;
+// tuple<elapsed, fastest thread, real, padding, noise, total>
+using measurement = tuple<number, number, number, number, number, number>;
 
 string filename(string filename, int i);
 template <class INPUT, class OUTPUT>
 vector<OUTPUT> transform(const vector<INPUT>& input, function<OUTPUT(const INPUT&)> application);
 wstring toWString(string input);
 
-inline void storeInputs(vector<pair<number, number>>& queries, vector<number>& oramBlockNumbers);
-inline void loadInputs(vector<pair<number, number>>& queries, vector<number>& oramBlockNumbers);
-
-void addFakeRequests(vector<number>& blocks, number maxBlocks, number fakesNumber);
 void printProfileStats(vector<profile>& profiles, number queries = 0);
 void dumpToMattermost(int argc, char* argv[]);
 void setupRPCHosts(vector<unique_ptr<rpc::client>>& rpcClients);
-
-void LOG(LOG_LEVEL level, wstring message);
-void LOG(LOG_LEVEL level, boost::wformat message);
+void writeResults(const vector<measurement>& measurements, const vector<costPrediction>& predictions, vector<profile>& allProfiles, vector<unique_ptr<rpc::client>>& rpcClients, number queries);
 
 #pragma region GLOBALS
 
@@ -62,6 +67,20 @@ auto USE_ORAM_OPTIMIZATION	  = true;
 auto VIRTUAL_REQUESTS		  = false;
 auto BATCH_SIZE				  = 15000uLL;
 auto QUERIES				  = 20uLL;
+auto INGEST_THREADS			  = 0uLL;
+auto MEMORY_BUDGET			  = 0uLL;
+auto CHECKPOINT_QUERIES		  = 0uLL;
+auto CHECKPOINT_SECONDS		  = 0uLL;
+auto SCAN_THREADS			  = 1uLL;
+auto PACK_RECORDS			  = false;
+
+PARTITION_STRATEGY PARTITIONING = PValue;
+
+// size classes: ORAMs [c * SIZE_CLASS_ORAMS, (c + 1) * SIZE_CLASS_ORAMS) have blocks of SIZE_CLASSES[c] (a single class of ORAM_BLOCK_SIZE if not set)
+auto SIZE_CLASSES_OPTION = string("");
+vector<number> SIZE_CLASSES;
+vector<number> SIZE_CLASS_LOG_CAPACITIES;
+number SIZE_CLASS_ORAMS;
 
 vector<string> RPC_HOSTS;
 
@@ -69,6 +88,16 @@ auto READ_INPUTS	  = true;
 auto GENERATE_INDICES = true;
 auto DATASET_TAG	  = string("dataset-PUMS-louisiana");
 auto QUERYSET_TAG	  = string("queries-PUMS-louisiana-0.5-uniform");
+auto UPDATES_TAG	  = string("");
+auto UPDATES_BATCH	  = 10uLL;
+
+// synthetic inputs (if READ_INPUTS == false)
+auto DISTRIBUTION  = Uniform;
+auto SKEW		   = 0.8;
+auto DISTINCT	   = 1000uLL;
+auto SELECTIVITY   = 0.005;
+auto HOTSPOT	   = 0.0;
+auto HOTSPOT_WIDTH = 0.1;
 
 auto DISABLE_ENCRYPTION	  = false;
 auto WAIT_BETWEEN_QUERIES = 0uLL;
@@ -80,26 +109,19 @@ auto DP_BUCKETS	  = 0uLL;
 auto DP_USE_GAMMA = true;
 auto DP_LEVELS	  = 100uLL;
 
-auto DP_LEVELS2	 = 100uLL;
-auto DP_BUCKETS2 = 0uLL;
-
 auto SEED = 1305;
 
-number MIN_VALUE = ULONG_MAX;
-number MAX_VALUE = 0;
-number MAX_RANGE = 0;
-
-number MIN_VALUE2 = ULONG_MAX;
-number MAX_VALUE2 = 0;
+// per indexed column, in schema order
+vector<number> MIN_VALUES;
+vector<number> MAX_VALUES;
+vector<number> MAX_RANGES;
 
 const auto FILES_DIR		 = "./storage-files";
-const auto KEY_FILE			 = "key";
 const auto TREE_FILE		 = "tree";
 const auto ORAM_STORAGE_FILE = "oram-storage";
-const auto ORAM_MAP_FILE	 = "oram-map";
-const auto ORAM_STASH_FILE	 = "oram-stash";
-const auto STATS_INPUT_FILE	 = "stats-input";
-const auto QUERY_INPUT_FILE	 = "query-input";
+const auto ORAM_RUN_FILE	 = "oram-run";
+const auto SNAPSHOT_FILE	 = "snapshot";
+const auto JOURNAL_FILE		 = "snapshot-journal";
 
 vector<string> REDIS_HOSTS;
 auto REDIS_FLUSH_ALL = false;
@@ -109,16 +131,41 @@ auto POINT_QUERIES = false;
 auto TWO_ATTRIBUTES				= false;
 QUERY_MULTIPLE_T QUERY_MULTIPLE = QFirst;
 
+// the leading columns of the dataset lines (if empty, one or two indexed decimals, as TWO_ATTRIBUTES)
+auto SCHEMA		   = string("");
+auto QUERY_COLUMNS = string("");
+datasetSchema DATASET_SCHEMA;
+vector<number> QUERY_ATTRIBUTES; // the indexed columns (positions in DATASET_SCHEMA.indexed) queries run against, in turn
+
+// aggregate queries (AGGREGATE != ANone) get a partial aggregate of each ORAM instead of the records
+AGGREGATE_FUNCTION AGGREGATE = ANone;
+auto AGGREGATE_COLUMN		 = string("");
+number AGGREGATE_FIELD; // the column position in DATASET_SCHEMA
+
+// projected queries (PROJECTION != "") get the projected columns of the records from the RPC hosts instead of the records
+auto PROJECTION = string("");
+vector<projectedColumn> PROJECTED_COLUMNS;
+
 auto PARALLEL_RPC_LOAD = 100uLL;
 
+// predicted ORAM costs instead of requests (SIMULATE == true)
+auto SIMULATE		 = false;
+auto SIM_CALIBRATE	 = false;
+auto SIM_ROUND_TRIP	 = 0.0;	   // μs
+auto SIM_BANDWIDTH	 = 1000.0; // MB/s
+auto SIM_BYTE_COST	 = 0.0;	   // ns per byte
+auto SIM_PARALLELISM = 0uLL;
+
+// configurations run on the same loaded indices (if SWEEP is set)
+auto SWEEP				 = string("");
+auto SWEEP_CONFIGURATION = 0uLL;
+
 const auto INPUT_FILES_DIR = string("../../experiments-scripts/output/");
 
 auto DUMP_TO_MATTERMOST = true;
-vector<string> logLines;
 
 auto FILE_LOGGING = false;
 string logName;
-ofstream logFile;
 
 auto SIGINT_RECEIVED = false;
 
@@ -129,6 +176,31 @@ mutex profileMutex;
 
 #pragma endregion
 
+#ifdef TESTING
+// counts heap allocations of the whole process (all threads, libraries included)
+atomic<number> ALLOCATIONS{0};
+
+void* operator new(size_t size)
+{
+	ALLOCATIONS++;
+	if (auto pointer = malloc(size))
+	{
+		return pointer;
+	}
+	throw bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept
+{
+	free(pointer);
+}
+#endif
+
 int main(int argc, char* argv[])
 {
 	// to use wcout properly
@@ -148,14 +220,31 @@ int main(int argc, char* argv[])
 	auto oramsNumberCheck	= [](number v) { if (v < 1) { throw Exception("malformed --oramsNumber"); } };
 	auto recordSizeCheck	= [](number v) { if (v < 256uLL) { throw Exception("--recordSize too small"); } };
 	auto betaCheck			= [](number v) { if (v < 1) { throw Exception("malformed --beta, must be >= 1"); } };
-	auto bucketsNumberCheck = [](int v) {
-		auto logV = log(v) / log(DP_K);
-		if (ceil(logV) != floor(logV))
+	auto scanThreadsCheck	= [](number v) { if (v < 1) { throw Exception("malformed --scanThreads, must be >= 1"); } };
+	auto bucketsNumberCheck = [](number v) {
+		// in integers, floating point logarithms are not exact for some powers (e.g. 8^7)
+		auto power = 1uLL;
+		while (DP_K > 1 && power < v)
+		{
+			power *= DP_K;
+		}
+		if (v != 0 && power != v)
 		{
 			throw Exception(boost::format("malformed --bucketsNumber, must be a power of %1%") % DP_K);
 		}
 	};
 
+	// the options a sweep configuration may set, none of them invalidates the dataset, the tree or the ORAMs
+	auto addSweepOptions = [&betaCheck](po::options_description& options) {
+		options.add_options()("fanout,k", po::value<number>(&DP_K)->default_value(DP_K), "DP tree fanout");
+		options.add_options()("bucketsNumber,b", po::value<number>(&DP_BUCKETS)->default_value(DP_BUCKETS), "the number of buckets for DP (if 0, will choose max buckets such that less than the domain size)");
+		options.add_options()("levels", po::value<number>(&DP_LEVELS)->default_value(DP_LEVELS), "number of levels to keep in DP tree (0 for choosing optimal for given queries)");
+		options.add_options()("beta", po::value<number>(&DP_BETA)->notifier(betaCheck)->default_value(DP_BETA), "beta parameter for DP; x such that beta = 2^{-x}");
+		options.add_options()("epsilon", po::value<double>(&DP_EPSILON)->default_value(DP_EPSILON), "epsilon parameter for DP");
+		options.add_options()("useGamma", po::value<bool>(&DP_USE_GAMMA)->default_value(DP_USE_GAMMA), "if set, will use Gamma method to add noise per ORAM");
+		options.add_options()("wait", po::value<number>(&WAIT_BETWEEN_QUERIES)->default_value(WAIT_BETWEEN_QUERIES), "if set, will wait specified number of milliseconds between queries (not for STRAWMAN)");
+	};
+
 	po::options_description desc("range query processor", 120);
 	desc.add_options()("help,h", "produce help message");
 	desc.add_options()("generateIndices,g", po::value<bool>(&GENERATE_INDICES)->default_value(GENERATE_INDICES), "if set, will generate ORAM and tree indices, otherwise will read files");
@@ -164,36 +253,58 @@ int main(int argc, char* argv[])
 	desc.add_options()("oramStorage,s", po::value<ORAM_BACKEND>(&ORAM_STORAGE)->default_value(ORAM_STORAGE), "the ORAM backend to use");
 	desc.add_options()("oramsNumber,n", po::value<number>(&ORAMS_NUMBER)->notifier(oramsNumberCheck)->default_value(ORAMS_NUMBER), "the number of parallel ORAMs to use");
 	desc.add_options()("recordSize", po::value<number>(&ORAM_BLOCK_SIZE)->notifier(recordSizeCheck)->default_value(ORAM_BLOCK_SIZE), "the record size in bytes");
+	desc.add_options()("sizeClasses", po::value<string>(&SIZE_CLASSES_OPTION)->default_value(SIZE_CLASSES_OPTION), "if set, comma-separated record sizes in bytes (e.g. 256,1024,4096); the ORAMs are split into a group per size, and each record goes to the group of the smallest size it fits");
 	desc.add_options()("oramsZ,z", po::value<number>(&ORAM_Z)->default_value(ORAM_Z), "the Z parameter for ORAMs");
-	desc.add_options()("bucketsNumber,b", po::value<number>(&DP_BUCKETS)->notifier(bucketsNumberCheck)->default_value(DP_BUCKETS), "the number of buckets for DP (if 0, will choose max buckets such that less than the domain size)");
 	desc.add_options()("useOrams,u", po::value<bool>(&USE_ORAMS)->default_value(USE_ORAMS), "if set will use ORAMs, otherwise each query will download everything every query");
 	desc.add_options()("useOramOptimization", po::value<bool>(&USE_ORAM_OPTIMIZATION)->default_value(USE_ORAM_OPTIMIZATION), "if set will use ORAM batch processing");
 	desc.add_options()("rpcHost", po::value<vector<string>>(&RPC_HOSTS)->multitoken()->composing(), "If set, will use these hosts in RPC setting; will uniformly distribute ORAMs among these hosts; may optionally include port (e.g. 127.0.0.1:8787);");
 	desc.add_options()("dataset", po::value<string>(&DATASET_TAG)->default_value(DATASET_TAG), "the dataset tag to use when reading dataset file");
 	desc.add_options()("queryset", po::value<string>(&QUERYSET_TAG)->default_value(QUERYSET_TAG), "the queryset tag to use when reading queryset file");
+	desc.add_options()("updates", po::value<string>(&UPDATES_TAG)->default_value(UPDATES_TAG), "if set, the tag of the updates file to apply between queries; its lines are insert,<record>, update,<record ID>,<record> or delete,<record ID> (IDs are the positions of the records in the dataset, then of the inserted records); an ORAM takes inserts up to half of its slots, going further needs the indices regenerated with the records in the dataset");
+	desc.add_options()("updatesBatch", po::value<number>(&UPDATES_BATCH)->default_value(UPDATES_BATCH), "the number of updates applied before each query, their ORAM writes go out along with the reads of the query");
 	desc.add_options()("profileStorage", po::value<bool>(&PROFILE_STORAGE_REQUESTS)->default_value(PROFILE_STORAGE_REQUESTS), "if set, will listen to storage events and record them");
 	desc.add_options()("profileThreads", po::value<bool>(&PROFILE_THREADS)->default_value(PROFILE_THREADS), "if set, will log additional data on threads performance");
 	desc.add_options()("virtualRequests", po::value<bool>(&VIRTUAL_REQUESTS)->default_value(VIRTUAL_REQUESTS), "if set, will only simulate ORAM queries, not actually make them");
-	desc.add_options()("beta", po::value<number>(&DP_BETA)->notifier(betaCheck)->default_value(DP_BETA), "beta parameter for DP; x such that beta = 2^{-x}");
-	desc.add_options()("epsilon", po::value<double>(&DP_EPSILON)->default_value(DP_EPSILON), "epsilon parameter for DP");
-	desc.add_options()("useGamma", po::value<bool>(&DP_USE_GAMMA)->default_value(DP_USE_GAMMA), "if set, will use Gamma method to add noise per ORAM");
-	desc.add_options()("levels", po::value<number>(&DP_LEVELS)->default_value(DP_LEVELS), "number of levels to keep in DP tree (0 for choosing optimal for given queries)");
+	desc.add_options()("simulate", po::value<bool>(&SIMULATE)->default_value(SIMULATE), "if set, will not create ORAMs, but will predict their latency and bandwidth from per-ORAM request counts (implies virtualRequests)");
+	desc.add_options()("simCalibrate", po::value<bool>(&SIM_CALIBRATE)->default_value(SIM_CALIBRATE), "if set, will measure client work per byte with a short in-memory ORAM run instead of using simByteCost");
+	desc.add_options()("simRoundTrip", po::value<double>(&SIM_ROUND_TRIP)->default_value(SIM_ROUND_TRIP), "simulated storage round trip in microseconds");
+	desc.add_options()("simBandwidth", po::value<double>(&SIM_BANDWIDTH)->default_value(SIM_BANDWIDTH), "simulated bandwidth between client and storage in MB/s");
+	desc.add_options()("simByteCost", po::value<double>(&SIM_BYTE_COST)->default_value(SIM_BYTE_COST), "simulated client work (encryption, stash) in nanoseconds per byte moved");
+	desc.add_options()("simParallelism", po::value<number>(&SIM_PARALLELISM)->default_value(SIM_PARALLELISM), "the number of ORAMs served concurrently in simulation (0 for the number of RPC hosts if set, all ORAMs if parallel, 1 otherwise)");
+	desc.add_options()("distribution", po::value<VALUE_DISTRIBUTION>(&DISTRIBUTION)->default_value(DISTRIBUTION), "the distribution of synthetic values (if not reading inputs)");
+	desc.add_options()("skew", po::value<double>(&SKEW)->default_value(SKEW), "the skew of Zipf distribution of synthetic values, in (0, 1)");
+	desc.add_options()("distinct", po::value<number>(&DISTINCT)->default_value(DISTINCT), "the number of distinct synthetic values for Zipf and Duplicates distributions");
+	desc.add_options()("selectivity", po::value<double>(&SELECTIVITY)->default_value(SELECTIVITY), "the fraction of records each synthetic query matches");
+	desc.add_options()("hotspot", po::value<double>(&HOTSPOT)->default_value(HOTSPOT), "the fraction of synthetic queries that fall within the hotspot");
+	desc.add_options()("hotspotWidth", po::value<double>(&HOTSPOT_WIDTH)->default_value(HOTSPOT_WIDTH), "the width of the hotspot as a fraction of records");
 	desc.add_options()("count", po::value<number>(&COUNT)->default_value(COUNT), "number of synthetic records to generate");
 	desc.add_options()("queries", po::value<number>(&QUERIES)->default_value(QUERIES), "number of synthetic queries to generate or real queries to read");
-	desc.add_options()("batch", po::value<number>(&BATCH_SIZE)->default_value(BATCH_SIZE), "batch size to use in storage adapters (does not affect RPCs)"); // TODO PRCs
-	desc.add_options()("fanout,k", po::value<number>(&DP_K)->default_value(DP_K), "DP tree fanout");
+	desc.add_options()("ingestThreads", po::value<number>(&INGEST_THREADS)->default_value(INGEST_THREADS), "number of threads to parse and partition the dataset with (0 for all cores)");
+	desc.add_options()("memoryBudget", po::value<number>(&MEMORY_BUDGET)->default_value(MEMORY_BUDGET), "memory budget in MB for building indices; if set, ORAM partitions are spilled to disk and loaded in chunks (0 to keep the dataset in memory)");
+	desc.add_options()("partitioning", po::value<PARTITION_STRATEGY>(&PARTITIONING)->default_value(PARTITIONING), "how records are assigned to ORAMs when the indices are built: by the hash of the first indexed Value (equal values share an ORAM), the hash of the Record position, RoundRobin, or Balanced groups of equal values");
+	desc.add_options()("packRecords", po::value<bool>(&PACK_RECORDS)->default_value(PACK_RECORDS), "if set, will pack as many records (sorted by the first indexed column) as fit into each ORAM block, so queries fetch and DP pads blocks instead of records");
+	desc.add_options()("checkpointQueries", po::value<number>(&CHECKPOINT_QUERIES)->default_value(CHECKPOINT_QUERIES), "if set, will checkpoint ORAM client state every this many queries (0 to disable)");
+	desc.add_options()("checkpointSeconds", po::value<number>(&CHECKPOINT_SECONDS)->default_value(CHECKPOINT_SECONDS), "if set, will checkpoint ORAM client state every this many seconds (0 to disable)");
+	desc.add_options()("scanThreads", po::value<number>(&SCAN_THREADS)->notifier(scanThreadsCheck)->default_value(SCAN_THREADS), "the number of concurrent scans of each strawman partition (only FileSystem storage scans a partition concurrently)");
+	desc.add_options()("batch", po::value<number>(&BATCH_SIZE)->default_value(BATCH_SIZE), "batch size to use in storage adapters and in strawman scans (does not affect RPCs)"); // TODO PRCs
 	desc.add_options()("verbosity,v", po::value<LOG_LEVEL>(&__logLevel)->default_value(INFO), "verbosity level to output");
-	desc.add_options()("fileLogging", po::value<bool>(&FILE_LOGGING)->default_value(FILE_LOGGING), "if set, log stream will be duplicated to file (noticeably slows down simulation)");
+	desc.add_options()("fileLogging", po::value<bool>(&FILE_LOGGING)->default_value(FILE_LOGGING), "if set, log stream will be duplicated to file");
 	desc.add_options()("disableEncryption", po::value<bool>(&DISABLE_ENCRYPTION)->default_value(DISABLE_ENCRYPTION), "if set, will disable encryption in ORAM");
 	desc.add_options()("dumpToMattermost", po::value<bool>(&DUMP_TO_MATTERMOST)->default_value(DUMP_TO_MATTERMOST), "if set, will dump log to mattermost");
 	desc.add_options()("redisFlushAll", po::value<bool>(&REDIS_FLUSH_ALL)->default_value(REDIS_FLUSH_ALL), "if set, will execute FLUSHALL for all supplied redis hosts");
 	desc.add_options()("pointQueries", po::value<bool>(&POINT_QUERIES)->default_value(POINT_QUERIES), "if set, will run point queries (against left endpoint) instead of range queries");
-	desc.add_options()("wait", po::value<number>(&WAIT_BETWEEN_QUERIES)->default_value(WAIT_BETWEEN_QUERIES), "if set, will wait specified number of milliseconds between queries (not for STRAWMAN)");
 	desc.add_options()("parallelRPCLoad", po::value<number>(&PARALLEL_RPC_LOAD)->default_value(PARALLEL_RPC_LOAD), "the maximum number of parallel load ORAM RPC calls");
 	desc.add_options()("redis", po::value<vector<string>>(&REDIS_HOSTS)->multitoken()->composing(), "Redis host(s) to use. If multiple specified, will distribute uniformly. Default tcp://127.0.0.1:6379 .");
 	desc.add_options()("seed", po::value<int>(&SEED)->default_value(SEED), "To use if in DEBUG mode (otherwise OpenSSL will sample fresh randomness)");
-	desc.add_options()("two-attributes", po::value<bool>(&TWO_ATTRIBUTES)->default_value(TWO_ATTRIBUTES), "if set, will run two attributes queries");
-	desc.add_options()("query-multiple", po::value<QUERY_MULTIPLE_T>(&QUERY_MULTIPLE)->default_value(QUERY_MULTIPLE), "if set, will run the queries against the second attribute");
+	desc.add_options()("two-attributes", po::value<bool>(&TWO_ATTRIBUTES)->default_value(TWO_ATTRIBUTES), "if set, will run two attributes queries (same as --schema a:Decimal:indexed,b:Decimal:indexed)");
+	desc.add_options()("schema", po::value<string>(&SCHEMA)->default_value(SCHEMA), "the leading columns of the dataset lines, comma-separated name[:encoding][:indexed] (encoding is Decimal, Integer or Text), e.g. salary:Decimal:indexed,age:Integer:indexed,name:Text");
+	desc.add_options()("query-columns", po::value<string>(&QUERY_COLUMNS)->default_value(QUERY_COLUMNS), "the comma-separated indexed columns to run the queries against in turn (the two of a conjunctive query); if not set, chosen by query-multiple");
+	desc.add_options()("aggregate", po::value<AGGREGATE_FUNCTION>(&AGGREGATE)->default_value(AGGREGATE), "if not None, will compute Count, Sum, Min, Max or Avg of the matching records next to the ORAMs (on the RPC hosts if any), and only return it");
+	desc.add_options()("aggregate-column", po::value<string>(&AGGREGATE_COLUMN)->default_value(AGGREGATE_COLUMN), "the column to aggregate (Text columns only for Count); if not set, the (first) query column");
+	desc.add_options()("project", po::value<string>(&PROJECTION)->default_value(PROJECTION), "if set, the RPC hosts will only return these comma-separated columns of the matching records, column by column");
+	desc.add_options()("sweep", po::value<string>(&SWEEP)->default_value(SWEEP), "if set, will run every configuration of this file (one per line, e.g. --epsilon 0.5 --wait 10) on the indices loaded once; only fanout, bucketsNumber, levels, beta, epsilon, useGamma and wait may be set");
+	addSweepOptions(desc);
+	desc.add_options()("query-multiple", po::value<QUERY_MULTIPLE_T>(&QUERY_MULTIPLE)->default_value(QUERY_MULTIPLE), "if set, will run the queries against the second attribute, or all of them in turn (Both for conjunctive queries, the queries file then has the second attribute range in columns 3 and 4)");
 
 	po::variables_map vm;
 	po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -205,23 +316,21 @@ int main(int argc, char* argv[])
 		exit(1);
 	}
 
+	// notifiers run in the order of option names, so the fanout is not yet known to them
+	bucketsNumberCheck(DP_BUCKETS);
+
 	// open log file
 	auto timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
 	auto rawtime   = time(nullptr);
 	stringstream timestream;
 	timestream << put_time(localtime(&rawtime), "%Y-%m-%d-%H-%M-%S");
-	auto logName = boost::str(boost::format("%1%--%2%--%3%") % SEED % timestream.str() % timestamp);
+	logName		   = boost::str(boost::format("%1%--%2%--%3%") % SEED % timestream.str() % timestamp);
 
 	if (FILE_LOGGING)
 	{
-		logFile.open(boost::str(boost::format("./results/%1%.log") % logName), ios::out);
-	}
-
-	if (ORAM_STORAGE == FileSystem && !USE_ORAMS && PARALLEL)
-	{
-		LOG(WARNING, L"Cannot use FS strawman storage in parallel. PARALLEL will be set to false.");
-		PARALLEL = false;
+		logToFile(boost::str(boost::format("./results/%1%.log") % logName));
 	}
+	collectLogLines(DUMP_TO_MATTERMOST);
 
 	if (ORAMS_NUMBER == 1 && PARALLEL)
 	{
@@ -235,6 +344,26 @@ int main(int argc, char* argv[])
 		PathORAM::__blockCipherMode = PathORAM::BlockCipherMode::NONE;
 	}
 
+	if (SIMULATE)
+	{
+		if (SIM_PARALLELISM == 0)
+		{
+			SIM_PARALLELISM = RPC_HOSTS.size() > 0 ? RPC_HOSTS.size() : (PARALLEL ? ORAMS_NUMBER : 1);
+		}
+
+		if (!VIRTUAL_REQUESTS)
+		{
+			LOG(WARNING, L"Simulation does not make ORAM requests. VIRTUAL_REQUESTS will be set to true.");
+			VIRTUAL_REQUESTS = true;
+		}
+
+		if (RPC_HOSTS.size() > 0)
+		{
+			LOG(WARNING, L"Simulation does not use RPC, RPC hosts only set the parallelism. RPC_HOSTS will be cleared.");
+			RPC_HOSTS.clear();
+		}
+	}
+
 	if (ORAM_STORAGE != Redis && RPC_HOSTS.size() > 0)
 	{
 		LOG(WARNING, L"RPC requires Redis storage. ORAM_STORAGE will be set to Redis.");
@@ -253,6 +382,68 @@ int main(int argc, char* argv[])
 		VIRTUAL_REQUESTS = false;
 	}
 
+	// an RPC host takes a whole partition in one call, so several of them would be in memory at once
+	if (MEMORY_BUDGET > 0 && RPC_HOSTS.size() > 0)
+	{
+		LOG(WARNING, L"RPC hosts load whole partitions, which the memory budget cannot bound. MEMORY_BUDGET will be set to 0.");
+		MEMORY_BUDGET = 0;
+	}
+
+	if (PARTITIONING != PValue && MEMORY_BUDGET > 0)
+	{
+		LOG(WARNING, L"Spilled records are partitioned as they are read. PARTITIONING will be set to Value.");
+		PARTITIONING = PValue;
+	}
+
+	if (PACK_RECORDS && (!USE_ORAMS || VIRTUAL_REQUESTS || MEMORY_BUDGET > 0))
+	{
+		LOG(WARNING, L"Only records kept in memory and fetched from ORAMs can be packed. PACK_RECORDS will be set to false.");
+		PACK_RECORDS = false;
+	}
+
+	if (SIZE_CLASSES_OPTION != "" && (!USE_ORAMS || VIRTUAL_REQUESTS || MEMORY_BUDGET > 0 || PACK_RECORDS || CHECKPOINT_QUERIES > 0 || CHECKPOINT_SECONDS > 0))
+	{
+		LOG(WARNING, L"Size classes need the records in memory, fetched from ORAMs, not packed and without checkpoints. SIZE_CLASSES_OPTION will be cleared.");
+		SIZE_CLASSES_OPTION = "";
+	}
+
+	// a sweep compares configurations on the same data, updates would change it from one configuration to the next
+	if (UPDATES_TAG != "" && (!USE_ORAMS || VIRTUAL_REQUESTS || RPC_HOSTS.size() > 0 || PACK_RECORDS || CHECKPOINT_QUERIES > 0 || CHECKPOINT_SECONDS > 0 || SWEEP != ""))
+	{
+		LOG(WARNING, L"Updates need the ORAMs on this machine, records not packed, and neither checkpoints nor a sweep. UPDATES_TAG will be cleared.");
+		UPDATES_TAG = "";
+	}
+
+	if (SIZE_CLASSES_OPTION != "")
+	{
+		vector<string> sizes;
+		boost::algorithm::split(sizes, SIZE_CLASSES_OPTION, boost::is_any_of(","));
+		for (auto&& size : sizes)
+		{
+			SIZE_CLASSES.push_back(stoull(size));
+			recordSizeCheck(SIZE_CLASSES.back());
+		}
+		sort(SIZE_CLASSES.begin(), SIZE_CLASSES.end());
+		SIZE_CLASSES.erase(unique(SIZE_CLASSES.begin(), SIZE_CLASSES.end()), SIZE_CLASSES.end());
+
+		if (ORAM_BLOCK_SIZE != SIZE_CLASSES.back())
+		{
+			LOG(WARNING, boost::wformat(L"Records are read into the largest size class. ORAM_BLOCK_SIZE will be set to %1%.") % SIZE_CLASSES.back());
+			ORAM_BLOCK_SIZE = SIZE_CLASSES.back();
+		}
+		if (ORAMS_NUMBER % SIZE_CLASSES.size() != 0)
+		{
+			auto oramsNumber = (ORAMS_NUMBER + SIZE_CLASSES.size() - 1) / SIZE_CLASSES.size() * SIZE_CLASSES.size();
+			LOG(WARNING, boost::wformat(L"Every size class needs the same number of ORAMs. ORAMS_NUMBER will be set to %1%.") % oramsNumber);
+			ORAMS_NUMBER = oramsNumber;
+		}
+	}
+	else
+	{
+		SIZE_CLASSES = {ORAM_BLOCK_SIZE};
+	}
+	SIZE_CLASS_ORAMS = ORAMS_NUMBER / SIZE_CLASSES.size();
+
 	if (PROFILE_STORAGE_REQUESTS && RPC_HOSTS.size() > 0)
 	{
 		LOG(WARNING, L"RPC does not work with profiling. PROFILE_STORAGE_REQUESTS will be set to false.");
@@ -265,16 +456,24 @@ int main(int argc, char* argv[])
 		DP_LEVELS = 1;
 	}
 
-	if (TWO_ATTRIBUTES && !READ_INPUTS)
+	DATASET_SCHEMA = SCHEMA == "" ? defaultSchema(TWO_ATTRIBUTES ? 2 : 1) : parseSchema(SCHEMA);
+
+	if (TWO_ATTRIBUTES != (DATASET_SCHEMA.indexed.size() > 1))
 	{
-		LOG(WARNING, L"Generating inputs for two attribute queries is not supported.");
-		READ_INPUTS = true;
+		LOG(WARNING, boost::wformat(L"The schema has %1% indexed columns. TWO_ATTRIBUTES will be set to %2%.") % DATASET_SCHEMA.indexed.size() % !TWO_ATTRIBUTES);
+		TWO_ATTRIBUTES = !TWO_ATTRIBUTES;
 	}
 
-	if (TWO_ATTRIBUTES && !GENERATE_INDICES)
+	if (!READ_INPUTS)
 	{
-		LOG(WARNING, L"Reading inputs from files for two attribute queries is not supported.");
-		GENERATE_INDICES = true;
+		for (auto&& column : DATASET_SCHEMA.columns)
+		{
+			if (column.encoding != Decimal)
+			{
+				LOG(WARNING, boost::wformat(L"Generated values are decimals. The encoding of column %1% will be set to Decimal.") % toWString(column.name));
+				column.encoding = Decimal;
+			}
+		}
 	}
 
 	if (TWO_ATTRIBUTES && !USE_ORAMS)
@@ -289,6 +488,130 @@ int main(int argc, char* argv[])
 		QUERY_MULTIPLE = QFirst;
 	}
 
+	if (QUERY_COLUMNS != "")
+	{
+		vector<string> names;
+		boost::algorithm::split(names, QUERY_COLUMNS, boost::is_any_of(","));
+		for (auto&& name : names)
+		{
+			auto indexed = find(DATASET_SCHEMA.indexed.begin(), DATASET_SCHEMA.indexed.end(), columnPosition(DATASET_SCHEMA, name));
+			if (indexed == DATASET_SCHEMA.indexed.end())
+			{
+				throw Exception(boost::format("Column %1% is not indexed and cannot be queried") % name);
+			}
+			QUERY_ATTRIBUTES.push_back(indexed - DATASET_SCHEMA.indexed.begin());
+		}
+	}
+	else
+	{
+		switch (QUERY_MULTIPLE)
+		{
+			case QFirst:
+				QUERY_ATTRIBUTES = {0};
+				break;
+			case QSecond:
+				QUERY_ATTRIBUTES = {1};
+				break;
+			case QMultiple:
+				QUERY_ATTRIBUTES.resize(DATASET_SCHEMA.indexed.size());
+				iota(QUERY_ATTRIBUTES.begin(), QUERY_ATTRIBUTES.end(), 0);
+				break;
+			case QBoth:
+				QUERY_ATTRIBUTES = {0, 1};
+				break;
+		}
+	}
+
+	if (QUERY_MULTIPLE == QBoth && (QUERY_ATTRIBUTES.size() != 2 || QUERY_ATTRIBUTES[0] == QUERY_ATTRIBUTES[1]))
+	{
+		throw Exception("Conjunctive queries need two different query columns");
+	}
+
+	if (AGGREGATE != ANone && (!USE_ORAMS || VIRTUAL_REQUESTS))
+	{
+		LOG(WARNING, L"Records are not fetched from ORAMs, there is nothing to aggregate. AGGREGATE will be set to None.");
+		AGGREGATE = ANone;
+	}
+
+	AGGREGATE_FIELD = AGGREGATE_COLUMN == "" ? DATASET_SCHEMA.indexed[QUERY_ATTRIBUTES[0]] : columnPosition(DATASET_SCHEMA, AGGREGATE_COLUMN);
+	if (AGGREGATE > ACount && DATASET_SCHEMA.columns[AGGREGATE_FIELD].encoding == Text)
+	{
+		throw Exception(boost::format("Text column %1% can only be counted") % DATASET_SCHEMA.columns[AGGREGATE_FIELD].name);
+	}
+
+	if (PROJECTION != "" && AGGREGATE != ANone)
+	{
+		LOG(WARNING, L"Aggregate queries do not return records to project. PROJECTION will be cleared.");
+		PROJECTION = "";
+	}
+
+	if (PROJECTION != "")
+	{
+		vector<string> names;
+		boost::algorithm::split(names, PROJECTION, boost::is_any_of(","));
+		for (auto&& name : names)
+		{
+			auto position = columnPosition(DATASET_SCHEMA, name);
+			PROJECTED_COLUMNS.push_back({position, DATASET_SCHEMA.columns[position].encoding});
+		}
+	}
+
+	if (SWEEP != "" && !USE_ORAMS)
+	{
+		LOG(WARNING, L"Strawman does not use DP parameters, sweep configurations would repeat the same run. SWEEP will be cleared.");
+		SWEEP = "";
+	}
+
+	// configurations are checked before anything is loaded; the options they do not set take the values above
+	po::options_description sweepDescription;
+	addSweepOptions(sweepDescription);
+	vector<vector<string>> configurations;
+	if (SWEEP != "")
+	{
+		ifstream sweepFile(SWEEP);
+		if (!sweepFile.is_open())
+		{
+			LOG(CRITICAL, boost::wformat(L"File cannot be opened: %s") % toWString(SWEEP));
+		}
+
+		string line = "";
+		while (getline(sweepFile, line))
+		{
+			boost::algorithm::trim(line);
+			if (line.empty() || line[0] == '#')
+			{
+				continue;
+			}
+
+			// the line is applied as it will be in the sweep, its checks run, then the command line values are restored
+			auto tokens = po::split_unix(line);
+			auto saved	= make_tuple(DP_K, DP_BUCKETS, DP_LEVELS, DP_BETA, DP_EPSILON, DP_USE_GAMMA, WAIT_BETWEEN_QUERIES);
+			try
+			{
+				po::variables_map check;
+				po::store(po::command_line_parser(tokens).options(sweepDescription).run(), check);
+				po::notify(check);
+				bucketsNumberCheck(DP_BUCKETS);
+			}
+			catch (const po::error& e)
+			{
+				throw Exception(boost::format("malformed sweep configuration \"%1%\": %2%") % line % e.what());
+			}
+			catch (const Exception& e)
+			{
+				throw Exception(boost::format("malformed sweep configuration \"%1%\": %2%") % line % e.what());
+			}
+			tie(DP_K, DP_BUCKETS, DP_LEVELS, DP_BETA, DP_EPSILON, DP_USE_GAMMA, WAIT_BETWEEN_QUERIES) = saved;
+			configurations.push_back(tokens);
+		}
+		sweepFile.close();
+
+		if (configurations.size() == 0)
+		{
+			LOG(CRITICAL, boost::wformat(L"No configurations in sweep file %s") % toWString(SWEEP));
+		}
+	}
+
 	if (REDIS_HOSTS.size() == 0)
 	{
 		REDIS_HOSTS.push_back("tcp://127.0.0.1:6379");
@@ -318,15 +641,85 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	struct stat buffer;
-	// if stat file does not exist and GENERATE_INDICES == false
-	if (stat(filename(STATS_INPUT_FILE, -1).c_str(), &buffer) != 0 && !GENERATE_INDICES)
+	auto dataFilePath  = (boost::filesystem::path(INPUT_FILES_DIR) / (DATASET_TAG + ".csv")).string();
+	auto queryFilePath = (boost::filesystem::path(INPUT_FILES_DIR) / (QUERYSET_TAG + ".csv")).string();
+
+	// everything the client state depends on; the snapshot of a different setup is stale
+	vector<string> snapshotParameters = {
+		to_string(READ_INPUTS),
+		DATASET_TAG,
+		QUERYSET_TAG,
+		to_string(COUNT),
+		to_string(QUERIES),
+		to_string(ORAMS_NUMBER),
+		to_string(ORAM_BLOCK_SIZE),
+		to_string(ORAM_Z),
+		to_string(ORAM_STORAGE),
+		to_string(USE_ORAMS),
+		to_string(VIRTUAL_REQUESTS),
+		to_string(RPC_HOSTS.size() > 0),
+		to_string(TWO_ATTRIBUTES),
+		SCHEMA,
+		QUERY_COLUMNS,
+		to_string(QUERY_MULTIPLE),
+		to_string(DISABLE_ENCRYPTION),
+		to_string(PARTITIONING),
+		to_string(PACK_RECORDS),
+		SIZE_CLASSES_OPTION};
+	if (READ_INPUTS)
+	{
+		for (auto&& path : {dataFilePath, queryFilePath})
+		{
+			boost::system::error_code error;
+			snapshotParameters.push_back(to_string(boost::filesystem::file_size(path, error)));
+			snapshotParameters.push_back(to_string(boost::filesystem::last_write_time(path, error)));
+		}
+	}
+	else
+	{
+		for (auto&& parameter : {(double)DISTRIBUTION, SKEW, (double)DISTINCT, SELECTIVITY, HOTSPOT, HOTSPOT_WIDTH, (double)SEED})
+		{
+			snapshotParameters.push_back(to_string(parameter));
+		}
+	}
+	auto snapshotFingerprint = fingerprint(snapshotParameters);
+
+	// if snapshot does not exist or is stale and GENERATE_INDICES == false
+	shared_ptr<Snapshot> snapshot;
+	if (!GENERATE_INDICES)
+	{
+		try
+		{
+			snapshot = make_shared<Snapshot>(filename(SNAPSHOT_FILE, -1));
+			if (snapshot->fingerprint() != snapshotFingerprint)
+			{
+				throw Exception("Snapshot was taken with different inputs or parameters");
+			}
+			snapshot->verify();
+		}
+		catch (const Exception& e)
+		{
+			LOG(WARNING, boost::wformat(L"No usable snapshot found (%1%) and indices generation is disabled. Enabling it forcefully.") % toWString(e.what()));
+			snapshot.reset();
+			GENERATE_INDICES = true;
+		}
+	}
+	SnapshotWriter snapshotWriter(snapshotFingerprint);
+
+	// checkpoints taken on top of the snapshot before a crash, replayed when ORAMs are loaded
+	map<number, vector<oramDelta>> journal;
+	number generation = 0;
+	if (snapshot && snapshot->has(SnapshotGeneration))
 	{
-		LOG(WARNING, L"No stats file found and indices generation is disabled. Enabling it forcefully.");
-		GENERATE_INDICES = true;
+		generation = snapshot->values<number>(SnapshotGeneration)[0];
+		journal	   = readJournal(filename(JOURNAL_FILE, -1), generation, ORAM_BLOCK_SIZE);
+		if (journal.size() > 0)
+		{
+			LOG(INFO, boost::wformat(L"Replaying checkpoints of %1% ORAMs taken after the snapshot") % journal.size());
+		}
 	}
 
-	LOG(INFO, GENERATE_INDICES ? L"Generating indices..." : L"Reading from input files...");
+	LOG(INFO, GENERATE_INDICES ? L"Generating indices..." : L"Reading from snapshot...");
 
 	if (GENERATE_INDICES)
 	{
@@ -347,75 +740,51 @@ int main(int argc, char* argv[])
 	oramsIndex.resize(ORAMS_NUMBER);
 	oramBlockNumbers.resize(ORAMS_NUMBER);
 
-	// vector<pair<salary, bytes(ORAMid, blockId)>>
-	vector<pair<number, bytes>> treeIndex;
-	vector<pair<number, bytes>> treeIndex2;
+	// if memory is bounded, ORAM partitions live on disk until loaded and oramsIndex stays empty
+	shared_ptr<PartitionRuns> runs;
+	if (GENERATE_INDICES && MEMORY_BUDGET > 0)
+	{
+		runs = make_shared<PartitionRuns>(ORAMS_NUMBER, [](number i) { return filename(ORAM_RUN_FILE, i); }, (MEMORY_BUDGET << 20) / 4);
+	}
+
+	// per indexed column, vector<pair<value, bytes(ORAMid, blockId)>>
+	vector<vector<pair<number, bytes>>> treeIndices(DATASET_SCHEMA.indexed.size());
 	vector<pair<number, number>> queries;
+	vector<pair<number, number>> queries2;
+
+	MIN_VALUES.resize(DATASET_SCHEMA.indexed.size(), ULONG_MAX);
+	MAX_VALUES.resize(DATASET_SCHEMA.indexed.size(), 0);
+	MAX_RANGES.resize(DATASET_SCHEMA.indexed.size(), 0);
+
+	// the indexed column a query runs against (the first of a conjunctive one) and its encoding
+	auto queryAttribute = [](number query) { return QUERY_ATTRIBUTES[QUERY_MULTIPLE == QBoth ? 0 : query % QUERY_ATTRIBUTES.size()]; };
+	auto encoding		= [](number attribute) { return DATASET_SCHEMA.columns[DATASET_SCHEMA.indexed[attribute]].encoding; };
 
 	if (GENERATE_INDICES)
 	{
 		if (READ_INPUTS)
 		{
-			auto dataFilePath = (boost::filesystem::path(INPUT_FILES_DIR) / (DATASET_TAG + ".csv")).string();
-			ifstream dataFile(dataFilePath);
-			if (!dataFile.is_open())
+			if (!boost::filesystem::exists(dataFilePath))
 			{
 				LOG(CRITICAL, boost::wformat(L"File cannot be opened: %s") % toWString(dataFilePath));
 			}
 
-			string line = "";
-			while (getline(dataFile, line))
-			{
-				number salary;
-				number salary2;
-
-				if (!TWO_ATTRIBUTES)
-				{
-					salary = salaryToNumber(line);
-				}
-				else
-				{
-					vector<string> salaries;
-					boost::algorithm::split(salaries, line, boost::is_any_of(","));
-					salary	= salaryToNumber(salaries[0]);
-					salary2 = salaryToNumber(salaries[1]);
-				}
-
-				MAX_VALUE = max(salary, MAX_VALUE);
-				MIN_VALUE = min(salary, MIN_VALUE);
-				if (MAX_VALUE >= ULLONG_MAX / 2)
-				{
-					throw Exception(boost::format("Looks like one of the data points (%1%) is smaller than minus OFFSET (-%2%)") % line % OFFSET);
-				}
-
-				LOG(ALL, boost::wformat(L"Salary: %9.2f, data length: %3i") % numberToSalary(salary) % line.size());
-
-				if (TWO_ATTRIBUTES)
-				{
-					MAX_VALUE2 = max(salary2, MAX_VALUE2);
-					MIN_VALUE2 = min(salary2, MIN_VALUE2);
-					if (MAX_VALUE2 >= ULLONG_MAX / 2)
-					{
-						throw Exception(boost::format("Looks like one of the data points (%1%) is smaller than minus OFFSET (-%2%)") % line % OFFSET);
-					}
-
-					LOG(ALL, boost::wformat(L"Salary2: %9.2f, data length: %3i") % numberToSalary(salary2) % line.size());
-				}
+			auto dataset = runs ? ingestDataset(dataFilePath, ORAMS_NUMBER, DATASET_SCHEMA, INGEST_THREADS, MEMORY_BUDGET << 20, *runs) : ingestDataset(dataFilePath, ORAMS_NUMBER, ORAM_BLOCK_SIZE, DATASET_SCHEMA, INGEST_THREADS);
 
-				auto toHash	 = BPlusTree::bytesFromNumber(salary);
-				auto oramId	 = PathORAM::hashToNumber(toHash, ORAMS_NUMBER);
-				auto blockId = oramsIndex[oramId].size();
+			oramsIndex	= move(dataset.oramsIndex);
+			treeIndices = move(dataset.treeIndices);
+			MIN_VALUES	= dataset.minValues;
+			MAX_VALUES	= dataset.maxValues;
 
-				oramsIndex[oramId].push_back({blockId, PathORAM::fromText(line, ORAM_BLOCK_SIZE)});
-				treeIndex.push_back({salary, BPlusTree::concatNumbers(2, oramId, blockId)});
-				if (TWO_ATTRIBUTES)
+			if (__logLevel == ALL && !runs)
+			{
+				for (auto&& [salary, locator] : treeIndices[0])
 				{
-					treeIndex2.push_back({salary2, BPlusTree::concatNumbers(2, oramId, blockId)});
+					auto fromTree = BPlusTree::deconstructNumbers(locator);
+					LOG(ALL, boost::wformat(L"Salary: %9.2f, data length: %3i") % numberToSalary(salary) % PathORAM::toText(oramsIndex[fromTree[0]][fromTree[1]].second, ORAM_BLOCK_SIZE).size());
 				}
 			}
-			dataFile.close();
 
-			auto queryFilePath = (boost::filesystem::path(INPUT_FILES_DIR) / (QUERYSET_TAG + ".csv")).string();
 			ifstream queryFile(queryFilePath);
 			if (!queryFile.is_open())
 			{
@@ -423,19 +792,35 @@ int main(int argc, char* argv[])
 			}
 
 			auto readQueriesCount = 0u;
-			line				  = "";
+			string line			  = "";
 			while (getline(queryFile, line))
 			{
 				vector<string> query;
 				boost::algorithm::split(query, line, boost::is_any_of(","));
-				auto left  = salaryToNumber(query[0]);
-				auto right = salaryToNumber(query[1]);
+				auto attribute = queryAttribute(queries.size());
+				auto left	   = encodeValue(query[0], encoding(attribute));
+				auto right	   = encodeValue(query[1], encoding(attribute));
 
 				LOG(ALL, boost::wformat(L"Query: {%9.2f, %9.2f}") % numberToSalary(left) % numberToSalary(right));
 
 				queries.push_back({left, right});
 
-				MAX_RANGE = max(MAX_RANGE, (right - left) / 100);
+				MAX_RANGES[attribute] = max(MAX_RANGES[attribute], (right - left) / encodingScale(encoding(attribute)));
+
+				if (QUERY_MULTIPLE == QBoth)
+				{
+					if (query.size() < 4)
+					{
+						LOG(CRITICAL, boost::wformat(L"Conjunctive queries need the second attribute range, the query line has %1% columns") % query.size());
+					}
+					auto attribute2 = QUERY_ATTRIBUTES[1];
+					auto left2		= encodeValue(query[2], encoding(attribute2));
+					auto right2		= encodeValue(query[3], encoding(attribute2));
+
+					queries2.push_back({left2, right2});
+
+					MAX_RANGES[attribute2] = max(MAX_RANGES[attribute2], (right2 - left2) / encodingScale(encoding(attribute2)));
+				}
 
 				readQueriesCount++;
 				if (readQueriesCount == QUERIES)
@@ -447,42 +832,155 @@ int main(int argc, char* argv[])
 		}
 		else
 		{
+			// records are generated one at a time, the domain is as wide as the dataset is large
+			datasetConfig config;
+			config.distribution = DISTRIBUTION;
+			config.count		= COUNT;
+			config.attributes	= DATASET_SCHEMA.columns.size();
+			config.recordLength = ORAM_BLOCK_SIZE - 1;
+			config.maxValue		= COUNT;
+			config.mean			= COUNT / 2.0;
+			config.deviation	= COUNT / 6.0;
+			config.skew			= SKEW;
+			config.distinct		= DISTINCT;
+			config.seed			= SEED;
+			DatasetGenerator generator(config);
+
 			for (number i = 0; i < COUNT; i++)
 			{
-				ostringstream text;
-				for (auto j = 0; j < 10; j++)
+				// virtual ORAM requests never read the records, only count them
+				auto record = VIRTUAL_REQUESTS && USE_ORAMS ? string() : generator.record(i);
+				auto salary = generator.value(i, DATASET_SCHEMA.indexed[0]);
+
+				auto toHash	 = BPlusTree::bytesFromNumber(salary);
+				auto oramId	 = PathORAM::hashToNumber(toHash, ORAMS_NUMBER);
+				auto blockId = runs ? runs->size(oramId) : oramsIndex[oramId].size();
+
+				if (runs)
+				{
+					runs->append(oramId, bytes(record.begin(), record.end()));
+				}
+				else
 				{
-					text << to_string(i) + (j < 9 ? "," : "");
+					oramsIndex[oramId].push_back({blockId, VIRTUAL_REQUESTS && USE_ORAMS ? bytes() : PathORAM::fromText(record, ORAM_BLOCK_SIZE)});
 				}
-				auto salary = salaryToNumber(to_string(i));
 
-				MAX_VALUE = max(salary, MAX_VALUE);
-				MIN_VALUE = min(salary, MIN_VALUE);
+				for (auto a = 0uLL; a < treeIndices.size(); a++)
+				{
+					auto value = generator.value(i, DATASET_SCHEMA.indexed[a]);
 
-				auto toHash	 = BPlusTree::bytesFromNumber(salary);
-				auto oramId	 = PathORAM::hashToNumber(toHash, ORAMS_NUMBER);
-				auto blockId = oramsIndex[oramId].size();
+					MAX_VALUES[a] = max(value, MAX_VALUES[a]);
+					MIN_VALUES[a] = min(value, MIN_VALUES[a]);
 
-				oramsIndex[oramId].push_back({blockId, PathORAM::fromText(text.str(), ORAM_BLOCK_SIZE)});
-				treeIndex.push_back({salary, BPlusTree::concatNumbers(2, oramId, blockId)});
+					treeIndices[a].push_back({value, BPlusTree::concatNumbers(2, oramId, blockId)});
+				}
 			}
 
-			for (number i = 0; i < QUERIES; i++)
+			// every query column gets its own queries, the i-th query is taken from those of its column
+			map<number, vector<pair<number, number>>> generated;
+			for (auto&& attribute : QUERY_ATTRIBUTES)
+			{
+				generated[attribute] = generator.queries(QUERIES, SELECTIVITY, HOTSPOT, HOTSPOT_WIDTH, DATASET_SCHEMA.indexed[attribute]);
+			}
+			for (auto i = 0uLL; i < generated[QUERY_ATTRIBUTES[0]].size(); i++)
 			{
-				auto left  = salaryToNumber(to_string(8 * i + 3));
-				auto right = salaryToNumber(to_string(8 * i + 8));
+				auto attribute		  = queryAttribute(i);
+				auto [left, right]	  = generated[attribute][i];
+				MAX_RANGES[attribute] = max(MAX_RANGES[attribute], (right - left) / encodingScale(encoding(attribute)));
 				queries.push_back({left, right});
-				MAX_RANGE = max(MAX_RANGE, (right - left) / 100);
+
+				if (QUERY_MULTIPLE == QBoth)
+				{
+					auto attribute2			= QUERY_ATTRIBUTES[1];
+					auto [left2, right2]	= generated[attribute2][i];
+					MAX_RANGES[attribute2] = max(MAX_RANGES[attribute2], (right2 - left2) / encodingScale(encoding(attribute2)));
+					queries2.push_back({left2, right2});
+				}
+			}
+		}
+
+		if (PARTITIONING != PValue)
+		{
+			partitionRecords(oramsIndex, treeIndices, PARTITIONING);
+		}
+
+		if (SIZE_CLASSES.size() > 1)
+		{
+			auto records = assignSizeClasses(oramsIndex, treeIndices, SIZE_CLASSES, ORAM_BLOCK_SIZE);
+			for (auto c = 0uLL; c < SIZE_CLASSES.size(); c++)
+			{
+				LOG(INFO, boost::wformat(L"Size class of %1% bytes has %2% records in %3% ORAMs") % SIZE_CLASSES[c] % records[c] % SIZE_CLASS_ORAMS);
 			}
 		}
 
-		oramBlockNumbers = transform<vector<pair<number, bytes>>, number>(oramsIndex, [](const vector<pair<number, bytes>>& oramBlocks) { return oramBlocks.size(); });
-		storeInputs(queries, oramBlockNumbers);
+		if (PACK_RECORDS)
+		{
+			auto records = packRecords(oramsIndex, treeIndices, ORAM_BLOCK_SIZE);
+			auto blocks	 = accumulate(oramsIndex.begin(), oramsIndex.end(), 0uLL, [](number sum, const vector<pair<number, bytes>>& oramBlocks) { return sum + oramBlocks.size(); });
+			LOG(INFO, boost::wformat(L"Packed %1% records into %2% blocks (%3$.2f per block)") % records % blocks % (blocks > 0 ? (double)records / blocks : 0.0));
+		}
+
+		if (runs)
+		{
+			runs->seal();
+			for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+			{
+				oramBlockNumbers[i] = runs->size(i);
+			}
+		}
+		else
+		{
+			oramBlockNumbers = transform<vector<pair<number, bytes>>, number>(oramsIndex, [](const vector<pair<number, bytes>>& oramBlocks) { return oramBlocks.size(); });
+		}
 	}
 	else
 	{
-		oramBlockNumbers.clear();
-		loadInputs(queries, oramBlockNumbers);
+		// tuple<min, max, range> of each indexed column
+		auto statistics = snapshot->values<number>(SnapshotStatistics);
+		for (auto a = 0uLL; a < MIN_VALUES.size(); a++)
+		{
+			MIN_VALUES[a] = statistics[3 * a];
+			MAX_VALUES[a] = statistics[3 * a + 1];
+			MAX_RANGES[a] = statistics[3 * a + 2];
+		}
+
+		oramBlockNumbers = snapshot->values<number>(SnapshotBlockNumbers);
+
+		// a conjunctive query is stored as the endpoints of both of its ranges
+		auto endpoints = snapshot->values<number>(SnapshotQueries);
+		auto stride	   = QUERY_MULTIPLE == QBoth ? 4uLL : 2uLL;
+		for (auto i = 0uLL; i + stride - 1 < endpoints.size(); i += stride)
+		{
+			queries.push_back({endpoints[i], endpoints[i + 1]});
+			if (QUERY_MULTIPLE == QBoth)
+			{
+				queries2.push_back({endpoints[i + 2], endpoints[i + 3]});
+			}
+		}
+	}
+
+	{
+		vector<number> statistics;
+		for (auto a = 0uLL; a < MIN_VALUES.size(); a++)
+		{
+			statistics.insert(statistics.end(), {MIN_VALUES[a], MAX_VALUES[a], MAX_RANGES[a]});
+		}
+
+		vector<number> endpoints;
+		for (auto i = 0uLL; i < queries.size(); i++)
+		{
+			endpoints.push_back(queries[i].first);
+			endpoints.push_back(queries[i].second);
+			if (QUERY_MULTIPLE == QBoth)
+			{
+				endpoints.push_back(queries2[i].first);
+				endpoints.push_back(queries2[i].second);
+			}
+		}
+
+		snapshotWriter.add(SnapshotStatistics, 0, statistics);
+		snapshotWriter.add(SnapshotBlockNumbers, 0, oramBlockNumbers);
+		snapshotWriter.add(SnapshotQueries, 0, endpoints);
 	}
 
 	if (POINT_QUERIES)
@@ -491,22 +989,118 @@ int main(int argc, char* argv[])
 		{
 			query.second = query.first;
 		}
+		for (auto&& query : queries2)
+		{
+			query.second = query.first;
+		}
 	}
 
 	COUNT = accumulate(oramBlockNumbers.begin(), oramBlockNumbers.end(), 0uLL);
 
-	ORAM_LOG_CAPACITY = ceil(log2(COUNT / ORAMS_NUMBER / ORAM_Z)) + 1;
+	if (ORAMS_NUMBER > 1)
+	{
+		auto [smallest, largest] = minmax_element(oramBlockNumbers.begin(), oramBlockNumbers.end());
+		auto mean				 = (double)COUNT / ORAMS_NUMBER;
+		LOG(INFO, boost::wformat(L"%1% partitioning: %2% to %3% blocks per ORAM, %4$.2f on average (the largest is %5$.2fx of it)") % PARTITION_STRATEGY_strings[PARTITIONING] % *smallest % *largest % mean % (mean > 0 ? *largest / mean : 0.0));
+	}
 
-	LOG_PARAMETER(COUNT);
-	LOG_PARAMETER(GENERATE_INDICES);
-	LOG_PARAMETER(READ_INPUTS);
-	LOG_PARAMETER(ORAM_BLOCK_SIZE);
-	LOG_PARAMETER(ORAM_LOG_CAPACITY);
-	LOG_PARAMETER(ORAMS_NUMBER);
-	LOG_PARAMETER(PARALLEL);
-	LOG_PARAMETER(ORAM_Z);
-	LOG_PARAMETER(TREE_BLOCK_SIZE);
-	LOG_PARAMETER(USE_ORAMS);
+	// every size class is sized by its fullest ORAM, ORAM_LOG_CAPACITY is the largest
+	SIZE_CLASS_LOG_CAPACITIES = sizeClassLogCapacities(oramBlockNumbers, SIZE_CLASS_ORAMS, ORAM_Z);
+	ORAM_LOG_CAPACITY		  = *max_element(SIZE_CLASS_LOG_CAPACITIES.begin(), SIZE_CLASS_LOG_CAPACITIES.end());
+
+	// the record directory and the changes on top of the trees, built only for updates and kept in the snapshot once built
+	shared_ptr<IndexOverlay> overlay;
+	auto addOverlaySection = [&snapshotWriter, &overlay]() {
+		snapshotWriter.add(SnapshotOverlay, 0, overlay->serializedLength(), [overlay](uchar* destination) { overlay->serialize(destination); });
+	};
+	if (USE_ORAMS && !VIRTUAL_REQUESTS && RPC_HOSTS.size() == 0 && !PACK_RECORDS && (UPDATES_TAG != "" || (!GENERATE_INDICES && snapshot->has(SnapshotOverlay))))
+	{
+		vector<number> capacities;
+		for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+		{
+			capacities.push_back(IndexOverlay::capacity(SIZE_CLASS_LOG_CAPACITIES[i / SIZE_CLASS_ORAMS], ORAM_Z));
+		}
+
+		if (GENERATE_INDICES)
+		{
+			overlay = make_shared<IndexOverlay>(treeIndices[0], oramBlockNumbers, capacities, treeIndices.size());
+		}
+		else if (snapshot->has(SnapshotOverlay))
+		{
+			auto [data, length] = snapshot->section(SnapshotOverlay);
+			overlay				= make_shared<IndexOverlay>(data, length, capacities);
+		}
+
+		if (overlay)
+		{
+			addOverlaySection();
+
+			// fake requests are drawn from the blocks inserted in earlier runs as well
+			for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+			{
+				oramBlockNumbers[i] = overlay->used(i);
+			}
+		}
+	}
+	if (UPDATES_TAG != "" && !overlay)
+	{
+		LOG(WARNING, L"The snapshot has no record directory, indices need to be regenerated. UPDATES_TAG will be cleared.");
+		UPDATES_TAG = "";
+	}
+
+	// operation, record ID (of update and delete), record (of insert and update)
+	vector<tuple<string, number, string>> updates;
+	if (UPDATES_TAG != "")
+	{
+		auto updatesFilePath = (boost::filesystem::path(INPUT_FILES_DIR) / (UPDATES_TAG + ".csv")).string();
+		ifstream updatesFile(updatesFilePath);
+		if (!updatesFile.is_open())
+		{
+			LOG(CRITICAL, boost::wformat(L"File cannot be opened: %s") % toWString(updatesFilePath));
+		}
+
+		string line = "";
+		while (getline(updatesFile, line))
+		{
+			auto comma	   = line.find(',');
+			auto operation = line.substr(0, comma);
+			auto rest	   = comma == string::npos ? string("") : line.substr(comma + 1);
+			if (operation == "insert")
+			{
+				updates.push_back({operation, 0, rest});
+			}
+			else if (operation == "update" || operation == "delete")
+			{
+				comma = rest.find(',');
+				updates.push_back({operation, stoull(rest.substr(0, comma)), comma == string::npos ? string("") : rest.substr(comma + 1)});
+			}
+			else
+			{
+				LOG(CRITICAL, boost::wformat(L"Update '%s' is not an insert, update or delete") % toWString(line));
+			}
+		}
+		updatesFile.close();
+	}
+
+	LOG_PARAMETER(COUNT);
+	LOG_PARAMETER(GENERATE_INDICES);
+	LOG_PARAMETER(READ_INPUTS);
+	if (!READ_INPUTS)
+	{
+		LOG_PARAMETER(DISTRIBUTION);
+		LOG_PARAMETER(SKEW);
+		LOG_PARAMETER(DISTINCT);
+		LOG_PARAMETER(SELECTIVITY);
+		LOG_PARAMETER(HOTSPOT);
+		LOG_PARAMETER(HOTSPOT_WIDTH);
+	}
+	LOG_PARAMETER(ORAM_BLOCK_SIZE);
+	LOG_PARAMETER(ORAM_LOG_CAPACITY);
+	LOG_PARAMETER(ORAMS_NUMBER);
+	LOG_PARAMETER(PARALLEL);
+	LOG_PARAMETER(ORAM_Z);
+	LOG_PARAMETER(TREE_BLOCK_SIZE);
+	LOG_PARAMETER(USE_ORAMS);
 	LOG_PARAMETER(USE_ORAM_OPTIMIZATION);
 	for (auto&& rpcHost : RPC_HOSTS)
 	{
@@ -519,9 +1113,31 @@ int main(int argc, char* argv[])
 	LOG_PARAMETER(FILE_LOGGING);
 	LOG_PARAMETER(DUMP_TO_MATTERMOST);
 	LOG_PARAMETER(VIRTUAL_REQUESTS);
+	LOG_PARAMETER(SIMULATE);
+	if (SIMULATE)
+	{
+		LOG_PARAMETER(SIM_CALIBRATE);
+		LOG_PARAMETER(SIM_ROUND_TRIP);
+		LOG_PARAMETER(SIM_BANDWIDTH);
+		LOG_PARAMETER(SIM_BYTE_COST);
+		LOG_PARAMETER(SIM_PARALLELISM);
+	}
 	LOG_PARAMETER(BATCH_SIZE);
+	LOG_PARAMETER(INGEST_THREADS);
+	LOG_PARAMETER(MEMORY_BUDGET);
+	LOG_PARAMETER(CHECKPOINT_QUERIES);
+	LOG_PARAMETER(CHECKPOINT_SECONDS);
+	LOG_PARAMETER(SCAN_THREADS);
+	LOG_PARAMETER(PARTITIONING);
+	LOG_PARAMETER(PACK_RECORDS);
+	LOG_PARAMETER(toWString(SIZE_CLASSES_OPTION));
 	LOG_PARAMETER(TWO_ATTRIBUTES);
+	LOG_PARAMETER(toWString(SCHEMA));
+	LOG_PARAMETER(toWString(QUERY_COLUMNS));
 	LOG_PARAMETER(QUERY_MULTIPLE);
+	LOG_PARAMETER(AGGREGATE);
+	LOG_PARAMETER(toWString(AGGREGATE_COLUMN));
+	LOG_PARAMETER(toWString(PROJECTION));
 	LOG_PARAMETER(SEED);
 	LOG_PARAMETER(DP_K);
 	LOG_PARAMETER(DP_BETA);
@@ -530,6 +1146,8 @@ int main(int argc, char* argv[])
 
 	LOG(INFO, boost::wformat(L"DATASET_TAG = %1%") % toWString(DATASET_TAG));
 	LOG(INFO, boost::wformat(L"QUERYSET_TAG = %1%") % toWString(QUERYSET_TAG));
+	LOG(INFO, boost::wformat(L"UPDATES_TAG = %1%") % toWString(UPDATES_TAG));
+	LOG_PARAMETER(UPDATES_BATCH);
 
 	LOG(INFO, boost::wformat(L"ORAM_BACKEND = %1%") % ORAM_BACKEND_strings[ORAM_STORAGE]);
 	if (REDIS_HOSTS.size() <= 4)
@@ -548,9 +1166,8 @@ int main(int argc, char* argv[])
 
 #pragma region CONSTRUCT_INDICES
 
-	// vector<tuple<elapsed, fastest thread, real, padding, noise, total>>
-	using measurement = tuple<number, number, number, number, number, number>;
 	vector<measurement> measurements;
+	vector<costPrediction> predictions;
 
 	vector<profile> profiles;
 	vector<profile> allProfiles;
@@ -561,46 +1178,75 @@ int main(int argc, char* argv[])
 	{
 		LOG(INFO, L"Loading ORAMs and B+ tree");
 
-		// indices can be empty if generate == false
-		auto loadOram = [&profiles, &allProfiles](int i, vector<pair<number, bytes>> indices, bool generate, string redisHost, promise<ORAMSet>* promise) -> void {
+		// with bounded memory, load as many partitions at once as fit the budget,
+		// and if even a single one does not fit, load it in chunks
+		auto loadConcurrency = ORAMS_NUMBER;
+		auto loadChunk		 = ULLONG_MAX;
+		if (runs)
+		{
+			auto budget	 = MEMORY_BUDGET << 20;
+			auto largest = *max_element(oramBlockNumbers.begin(), oramBlockNumbers.end());
+
+			// a partition is held by the reader and copied into the ORAM
+			loadConcurrency = clamp(budget / (max(largest, 1uLL) * ORAM_BLOCK_SIZE * 2), 1uLL, ORAMS_NUMBER);
+			loadChunk		= max(budget / (ORAM_BLOCK_SIZE * 2), 1uLL);
+
+			LOG(DEBUG, boost::wformat(L"Loading at most %1% ORAMs at once in chunks of at most %2% records") % loadConcurrency % loadChunk);
+		}
+
+		// keys go to the snapshot along with the rest of ORAM client state
+		vector<bytes> oramKeys(ORAMS_NUMBER);
+
+		// indices can be empty if generate == false or partitions are spilled to runs
+		auto loadOram = [&profiles, &allProfiles, &runs, &snapshot, &journal, &oramKeys, loadChunk](int i, vector<pair<number, bytes>> indices, bool generate, string redisHost, promise<ORAMSet>* promise) -> void {
 			bytes oramKey;
 			if (generate)
 			{
 				oramKey = PathORAM::getRandomBlock(KEYSIZE);
-				PathORAM::storeKey(oramKey, filename(KEY_FILE, i));
 			}
 			else
 			{
-				oramKey = PathORAM::loadKey(filename(KEY_FILE, i));
+				oramKey = snapshot->values<uchar>(SnapshotKey, i);
 			}
+			oramKeys[i] = oramKey;
+
+			auto blockSize	 = SIZE_CLASSES[i / SIZE_CLASS_ORAMS];
+			auto logCapacity = SIZE_CLASS_LOG_CAPACITIES[i / SIZE_CLASS_ORAMS];
 
 			shared_ptr<PathORAM::AbsStorageAdapter> oramStorage;
 			switch (ORAM_STORAGE)
 			{
 				case InMemory:
-					oramStorage = make_shared<PathORAM::InMemoryStorageAdapter>((1 << ORAM_LOG_CAPACITY) + ORAM_Z, ORAM_BLOCK_SIZE, oramKey, ORAM_Z);
+					oramStorage = make_shared<PathORAM::InMemoryStorageAdapter>((1 << logCapacity) + ORAM_Z, blockSize, oramKey, ORAM_Z);
 					break;
 				case FileSystem:
-					oramStorage = make_shared<PathORAM::FileSystemStorageAdapter>((1 << ORAM_LOG_CAPACITY) + ORAM_Z, ORAM_BLOCK_SIZE, oramKey, filename(ORAM_STORAGE_FILE, i), generate, ORAM_Z);
+					oramStorage = make_shared<PathORAM::FileSystemStorageAdapter>((1 << logCapacity) + ORAM_Z, blockSize, oramKey, filename(ORAM_STORAGE_FILE, i), generate, ORAM_Z);
 					break;
 				case Redis:
-					oramStorage = make_shared<PathORAM::RedisStorageAdapter>((1 << ORAM_LOG_CAPACITY) + ORAM_Z, ORAM_BLOCK_SIZE, oramKey, redishost(redisHost, i), generate, ORAM_Z);
+					oramStorage = make_shared<PathORAM::RedisStorageAdapter>((1 << logCapacity) + ORAM_Z, blockSize, oramKey, redishost(redisHost, i), generate, ORAM_Z);
 					break;
 			}
 
-			auto oramPositionMap = make_shared<PathORAM::InMemoryPositionMapAdapter>(((1 << ORAM_LOG_CAPACITY) * ORAM_Z) + ORAM_Z);
-			if (!generate)
-			{
-				oramPositionMap->loadFromFile(filename(ORAM_MAP_FILE, i));
-			}
-			auto oramStash = make_shared<PathORAM::InMemoryStashAdapter>(3 * ORAM_LOG_CAPACITY * ORAM_Z);
+			// a stored position map is used right from the snapshot mapping
+			auto positionMapCapacity = ((1 << logCapacity) * ORAM_Z) + ORAM_Z;
+			auto oramPositionMap	 = generate ? make_shared<SnapshotPositionMapAdapter>(positionMapCapacity) : make_shared<SnapshotPositionMapAdapter>(snapshot, i, positionMapCapacity);
+			auto oramStash			 = make_shared<PathORAM::InMemoryStashAdapter>(3 * logCapacity * ORAM_Z);
 			if (!generate)
 			{
-				oramStash->loadFromFile(filename(ORAM_STASH_FILE, i), ORAM_BLOCK_SIZE);
+				stashFromSection(oramStash, *snapshot, i, blockSize);
+
+				auto deltas = journal.find(i);
+				if (deltas != journal.end())
+				{
+					for (auto&& delta : deltas->second)
+					{
+						applyDelta(delta, oramPositionMap, oramStash);
+					}
+				}
 			}
 			auto oram = make_shared<PathORAM::ORAM>(
-				ORAM_LOG_CAPACITY,
-				ORAM_BLOCK_SIZE,
+				logCapacity,
+				blockSize,
 				ORAM_Z,
 				oramStorage,
 				oramPositionMap,
@@ -608,7 +1254,24 @@ int main(int argc, char* argv[])
 				generate,
 				ULONG_MAX);
 
-			if (generate)
+			if (generate && runs)
+			{
+				// the first chunk is bulk loaded, the rest are written through ORAM batches
+				auto loaded = false;
+				runs->read(i, blockSize, loadChunk, [&oram, &loaded](vector<pair<number, bytes>>& chunk) -> void {
+					if (!loaded)
+					{
+						oram->load(chunk);
+						loaded = true;
+					}
+					else
+					{
+						vector<bytes> response;
+						oram->multiple(chunk, response);
+					}
+				});
+			}
+			else if (generate)
 			{
 				oram->load(indices);
 			}
@@ -633,23 +1296,29 @@ int main(int argc, char* argv[])
 
 		if (!VIRTUAL_REQUESTS && rpcClients.size() == 0)
 		{
+			vector<number> activeThreads;
+
 			for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
 			{
 				futures[i] = promises[i].get_future();
 				threads[i] = thread(
 					loadOram,
 					i,
-					oramsIndex[i], // may be empty if generate == false
+					move(oramsIndex[i]), // may be empty if generate == false
 					GENERATE_INDICES,
 					REDIS_HOSTS[i % REDIS_HOSTS.size()],
 					&promises[i]);
-			}
+				activeThreads.push_back(i);
 
-			for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
-			{
-				auto result = futures[i].get();
-				threads[i].join();
-				oramSets.push_back(result);
+				if (activeThreads.size() == loadConcurrency || i == ORAMS_NUMBER - 1)
+				{
+					for (auto&& j : activeThreads)
+					{
+						oramSets.push_back(futures[j].get());
+						threads[j].join();
+					}
+					activeThreads.clear();
+				}
 			}
 		}
 		else
@@ -666,7 +1335,10 @@ int main(int argc, char* argv[])
 			{
 				threads[i] = thread(
 					[&rpcClients, &oramsIndex, &oramToRpcMap](number oramId) -> void {
-						rpcClients[oramToRpcMap[oramId]]->call("setOram", oramId, REDIS_HOSTS[oramId % REDIS_HOSTS.size()], oramsIndex[oramId], ORAM_LOG_CAPACITY, ORAM_BLOCK_SIZE, ORAM_Z);
+						// setOram takes the whole partition, which is why partitions are never spilled with RPC
+						rpcClients[oramToRpcMap[oramId]]->call("setOram", oramId, REDIS_HOSTS[oramId % REDIS_HOSTS.size()], oramsIndex[oramId], SIZE_CLASS_LOG_CAPACITIES[oramId / SIZE_CLASS_ORAMS], SIZE_CLASSES[oramId / SIZE_CLASS_ORAMS], ORAM_Z);
+						// the partition is on the server now
+						vector<pair<number, bytes>>().swap(oramsIndex[oramId]);
 					},
 					i);
 				activeThreads.push_back(i);
@@ -685,14 +1357,28 @@ int main(int argc, char* argv[])
 			setupRPCHosts(rpcClients);
 		}
 
-		auto treeStorage = make_shared<BPlusTree::FileSystemStorageAdapter>(TREE_BLOCK_SIZE, filename(TREE_FILE, -1), GENERATE_INDICES);
-		auto tree		 = GENERATE_INDICES ? make_shared<BPlusTree::Tree>(treeStorage, treeIndex) : make_shared<BPlusTree::Tree>(treeStorage);
-		shared_ptr<BPlusTree::Tree> tree2;
+		// the trees of the indexed columns are independent files, so they are built in parallel
+		vector<shared_ptr<BPlusTree::Tree>> trees(treeIndices.size());
+		{
+			vector<future<void>> building;
+			for (auto a = 0uLL; a < trees.size(); a++)
+			{
+				building.push_back(async(launch::async, [&trees, &treeIndices, a]() {
+					auto treeStorage = make_shared<BPlusTree::FileSystemStorageAdapter>(TREE_BLOCK_SIZE, filename(TREE_FILE, a == 0 ? -1 : 255 + a), GENERATE_INDICES);
+					trees[a]		 = GENERATE_INDICES ? make_shared<BPlusTree::Tree>(treeStorage, treeIndices[a]) : make_shared<BPlusTree::Tree>(treeStorage);
+				}));
+			}
+			for (auto&& future : building)
+			{
+				future.get();
+			}
+		}
 
-		if (TWO_ATTRIBUTES)
+		if (runs)
 		{
-			auto treeStorage2 = make_shared<BPlusTree::FileSystemStorageAdapter>(TREE_BLOCK_SIZE, filename(TREE_FILE, 256), true);
-			tree2			  = make_shared<BPlusTree::Tree>(treeStorage2, treeIndex2);
+			// spilled partitions are loaded, and the tree indices are no longer needed
+			runs.reset();
+			vector<vector<pair<number, bytes>>>().swap(treeIndices);
 		}
 
 		{
@@ -700,531 +1386,1001 @@ int main(int argc, char* argv[])
 			// auto treeSize		 = treeStorage->size();
 			auto treeSize = 5.7 * COUNT;
 
-			auto storageSize	 = ORAM_Z * ((1 << ORAM_LOG_CAPACITY) + ORAM_Z) * (ORAM_BLOCK_SIZE + 2 * 16);
-			auto positionMapSize = (((1 << ORAM_LOG_CAPACITY) * ORAM_Z) + ORAM_Z) * sizeof(number);
-			auto stashSize		 = (3 * ORAM_LOG_CAPACITY * ORAM_Z) * ORAM_BLOCK_SIZE;
+			// ORAMs of a size class are all the same size
+			auto storageSize = 0uLL, positionMapSize = 0uLL, stashSize = 0uLL;
+			for (auto c = 0uLL; c < SIZE_CLASSES.size(); c++)
+			{
+				storageSize += SIZE_CLASS_ORAMS * ORAM_Z * ((1 << SIZE_CLASS_LOG_CAPACITIES[c]) + ORAM_Z) * (SIZE_CLASSES[c] + 2 * 16);
+				positionMapSize += SIZE_CLASS_ORAMS * (((1 << SIZE_CLASS_LOG_CAPACITIES[c]) * ORAM_Z) + ORAM_Z) * sizeof(number);
+				stashSize += SIZE_CLASS_ORAMS * (3 * SIZE_CLASS_LOG_CAPACITIES[c] * ORAM_Z) * SIZE_CLASSES[c];
+			}
 
-			if (!TWO_ATTRIBUTES)
+			if (trees.size() == 1)
 			{
 				LOG(INFO, boost::wformat(L"B+ tree size: %s") % bytesToString(treeSize));
 			}
 			else
 			{
-				LOG(INFO, boost::wformat(L"B+ tree size: %s (%s each of two)") % bytesToString(2 * treeSize) % bytesToString(treeSize));
+				LOG(INFO, boost::wformat(L"B+ tree size: %s (%s each of %i)") % bytesToString(trees.size() * treeSize) % bytesToString(treeSize) % trees.size());
 			}
-			LOG(INFO, boost::wformat(L"ORAMs size: %s (each of %i ORAMs occupies %s for position map and %s for stash)") % bytesToString(ORAMS_NUMBER * (positionMapSize + stashSize)) % ORAMS_NUMBER % bytesToString(positionMapSize) % bytesToString(stashSize));
-			LOG(INFO, boost::wformat(L"Remote storage size: %s (each of %i ORAMs occupies %s for storage)") % bytesToString(storageSize * ORAMS_NUMBER) % ORAMS_NUMBER % bytesToString(storageSize));
+			LOG(INFO, boost::wformat(L"ORAMs size: %s (each of %i ORAMs occupies %s for position map and %s for stash on average)") % bytesToString(positionMapSize + stashSize) % ORAMS_NUMBER % bytesToString(positionMapSize / ORAMS_NUMBER) % bytesToString(stashSize / ORAMS_NUMBER));
+			LOG(INFO, boost::wformat(L"Remote storage size: %s (each of %i ORAMs occupies %s for storage on average)") % bytesToString(storageSize) % ORAMS_NUMBER % bytesToString(storageSize / ORAMS_NUMBER));
 		}
 
-		auto orams = transform<ORAMSet, shared_ptr<PathORAM::ORAM>>(oramSets, [](ORAMSet val) { return get<3>(val); });
+		auto orams = transform<ORAMSet, shared_ptr<PathORAM::ORAM>>(oramSets, [](const ORAMSet& val) { return get<3>(val); });
 
 #pragma endregion
 
-#pragma region DP
-
-		// IMPORTANT: salaries are in cents, but we still compute domain in dollars
-		auto DP_DOMAIN = (MAX_VALUE - MIN_VALUE) / 100;
-		if (DP_BUCKETS == 0)
-		{
-			DP_BUCKETS = 1;
-			while (DP_BUCKETS * DP_K <= DP_DOMAIN)
-			{
-				DP_BUCKETS *= DP_K;
-			}
-		}
-
-		if (DP_LEVELS == 0)
-		{
-			auto maxBuckets = (MAX_RANGE * DP_BUCKETS + DP_DOMAIN - 1) / DP_DOMAIN;
-			DP_LEVELS		= max((number)ceil(log(maxBuckets) / log(DP_K)), 1uLL);
-			LOG(INFO, boost::wformat(L"DP_LEVELS is optimally set at %1%, given that biggest query will span at most %2% buckets") % DP_LEVELS % maxBuckets);
-		}
-		else
-		{
-			auto maxLevels = (number)(log(DP_BUCKETS) / log(DP_K));
-			if (DP_LEVELS > maxLevels)
+		// setup Ctrl+C (SIGINT) handler
+		struct sigaction sigIntHandler;
+		sigIntHandler.sa_handler = [](int s) {
+			if (SIGINT_RECEIVED)
 			{
-				DP_LEVELS = maxLevels;
+				LOG(WARNING, L"Second SIGINT caught. Terminating.");
+				exit(1);
 			}
-		}
-
-		auto DP_MU = optimalMu(1.0 / (1 << DP_BETA), DP_K, DP_BUCKETS, DP_EPSILON, DP_LEVELS, DP_USE_GAMMA ? 1 : ORAMS_NUMBER);
-		number DP_MU2;
+			SIGINT_RECEIVED = true;
+			LOG(WARNING, L"SIGINT caught. Will stop processing queries. Ctrl+C again to force-terminate.");
+		};
+		sigemptyset(&sigIntHandler.sa_mask);
+		sigIntHandler.sa_flags = 0;
+		sigaction(SIGINT, &sigIntHandler, NULL);
 
-		LOG_PARAMETER(DP_DOMAIN);
-		LOG_PARAMETER(numberToSalary(MIN_VALUE));
-		LOG_PARAMETER(numberToSalary(MAX_VALUE));
-		LOG_PARAMETER(MAX_RANGE);
-		LOG_PARAMETER(DP_BUCKETS);
-		LOG_PARAMETER(DP_LEVELS);
-		LOG_PARAMETER(DP_MU);
+		// returns tuple<# real records, thread overhead, # of processed requests, partial aggregate of real records (if AGGREGATE)>
+		using queryReturnType = tuple<number, chrono::steady_clock::rep, number, partialAggregate>;
+		using rpcReturnType	  = vector<queryReturnType>;
 
-		if (TWO_ATTRIBUTES)
-		{
-			auto DP_DOMAIN2 = (MAX_VALUE2 - MIN_VALUE2) / 100;
-			if (DP_BUCKETS2 == 0)
+		auto queryRpc = [&rpcClients](number rpcClientId, const vector<pair<number, vector<number>>>& ids, const vector<rangeCondition>& conditions, promise<rpcReturnType>* promise) -> void {
+			rpcReturnType result;
+			if (AGGREGATE != ANone)
 			{
-				DP_BUCKETS2 = 1;
-				while (DP_BUCKETS2 * DP_K <= DP_DOMAIN2)
+				// the RPC host aggregates the records it fetched, and only sends the partial aggregates back
+				auto returned = rpcClients[rpcClientId]->call("runAggregate", ids, conditions, AGGREGATE_FIELD, (number)DATASET_SCHEMA.columns[AGGREGATE_FIELD].encoding).as<vector<tuple<partialAggregate, chrono::steady_clock::rep, number>>>();
+				for (auto&& [aggregate, overhead, processed] : returned)
 				{
-					DP_BUCKETS2 *= DP_K;
+					result.push_back({get<0>(aggregate), overhead, processed, aggregate});
 				}
 			}
-
-			if (DP_LEVELS2 == 0)
-			{
-				auto maxBuckets2 = (MAX_RANGE * DP_BUCKETS2 + DP_DOMAIN2 - 1) / DP_DOMAIN2;
-				DP_LEVELS2		 = max((number)ceil(log(maxBuckets2) / log(DP_K)), 1uLL);
-				LOG(INFO, boost::wformat(L"DP_LEVELS2 is optimally set at %1%, given that biggest query will span at most %2% buckets") % DP_LEVELS2 % maxBuckets2);
-			}
-			else
+			else if (PROJECTED_COLUMNS.size() > 0)
 			{
-				auto maxLevels2 = (number)(log(DP_BUCKETS2) / log(DP_K));
-				if (DP_LEVELS2 > maxLevels2)
+				// the RPC host projects the records it fetched, and only sends the columns back
+				auto returned = rpcClients[rpcClientId]->call("runProjection", ids, conditions, PROJECTED_COLUMNS).as<vector<tuple<projectedValues, chrono::steady_clock::rep, number>>>();
+				for (auto&& [projection, overhead, processed] : returned)
 				{
-					DP_LEVELS2 = maxLevels2;
+					result.push_back({projectedRows(projection), overhead, processed, emptyAggregate()});
 				}
 			}
-
-			DP_MU2 = optimalMu(1.0 / (1 << DP_BETA), DP_K, DP_BUCKETS2, DP_EPSILON, DP_LEVELS2, DP_USE_GAMMA ? 1 : ORAMS_NUMBER);
-
-			LOG_PARAMETER(DP_DOMAIN2);
-			LOG_PARAMETER(numberToSalary(MIN_VALUE2));
-			LOG_PARAMETER(numberToSalary(MAX_VALUE2));
-			LOG_PARAMETER(MAX_RANGE);
-			LOG_PARAMETER(DP_BUCKETS2);
-			LOG_PARAMETER(DP_LEVELS2);
-			LOG_PARAMETER(DP_MU2);
-		}
-
-		LOG(INFO, L"Generating DP noise tree...");
-
-		vector<map<pair<number, number>, number>> noises, noises2;
-		noises.resize(ORAMS_NUMBER);
-		noises2.resize(ORAMS_NUMBER);
-
-		for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
-		{
-			auto buckets = DP_BUCKETS;
-			for (auto l = 0uLL; l < DP_LEVELS; l++)
+			else
 			{
-				for (auto j = 0uLL; j < buckets; j++)
+				auto returned = rpcClients[rpcClientId]->call("runQuery", ids, conditions).as<vector<tuple<vector<bytes>, chrono::steady_clock::rep, number>>>();
+				for (auto&& [records, overhead, processed] : returned)
 				{
-					noises[i][{l, j}] = (int)sampleLaplace(DP_MU, DP_LEVELS / DP_EPSILON);
+					result.push_back({records.size(), overhead, processed, emptyAggregate()});
 				}
-				buckets /= DP_K;
-			}
-
-			if (DP_USE_GAMMA)
-			{
-				// no need for extra noises trees if Gamma is used
-				break;
 			}
-		}
+			promise->set_value(move(result));
+		};
 
-		// count number of nodes in DP tree
-		number dpNodes = 0;
-		for (auto&& dpTree : noises)
+		// per-ORAM request and response buffers, reused across queries
+		struct queryBuffers
 		{
-			dpNodes += dpTree.size();
-		}
-		LOG(INFO, boost::wformat(L"DP tree has %1% elements") % dpNodes);
+			vector<pair<number, bytes>> requests;
+			vector<bytes> answer;
+			bytes record;
+			bytes slot; // a record of a packed block
 
-		if (TWO_ATTRIBUTES)
-		{
-			for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
-			{
-				auto buckets2 = DP_BUCKETS2;
-				for (auto l = 0uLL; l < DP_LEVELS2; l++)
+			// the writes of the updates, padded with reads to the same number in every ORAM
+			vector<pair<number, bytes>> updates;
+		};
+		vector<queryBuffers> buffers(ORAMS_NUMBER);
+
+		// a record is real if it is within the query range (both ranges of a conjunctive query)
+		auto queryOram = [](const vector<number>& ids, const shared_ptr<PathORAM::ORAM>& oram, queryBuffers& buffers, const vector<rangeCondition>& conditions, promise<queryReturnType>* promise) -> queryReturnType {
+			number count   = 0;
+			auto aggregate = emptyAggregate();
+			auto match	   = [&conditions, &count, &aggregate](const bytes& record) {
+				if (matchesConditions(record, conditions))
 				{
-					for (auto j = 0uLL; j < buckets2; j++)
+					count++;
+					if (AGGREGATE != ANone)
 					{
-						noises2[i][{l, j}] = (int)sampleLaplace(DP_MU2, DP_LEVELS2 / DP_EPSILON);
+						aggregateRecord(aggregate, record, AGGREGATE_FIELD, DATASET_SCHEMA.columns[AGGREGATE_FIELD].encoding);
 					}
-					buckets2 /= DP_K;
 				}
-
-				if (DP_USE_GAMMA)
+			};
+			auto matchBlock = [&match, &buffers](const bytes& block) {
+				if (!PACK_RECORDS)
 				{
-					// no need for extra noises trees if Gamma is used
-					break;
+					// the block of a deleted record is blank
+					if (block.size() > 0 && block[0] != '\0')
+					{
+						match(block);
+					}
+					return;
 				}
-			}
-
-			// count number of nodes in DP tree
-			number dpNodes2 = 0;
-			for (auto&& dpTree2 : noises2)
-			{
-				dpNodes2 += dpTree2.size();
-			}
-			LOG(INFO, boost::wformat(L"DP tree 2 has %1% elements") % dpNodes2);
-		}
-
-#pragma endregion
-
-#pragma region QUERY
-
-		LOG(INFO, boost::wformat(L"Running %1% queries...") % queries.size());
-
-		// setup Ctrl+C (SIGINT) handler
-		struct sigaction sigIntHandler;
-		sigIntHandler.sa_handler = [](int s) {
-			if (SIGINT_RECEIVED)
-			{
-				LOG(WARNING, L"Second SIGINT caught. Terminating.");
-				exit(1);
-			}
-			SIGINT_RECEIVED = true;
-			LOG(WARNING, L"SIGINT caught. Will stop processing queries. Ctrl+C again to force-terminate.");
-		};
-		sigemptyset(&sigIntHandler.sa_mask);
-		sigIntHandler.sa_flags = 0;
-		sigaction(SIGINT, &sigIntHandler, NULL);
-
-		// returns tuple<# real records, thread overhead, # of processed requests>
-		using queryReturnType = tuple<number, chrono::steady_clock::rep, number>;
-		using rpcReturnType	  = vector<tuple<vector<bytes>, chrono::steady_clock::rep, number>>;
-
-		auto queryRpc = [&rpcClients](number rpcClientId, const vector<pair<number, vector<number>>>& ids, pair<number, number> query, bool firstAttribute, promise<rpcReturnType>* promise) -> void {
-			auto result = rpcClients[rpcClientId]->call("runQuery", ids, query, TWO_ATTRIBUTES, firstAttribute).as<rpcReturnType>();
-			promise->set_value(result);
-		};
-
-		auto queryOram = [](const vector<number>& ids, shared_ptr<PathORAM::ORAM> oram, number from, number to, bool firstAttribute, promise<queryReturnType>* promise) -> queryReturnType {
-			vector<bytes> answer;
-			number count = 0;
+				for (auto position = 0uLL; nextRecord(block, position, buffers.slot);)
+				{
+					match(buffers.slot);
+				}
+			};
 
 			auto start = chrono::steady_clock::now();
 
-			if (ids.size() > 0)
+			if (ids.size() > 0 || buffers.updates.size() > 0)
 			{
 				if (USE_ORAM_OPTIMIZATION)
 				{
-					answer.reserve(ids.size());
-					vector<pair<number, bytes>> requests;
-					requests.resize(ids.size());
+					// the writes go first, so that the query reads the records as updated
+					buffers.requests.clear();
+					buffers.answer.clear();
+					buffers.requests.insert(buffers.requests.end(), buffers.updates.begin(), buffers.updates.end());
+					for (auto&& id : ids)
+					{
+						buffers.requests.emplace_back(id, bytes());
+					}
+					oram->multiple(buffers.requests, buffers.answer);
 
-					transform(ids.begin(), ids.end(), requests.begin(), [](number id) { return make_pair(id, bytes()); });
-					oram->multiple(requests, answer);
+					for (auto block = buffers.answer.end() - ids.size(); block != buffers.answer.end(); block++)
+					{
+						matchBlock(*block);
+					}
 				}
 				else
 				{
-					for (auto&& id : ids)
+					for (auto&& [id, data] : buffers.updates)
 					{
-						bytes record;
-						oram->get(id, record);
-						auto text = PathORAM::toText(record, ORAM_BLOCK_SIZE);
-
-						number salary;
-						if (TWO_ATTRIBUTES)
+						if (data.size() > 0)
 						{
-							vector<string> salaries;
-							boost::algorithm::split(salaries, text, boost::is_any_of(","));
-							salary = salaryToNumber(salaries[firstAttribute ? 0 : 1]);
+							oram->put(id, data);
 						}
 						else
 						{
-							salary = salaryToNumber(text);
-						}
-
-						if (salary >= from && salary <= to)
-						{
-							count++;
+							oram->get(id, buffers.record);
 						}
 					}
-				}
-			}
-
-			if (USE_ORAM_OPTIMIZATION)
-			{
-				for (auto&& record : answer)
-				{
-					auto text = PathORAM::toText(record, ORAM_BLOCK_SIZE);
-
-					number salary;
-					if (TWO_ATTRIBUTES)
-					{
-						vector<string> salaries;
-						boost::algorithm::split(salaries, text, boost::is_any_of(","));
-						salary = salaryToNumber(salaries[firstAttribute ? 0 : 1]);
-					}
-					else
+					for (auto&& id : ids)
 					{
-						salary = salaryToNumber(text);
-					}
+						oram->get(id, buffers.record);
 
-					if (salary >= from && salary <= to)
-					{
-						count++;
+						matchBlock(buffers.record);
 					}
 				}
+				buffers.updates.clear();
 			}
 
 			auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
 
 			if (promise != NULL)
 			{
-				promise->set_value({count, elapsed, ids.size()});
+				promise->set_value({count, elapsed, ids.size(), aggregate});
 			}
 
-			return {count, elapsed, ids.size()};
+			return {count, elapsed, ids.size(), aggregate};
 		};
 
-		for (auto query : queries)
+		if (!VIRTUAL_REQUESTS && rpcClients.size() == 0)
 		{
-			auto firstAttribute = QUERY_MULTIPLE == QMultiple ? (queryIndex % 2) : (QUERY_MULTIPLE == QFirst);
-
-			auto start = chrono::steady_clock::now();
-
-			if (PROFILE_STORAGE_REQUESTS)
+			for (auto i = 0uLL; i < oramSets.size(); i++)
 			{
-				profiles.clear();
+				// position maps are copied straight into the snapshot when it is written
+				auto positionMap = static_pointer_cast<SnapshotPositionMapAdapter>(get<1>(oramSets[i]));
+				snapshotWriter.add(SnapshotPositionMap, i, positionMap->size() * sizeof(number), [positionMap](uchar* destination) {
+					memcpy(destination, positionMap->data(), positionMap->size() * sizeof(number));
+				});
+				snapshotWriter.add(SnapshotStash, i, [stash = get<2>(oramSets[i]), blockSize = SIZE_CLASSES[i / SIZE_CLASS_ORAMS]]() { return stashToSection(stash, blockSize); });
+				snapshotWriter.add(SnapshotKey, i, oramKeys[i]);
 			}
+		}
 
-			number realRecordsNumber  = 0;
-			number totalRecordsNumber = 0;
-			number fastestThread	  = 0;
-
-			// DP padding
-			auto [fromBucket, toBucket, from, to] = padToBuckets(
-				query,
-				firstAttribute ? MIN_VALUE : MIN_VALUE2,
-				firstAttribute ? MAX_VALUE : MAX_VALUE2,
-				firstAttribute ? DP_BUCKETS : DP_BUCKETS2);
+		// the cost model of simulation, calibrated on this machine if requested
+		hardwareProfile simulation;
+		if (SIMULATE)
+		{
+			simulation.roundTrip   = SIM_ROUND_TRIP * 1000;
+			simulation.bandwidth   = SIM_BANDWIDTH * 1024 * 1024;
+			simulation.byteCost	   = SIM_BYTE_COST;
+			simulation.parallelism = SIM_PARALLELISM;
+			simulation.batchSize   = BATCH_SIZE;
 
-			if (from < (firstAttribute ? MIN_VALUE : MIN_VALUE2) || to > (firstAttribute ? MAX_VALUE : MAX_VALUE2))
+			if (SIM_CALIBRATE)
 			{
-				LOG(ERROR, L"Query endpoints are out of bounds, did you use correct queryset tag?");
+				calibrateClient(simulation, ORAM_BLOCK_SIZE, ORAM_Z);
+				SIM_BYTE_COST = simulation.byteCost;
+				LOG(INFO, boost::wformat(L"Calibrated client work: %1% ns per byte") % SIM_BYTE_COST);
 			}
+		}
 
-			vector<bytes> oramsAndBlocks;
-			(firstAttribute ? tree : tree2)->search(from, to, oramsAndBlocks);
-
-			// DP add noise
-			auto noiseNodes = BRC(DP_K, fromBucket, toBucket);
-			for (auto node : noiseNodes)
+		// reused across queries, so that steady state queries do not allocate them
+		vector<vector<number>> blockIds(ORAMS_NUMBER);
+		vector<number> perOram(ORAMS_NUMBER);
+		vector<bytes> oramsAndBlocks;
+		vector<chrono::steady_clock::rep> threadOverheads;
+		vector<number> threadAnswerSizes;
+
+		// noises[a][i] is the DP noise tree of indexed column a for ORAM i
+		vector<vector<map<pair<number, number>, number>>> noises(trees.size(), vector<map<pair<number, number>, number>>(ORAMS_NUMBER));
+
+		// conjunctive queries: tuple<level, bucket, level2, bucket2> nodes of the product of the two trees
+		vector<map<tuple<number, number, number, number>, number>> noisesGrid(ORAMS_NUMBER);
+		vector<bytes> oramsAndBlocks2, intersection;
+		vector<rangeCondition> conditions;
+		auto noiseSampled		= false;
+		number noiseSampledWith = 0;
+
+		// an update changes the overlay and the bounds at once, its ORAM writes go out with the next query;
+		// the record goes to an ORAM of its size class, as ingestion would assign it
+		auto nextUpdate = 0uLL;
+		map<string, number> applied;
+		auto applyUpdate = [&overlay, &buffers](const tuple<string, number, string>& update) -> void {
+			auto& [operation, id, record] = update;
+
+			vector<number> values;
+			auto sizeClass = 0uLL;
+			if (operation != "delete")
 			{
-				if (node.first >= (firstAttribute ? DP_LEVELS : DP_LEVELS2))
+				auto data = bytes(record.begin(), record.end());
+				for (auto&& field : DATASET_SCHEMA.indexed)
+				{
+					values.push_back(encodeValue(textFromRecord(data, field), DATASET_SCHEMA.columns[field].encoding));
+				}
+
+				sizeClass = upper_bound(SIZE_CLASSES.begin(), SIZE_CLASSES.end(), record.size()) - SIZE_CLASSES.begin();
+				if (sizeClass == SIZE_CLASSES.size())
 				{
-					LOG(CRITICAL, boost::wformat(L"DP tree is not high enough. Level %1% is not generated. Buckets [%2%, %3%], endpoints (%4%, %5%).") % node.first % fromBucket % toBucket % numberToSalary(from) % numberToSalary(to));
+					throw Exception(boost::format("Record of %1% bytes does not fit the largest size class of %2%") % record.size() % SIZE_CLASSES.back());
 				}
 			}
 
-			// add real block IDs
-			vector<vector<number>> blockIds;
-			blockIds.resize(ORAMS_NUMBER);
-			for (auto&& pair : oramsAndBlocks)
-			{
-				auto fromTree = BPlusTree::deconstructNumbers(pair);
-				auto oramId	  = fromTree[0];
-				auto blockId  = fromTree[1];
+			// the freed block is blanked, so that fake requests never read the deleted record
+			auto blank = [&buffers](pair<number, number> freed) {
+				buffers[freed.first].updates.push_back({freed.second, bytes(SIZE_CLASSES[freed.first / SIZE_CLASS_ORAMS], 0)});
+			};
 
-				blockIds[oramId].push_back(blockId);
+			if (operation == "delete")
+			{
+				blank(overlay->remove(id));
 			}
-
-			auto totalNoise = 0uLL;
-			if (DP_USE_GAMMA)
+			else
 			{
-				auto kZeroTilda = oramsAndBlocks.size();
-				for (auto node : noiseNodes)
+				auto first = sizeClass * SIZE_CLASS_ORAMS;
+				auto oram  = first;
+				if (PARTITIONING == PValue)
 				{
-					kZeroTilda += (firstAttribute ? noises : noises2)[0][node];
+					oram += PathORAM::hashToNumber(BPlusTree::bytesFromNumber(values[0]), SIZE_CLASS_ORAMS);
 				}
-				if (kZeroTilda == 0)
+				else
 				{
-					LOG(CRITICAL, L"Something is wrong, kZeroTilda cannot be 0.");
+					for (auto i = first; i < first + SIZE_CLASS_ORAMS; i++)
+					{
+						oram = overlay->live(i) < overlay->live(oram) ? i : oram;
+					}
 				}
 
-				auto maxRecords = gammaNodes(ORAMS_NUMBER, 1.0 / (1 << DP_BETA), kZeroTilda);
-
-				for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+				// an update takes its new block before the old one is freed, so a full ORAM leaves the record as it was
+				number block;
+				if (operation == "insert")
 				{
-					auto extra = blockIds[i].size() < maxRecords ? maxRecords - blockIds[i].size() : 0;
-					addFakeRequests(blockIds[i], oramBlockNumbers[i], extra);
-					totalNoise += extra;
+					block = overlay->insert(values, oram).second;
 				}
-			}
-			else
-			{
-				// add noisy fake block IDs
-				for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+				else
 				{
-					for (auto node : noiseNodes)
+					auto [freed, moved] = overlay->update(id, values, oram);
+					block				= moved;
+					if (freed != make_pair(oram, block))
 					{
-						addFakeRequests(blockIds[i], oramBlockNumbers[i], (firstAttribute ? noises : noises2)[i][node]);
-						totalNoise += (firstAttribute ? noises : noises2)[i][node];
+						blank(freed);
 					}
 				}
+				buffers[oram].updates.push_back({block, PathORAM::fromText(record, SIZE_CLASSES[sizeClass])});
+
+				for (auto a = 0uLL; a < values.size(); a++)
+				{
+					MIN_VALUES[a] = min(values[a], MIN_VALUES[a]);
+					MAX_VALUES[a] = max(values[a], MAX_VALUES[a]);
+				}
 			}
+		};
 
-			totalRecordsNumber = 0;
-			for (auto&& blocks : blockIds)
+		// a sweep runs every configuration on the dataset, tree and ORAMs loaded once;
+		// only the DP tree is rebuilt for each, and its noise only if the DP parameters change
+		for (auto configuration = 0uLL; configuration < max((number)configurations.size(), 1uLL); configuration++)
+		{
+			if (configurations.size() > 0)
 			{
-				totalRecordsNumber += blocks.size();
-			}
+				// the options a configuration does not set take their command line values
+				po::variables_map configurationVm;
+				po::store(po::command_line_parser(configurations[configuration]).options(sweepDescription).run(), configurationVm);
+				po::notify(configurationVm);
+				bucketsNumberCheck(DP_BUCKETS);
+
+				SWEEP_CONFIGURATION = configuration;
 
-			LOG(TRACE, boost::wformat(L"Query {%9.2f, %9.2f} was transformed to {%9.2f, %9.2f}, buckets [%4i, %4i], added total of %4i noisy records") % numberToSalary(query.first) % numberToSalary(query.second) % numberToSalary(from) % numberToSalary(to) % fromBucket % toBucket % totalNoise);
+				LOG(INFO, boost::wformat(L"Sweep configuration %1% / %2%: %3%") % (configuration + 1) % configurations.size() % toWString(boost::algorithm::join(configurations[configuration], " ")));
+			}
 
-			chrono::steady_clock::time_point timestampBeforeORAMs;
-			chrono::steady_clock::time_point timestampAfterORAMs;
+#pragma region DP
 
-			if (!VIRTUAL_REQUESTS)
+			// every indexed column has its own DP tree; the first one is set by the options (as with a single column),
+			// the others take the same fanout and choose buckets (and levels, unless given) for their domains
+			vector<number> dpBuckets(trees.size()), dpLevels(trees.size()), dpMus(trees.size());
+			auto levelsOption = DP_LEVELS;
+			for (auto a = 0uLL; a < trees.size(); a++)
 			{
-				vector<chrono::steady_clock::rep> threadOverheads;
-				vector<number> threadAnswerSizes;
-
-				if (RPC_HOSTS.size() > 0)
+				// IMPORTANT: values are encoded (e.g. salaries in cents), but we still compute domain in values (dollars)
+				auto DP_DOMAIN = (MAX_VALUES[a] - MIN_VALUES[a]) / encodingScale(encoding(a));
+				auto buckets   = a == 0 ? DP_BUCKETS : 0uLL;
+				if (buckets == 0)
 				{
-					thread threads[RPC_HOSTS.size()];
-					promise<rpcReturnType> promises[RPC_HOSTS.size()];
-					future<rpcReturnType> futures[RPC_HOSTS.size()];
-
-					timestampBeforeORAMs = chrono::steady_clock::now();
-
-					for (auto rpcHostId = 0uLL; rpcHostId < RPC_HOSTS.size(); rpcHostId++)
+					buckets = 1;
+					while (buckets * DP_K <= DP_DOMAIN)
 					{
-						vector<pair<number, vector<number>>> ids;
-						for (auto oramId = 0uLL; oramId < oramToRpcMap.size(); oramId++)
-						{
-							if (oramToRpcMap[oramId] == rpcHostId)
-							{
-								ids.push_back({oramId, blockIds[oramId]});
-							}
-						}
-
-						futures[rpcHostId] = promises[rpcHostId].get_future();
-						threads[rpcHostId] = thread(queryRpc, rpcHostId, ids, query, firstAttribute, &promises[rpcHostId]);
+						buckets *= DP_K;
 					}
+				}
 
-					for (auto i = 0uLL; i < RPC_HOSTS.size(); i++)
-					{
-						auto returned = futures[i].get();
-						for (auto&& threadRunResult : returned)
+				auto levels = levelsOption;
+				if (levels == 0)
+				{
+					auto maxBuckets = max((MAX_RANGES[a] * buckets + DP_DOMAIN - 1) / max(DP_DOMAIN, 1uLL), 1uLL);
+					levels			= max((number)ceil(log(maxBuckets) / log(DP_K)), 1uLL);
+					LOG(INFO, boost::wformat(L"DP levels of column %1% are optimally set at %2%, given that biggest query will span at most %3% buckets") % toWString(DATASET_SCHEMA.columns[DATASET_SCHEMA.indexed[a]].name) % levels % maxBuckets);
+				}
+				else
+				{
+					auto maxLevels = floorLog(DP_K, buckets);
+					if (levels > maxLevels)
+					{
+						levels = maxLevels;
+					}
+				}
+
+				dpBuckets[a] = buckets;
+				dpLevels[a]	 = levels;
+				dpMus[a]	 = optimalMu(1.0 / (1 << DP_BETA), DP_K, buckets, DP_EPSILON, levels, DP_USE_GAMMA ? SIZE_CLASSES.size() : ORAMS_NUMBER);
+
+				if (a == 0)
+				{
+					DP_BUCKETS = buckets;
+					DP_LEVELS  = levels;
+
+					LOG_PARAMETER(DP_DOMAIN);
+					LOG_PARAMETER(numberToSalary(MIN_VALUES[0]));
+					LOG_PARAMETER(numberToSalary(MAX_VALUES[0]));
+					LOG_PARAMETER(MAX_RANGES[0]);
+					LOG_PARAMETER(DP_BUCKETS);
+					LOG_PARAMETER(DP_LEVELS);
+					LOG_PARAMETER(dpMus[0]);
+				}
+				else
+				{
+					LOG(INFO, boost::wformat(L"Column %1%: domain %2%, max range %3%, buckets %4%, levels %5%, mu %6%") % toWString(DATASET_SCHEMA.columns[DATASET_SCHEMA.indexed[a]].name) % DP_DOMAIN % MAX_RANGES[a] % buckets % levels % dpMus[a]);
+				}
+			}
+			auto DP_MU = dpMus[0];
+			number DP_MU_GRID;
+
+			if (QUERY_MULTIPLE == QBoth)
+			{
+				// the grid is the product of the two trees, a record is in the product of their levels of its nodes
+				DP_MU_GRID = optimalMu2D(1.0 / (1 << DP_BETA), DP_K, dpBuckets[QUERY_ATTRIBUTES[0]], dpBuckets[QUERY_ATTRIBUTES[1]], DP_EPSILON, dpLevels[QUERY_ATTRIBUTES[0]], dpLevels[QUERY_ATTRIBUTES[1]], DP_USE_GAMMA ? SIZE_CLASSES.size() : ORAMS_NUMBER);
+
+				LOG_PARAMETER(DP_MU_GRID);
+			}
+
+			// the stored noise is reused as long as it was sampled with the same DP parameters,
+			// and so is the noise of the previous sweep configuration
+			vector<string> noiseParameters{to_string(DP_K), to_string(DP_BETA), to_string(DP_EPSILON), to_string(DP_USE_GAMMA), to_string(DP_BUCKETS), to_string(DP_LEVELS), to_string(DP_MU)};
+			for (auto a = 1uLL; a < trees.size(); a++)
+			{
+				noiseParameters.insert(noiseParameters.end(), {to_string(dpBuckets[a]), to_string(dpLevels[a])});
+			}
+			auto noiseFingerprint = fingerprint(noiseParameters);
+			auto keepNoise		  = noiseSampled && noiseSampledWith == noiseFingerprint;
+			auto reuseNoise		  = !noiseSampled && snapshot && snapshot->has(SnapshotNoiseParameters) && snapshot->values<number>(SnapshotNoiseParameters) == vector<number>{noiseFingerprint};
+			noiseSampled		  = true;
+			noiseSampledWith	  = noiseFingerprint;
+
+			auto generateNoise = [&noises, &dpBuckets, &dpLevels, &dpMus](number a) {
+				for (auto&& dpTree : noises[a])
+				{
+					dpTree.clear();
+				}
+				for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+				{
+					if (DP_USE_GAMMA && i % SIZE_CLASS_ORAMS != 0)
+					{
+						// no need for extra noises trees if Gamma is used, only one for each size class
+						continue;
+					}
+
+					auto buckets = dpBuckets[a];
+					for (auto l = 0uLL; l < dpLevels[a]; l++)
+					{
+						for (auto j = 0uLL; j < buckets; j++)
 						{
-							realRecordsNumber += get<0>(threadRunResult).size();
-							threadOverheads.push_back(get<1>(threadRunResult));
-							threadAnswerSizes.push_back(get<2>(threadRunResult));
+							noises[a][i][{l, j}] = (int)sampleLaplace(dpMus[a], dpLevels[a] / DP_EPSILON);
 						}
-						threads[i].join();
+						buckets /= DP_K;
 					}
+				}
+			};
+
+			if (keepNoise)
+			{
+				LOG(INFO, L"Keeping DP noise trees of the previous configuration");
+			}
+			else
+			{
+				if (reuseNoise)
+				{
+					LOG(INFO, L"Reading DP noise tree from snapshot...");
 
-					timestampAfterORAMs = chrono::steady_clock::now();
+					for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+					{
+						if (!snapshot->has(SnapshotNoise, i))
+						{
+							continue;
+						}
+
+						// tuple<level, bucket, noise> in tree order
+						auto nodes = snapshot->values<number>(SnapshotNoise, i);
+						for (auto j = 0uLL; j + 2 < nodes.size(); j += 3)
+						{
+							noises[0][i].emplace_hint(noises[0][i].end(), make_pair(nodes[j], nodes[j + 1]), nodes[j + 2]);
+						}
+					}
+				}
+
+				LOG(INFO, L"Generating DP noise trees...");
+
+				// the trees are independent, so they are sampled in parallel
+				vector<future<void>> sampling;
+				for (auto a = reuseNoise ? 1uLL : 0uLL; a < noises.size(); a++)
+				{
+					sampling.push_back(async(launch::async, generateNoise, a));
 				}
-				else if (PARALLEL)
+				for (auto&& done : sampling)
 				{
-					thread threads[ORAMS_NUMBER];
-					promise<queryReturnType> promises[ORAMS_NUMBER];
-					future<queryReturnType> futures[ORAMS_NUMBER];
+					done.get();
+				}
 
-					timestampBeforeORAMs = chrono::steady_clock::now();
+				// the grid has the product of the buckets of both trees as leaves, too many to sample upfront;
+				// a node is sampled the first time a query covers it and is fixed from then on
+				for (auto&& grid : noisesGrid)
+				{
+					grid.clear();
+				}
+			}
 
-					for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+			// only the first column tree is stored, the others are sampled again;
+			// an ORAM without a tree in this configuration (e.g. with Gamma) must not keep the one of a previous configuration
+			snapshotWriter.add(SnapshotNoiseParameters, 0, vector<number>{noiseFingerprint});
+			for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+			{
+				if (noises[0][i].size() == 0)
+				{
+					snapshotWriter.remove(SnapshotNoise, i);
+					continue;
+				}
+
+				vector<number> nodes;
+				nodes.reserve(noises[0][i].size() * 3);
+				for (auto&& [node, noise] : noises[0][i])
+				{
+					nodes.insert(nodes.end(), {node.first, node.second, noise});
+				}
+				snapshotWriter.add(SnapshotNoise, i, nodes);
+			}
+
+			// count number of nodes in DP trees
+			for (auto a = 0uLL; a < noises.size(); a++)
+			{
+				number dpNodes = 0;
+				for (auto&& dpTree : noises[a])
+				{
+					dpNodes += dpTree.size();
+				}
+				LOG(INFO, boost::wformat(L"DP tree of column %1% has %2% elements") % toWString(DATASET_SCHEMA.columns[DATASET_SCHEMA.indexed[a]].name) % dpNodes);
+			}
+
+#pragma endregion
+
+#pragma region QUERY
+
+			LOG(INFO, boost::wformat(L"Running %1% queries...") % queries.size());
+
+			// checkpoints are deltas on top of a snapshot, so one is taken before the first query;
+			// only the changes are captured on this thread, the journal is written in the background
+			unique_ptr<CheckpointJournal> checkpoints;
+			vector<StateTracker> trackers;
+			auto queriesSinceCheckpoint = 0uLL;
+			auto lastCheckpoint			= chrono::steady_clock::now();
+			if ((CHECKPOINT_QUERIES > 0 || CHECKPOINT_SECONDS > 0) && !VIRTUAL_REQUESTS && rpcClients.size() == 0)
+			{
+				LOG(INFO, L"Saving client state snapshot for checkpoints");
+
+				// a journal left from before must not be replayed on top of the new snapshot,
+				// it is removed only once the new snapshot is on disk, so a crash in between loses no checkpoints
+				snapshotWriter.add(SnapshotGeneration, 0, vector<number>{++generation});
+				snapshotWriter.write(filename(SNAPSHOT_FILE, -1));
+				boost::filesystem::remove(filename(JOURNAL_FILE, -1));
+
+				checkpoints = make_unique<CheckpointJournal>(filename(JOURNAL_FILE, -1), generation, ORAM_BLOCK_SIZE);
+				for (auto i = 0uLL; i < oramSets.size(); i++)
+				{
+					trackers.emplace_back(static_pointer_cast<SnapshotPositionMapAdapter>(get<1>(oramSets[i])), get<2>(oramSets[i]));
+				}
+				lastCheckpoint = chrono::steady_clock::now();
+			}
+
+			// the locators of a record are the same in all trees,
+			// so a conjunctive query matches the locators found in both
+			auto search = [&trees, &overlay, &oramsAndBlocks2, &intersection](number attribute, number from, number to, number attribute2, number from2, number to2, vector<bytes>& result) {
+				trees[attribute]->search(from, to, result);
+				if (overlay)
+				{
+					overlay->search(attribute, from, to, result);
+				}
+				if (QUERY_MULTIPLE == QBoth)
+				{
+					oramsAndBlocks2.clear();
+					intersection.clear();
+					trees[attribute2]->search(from2, to2, oramsAndBlocks2);
+					if (overlay)
+					{
+						overlay->search(attribute2, from2, to2, oramsAndBlocks2);
+					}
+
+					sort(result.begin(), result.end());
+					sort(oramsAndBlocks2.begin(), oramsAndBlocks2.end());
+					set_intersection(result.begin(), result.end(), oramsAndBlocks2.begin(), oramsAndBlocks2.end(), back_inserter(intersection));
+					result.swap(intersection);
+				}
+			};
+
+			// sampled on first use, see the DP region
+			auto gridNoise = [&noisesGrid, &DP_MU_GRID, &dpLevels](number oram, pair<number, number> node, pair<number, number> node2) -> number {
+				auto [it, inserted] = noisesGrid[oram].try_emplace({node.first, node.second, node2.first, node2.second}, 0);
+				if (inserted)
+				{
+					it->second = (int)sampleLaplace(DP_MU_GRID, dpLevels[QUERY_ATTRIBUTES[0]] * dpLevels[QUERY_ATTRIBUTES[1]] / DP_EPSILON);
+				}
+				return it->second;
+			};
+
+			for (auto queryNumber = 0uLL; queryNumber < queries.size(); queryNumber++)
+			{
+				if (nextUpdate < updates.size())
+				{
+					for (auto last = min(nextUpdate + UPDATES_BATCH, (number)updates.size()); nextUpdate < last; nextUpdate++)
 					{
-						futures[i] = promises[i].get_future();
-						threads[i] = thread(queryOram, blockIds[i], orams[i], query.first, query.second, firstAttribute, &promises[i]);
+						try
+						{
+							applyUpdate(updates[nextUpdate]);
+							applied[get<0>(updates[nextUpdate])]++;
+						}
+						catch (const Exception& e)
+						{
+							LOG(WARNING, boost::wformat(L"Update %1% is skipped: %2%") % nextUpdate % toWString(e.what()));
+							applied["skipped"]++;
+						}
 					}
 
+					// every ORAM makes as many accesses for the updates, and fake requests cover the inserted blocks
+					auto most = 0uLL;
+					for (auto&& oramBuffers : buffers)
+					{
+						most = max(most, (number)oramBuffers.updates.size());
+					}
 					for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
 					{
-						auto returned = futures[i].get();
-						realRecordsNumber += get<0>(returned);
-						threadOverheads.push_back(get<1>(returned));
-						threadAnswerSizes.push_back(get<2>(returned));
-						threads[i].join();
+						for (auto j = buffers[i].updates.size(); j < most; j++)
+						{
+							buffers[i].updates.push_back({j % max(overlay->used(i), 1uLL), bytes()});
+						}
+						oramBlockNumbers[i] = overlay->used(i);
 					}
+				}
 
-					timestampAfterORAMs = chrono::steady_clock::now();
+				auto query		 = queries[queryNumber];
+				auto conjunctive = QUERY_MULTIPLE == QBoth;
+				auto query2		 = conjunctive ? queries2[queryNumber] : query;
+				auto attribute	 = queryAttribute(queryNumber);
+				auto attribute2	 = conjunctive ? QUERY_ATTRIBUTES[1] : attribute;
+
+				auto start = chrono::steady_clock::now();
+	#ifdef TESTING
+				auto allocationsBefore = ALLOCATIONS.load();
+	#endif
+
+				if (PROFILE_STORAGE_REQUESTS)
+				{
+					profiles.clear();
 				}
-				else
+
+				number realRecordsNumber  = 0;
+				number totalRecordsNumber = 0;
+				number fastestThread	  = 0;
+				auto aggregate			  = emptyAggregate();
+
+				// DP padding
+				auto [fromBucket, toBucket, from, to] = padToBuckets(query, MIN_VALUES[attribute], MAX_VALUES[attribute], dpBuckets[attribute]);
+
+				auto [fromBucket2, toBucket2, from2, to2] = conjunctive ? padToBuckets(query2, MIN_VALUES[attribute2], MAX_VALUES[attribute2], dpBuckets[attribute2]) : make_tuple(0uLL, 0uLL, 0uLL, 0uLL);
+
+				if (from < MIN_VALUES[attribute] || to > MAX_VALUES[attribute] || (conjunctive && (from2 < MIN_VALUES[attribute2] || to2 > MAX_VALUES[attribute2])))
+				{
+					LOG(ERROR, L"Query endpoints are out of bounds, did you use correct queryset tag?");
+				}
+
+				oramsAndBlocks.clear();
+				search(attribute, from, to, attribute2, from2, to2, oramsAndBlocks);
+
+				// the records are filtered by the columns they are queried on
+				conditions.clear();
+				conditions.push_back({DATASET_SCHEMA.indexed[attribute], encoding(attribute), query.first, query.second});
+				if (conjunctive)
 				{
-					timestampBeforeORAMs = chrono::steady_clock::now();
+					conditions.push_back({DATASET_SCHEMA.indexed[attribute2], encoding(attribute2), query2.first, query2.second});
+				}
+
+				// DP add noise
+				auto noiseNodes = BRC(DP_K, fromBucket, toBucket);
+				for (auto node : noiseNodes)
+				{
+					if (node.first >= dpLevels[attribute])
+					{
+						LOG(CRITICAL, boost::wformat(L"DP tree is not high enough. Level %1% is not generated. Buckets [%2%, %3%], endpoints (%4%, %5%).") % node.first % fromBucket % toBucket % numberToSalary(from) % numberToSalary(to));
+					}
+				}
+
+				// a conjunctive query covers the rectangle with the pairs of the nodes of both decompositions
+				auto noiseNodes2 = conjunctive ? BRC2D(DP_K, fromBucket, toBucket, fromBucket2, toBucket2) : decltype(BRC2D(0, 0, 0, 0, 0))();
+				for (auto&& [node, node2] : noiseNodes2)
+				{
+					if (node2.first >= dpLevels[attribute2])
+					{
+						LOG(CRITICAL, boost::wformat(L"DP tree 2 is not high enough. Level %1% is not generated. Buckets [%2%, %3%], endpoints (%4%, %5%).") % node2.first % fromBucket2 % toBucket2 % numberToSalary(from2) % numberToSalary(to2));
+					}
+				}
+
+				auto decompositionNoise = [&](number oram) -> number {
+					auto noise = 0uLL;
+					if (conjunctive)
+					{
+						for (auto&& [node, node2] : noiseNodes2)
+						{
+							noise += gridNoise(oram, node, node2);
+						}
+					}
+					else
+					{
+						for (auto&& node : noiseNodes)
+						{
+							noise += noises[attribute][oram][node];
+						}
+					}
+					return noise;
+				};
+
+				// add real block IDs
+				for (auto&& ids : blockIds)
+				{
+					ids.clear();
+				}
+				for (auto&& pair : oramsAndBlocks)
+				{
+					auto fromTree = BPlusTree::deconstructNumbers(pair);
+					auto oramId	  = fromTree[0];
+					auto blockId  = fromTree[1];
+
+					blockIds[oramId].push_back(blockId);
+				}
+
+				if (PACK_RECORDS)
+				{
+					// records share blocks, and a block is fetched (and counted for DP padding) once
+					for (auto&& ids : blockIds)
+					{
+						sort(ids.begin(), ids.end());
+						ids.erase(unique(ids.begin(), ids.end()), ids.end());
+					}
+				}
+
+				auto totalNoise = 0uLL;
+				if (DP_USE_GAMMA)
+				{
+					// each size class is padded on its own, as it has its own noise tree
+					for (auto first = 0uLL; first < ORAMS_NUMBER; first += SIZE_CLASS_ORAMS)
+					{
+						auto realBlocks = 0uLL;
+						for (auto i = first; i < first + SIZE_CLASS_ORAMS; i++)
+						{
+							realBlocks += blockIds[i].size();
+						}
+
+						auto kZeroTilda = realBlocks + decompositionNoise(first);
+						if (kZeroTilda == 0)
+						{
+							LOG(CRITICAL, L"Something is wrong, kZeroTilda cannot be 0.");
+						}
 
+						auto maxRecords = gammaNodes(SIZE_CLASS_ORAMS, 1.0 / (1 << DP_BETA), kZeroTilda);
+
+						for (auto i = first; i < first + SIZE_CLASS_ORAMS; i++)
+						{
+							auto extra = blockIds[i].size() < maxRecords ? maxRecords - blockIds[i].size() : 0;
+							addFakeRequests(blockIds[i], oramBlockNumbers[i], extra);
+							totalNoise += extra;
+						}
+					}
+				}
+				else
+				{
+					// add noisy fake block IDs
 					for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
 					{
-						auto returned = queryOram(blockIds[i], orams[i], query.first, query.second, firstAttribute, NULL);
-						realRecordsNumber += get<0>(returned);
-						threadOverheads.push_back(get<1>(returned));
-						threadAnswerSizes.push_back(get<2>(returned));
+						auto noise = decompositionNoise(i);
+						addFakeRequests(blockIds[i], oramBlockNumbers[i], noise);
+						totalNoise += noise;
 					}
+				}
 
-					timestampAfterORAMs = chrono::steady_clock::now();
+				totalRecordsNumber = 0;
+				for (auto&& blocks : blockIds)
+				{
+					totalRecordsNumber += blocks.size();
 				}
 
-				auto queryOverheadBefore = chrono::duration_cast<chrono::nanoseconds>(timestampBeforeORAMs - start).count();
-				auto queryOverheadORAMs	 = chrono::duration_cast<chrono::nanoseconds>(timestampAfterORAMs - timestampBeforeORAMs).count();
-				auto queryOverheadAfter	 = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - timestampAfterORAMs).count();
+				LOG(TRACE, boost::wformat(L"Query {%9.2f, %9.2f} was transformed to {%9.2f, %9.2f}, buckets [%4i, %4i], added total of %4i noisy records") % numberToSalary(query.first) % numberToSalary(query.second) % numberToSalary(from) % numberToSalary(to) % fromBucket % toBucket % totalNoise);
+
+				chrono::steady_clock::time_point timestampBeforeORAMs;
+				chrono::steady_clock::time_point timestampAfterORAMs;
+
+				if (!VIRTUAL_REQUESTS)
+				{
+					threadOverheads.clear();
+					threadAnswerSizes.clear();
+
+					if (RPC_HOSTS.size() > 0)
+					{
+						thread threads[RPC_HOSTS.size()];
+						promise<rpcReturnType> promises[RPC_HOSTS.size()];
+						future<rpcReturnType> futures[RPC_HOSTS.size()];
+
+						timestampBeforeORAMs = chrono::steady_clock::now();
+
+						for (auto rpcHostId = 0uLL; rpcHostId < RPC_HOSTS.size(); rpcHostId++)
+						{
+							vector<pair<number, vector<number>>> ids;
+							for (auto oramId = 0uLL; oramId < oramToRpcMap.size(); oramId++)
+							{
+								if (oramToRpcMap[oramId] == rpcHostId)
+								{
+									// block IDs are not used after this point
+									ids.push_back({oramId, move(blockIds[oramId])});
+								}
+							}
+
+							futures[rpcHostId] = promises[rpcHostId].get_future();
+							threads[rpcHostId] = thread(queryRpc, rpcHostId, move(ids), cref(conditions), &promises[rpcHostId]);
+						}
+
+						for (auto i = 0uLL; i < RPC_HOSTS.size(); i++)
+						{
+							auto returned = futures[i].get();
+							for (auto&& threadRunResult : returned)
+							{
+								realRecordsNumber += get<0>(threadRunResult);
+								mergeAggregates(aggregate, get<3>(threadRunResult));
+								threadOverheads.push_back(get<1>(threadRunResult));
+								threadAnswerSizes.push_back(get<2>(threadRunResult));
+							}
+							threads[i].join();
+						}
+
+						timestampAfterORAMs = chrono::steady_clock::now();
+					}
+					else if (PARALLEL)
+					{
+						thread threads[ORAMS_NUMBER];
+						promise<queryReturnType> promises[ORAMS_NUMBER];
+						future<queryReturnType> futures[ORAMS_NUMBER];
+
+						timestampBeforeORAMs = chrono::steady_clock::now();
 
-				auto threadOverheadsMinIndex = min_element(threadOverheads.begin(), threadOverheads.end()) - threadOverheads.begin();
-				auto threadOverheadsMaxIndex = max_element(threadOverheads.begin(), threadOverheads.end()) - threadOverheads.begin();
-				auto threadOverheadsMin		 = threadOverheads[threadOverheadsMinIndex];
-				auto threadAnswersizeMin	 = threadAnswerSizes[threadOverheadsMinIndex];
-				auto threadOverheadsMax		 = threadOverheads[threadOverheadsMaxIndex];
-				auto threadAnswersizeMax	 = threadAnswerSizes[threadOverheadsMaxIndex];
+						for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+						{
+							futures[i] = promises[i].get_future();
+							threads[i] = thread(queryOram, cref(blockIds[i]), cref(orams[i]), ref(buffers[i]), cref(conditions), &promises[i]);
+						}
+
+						for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+						{
+							auto returned = futures[i].get();
+							realRecordsNumber += get<0>(returned);
+							mergeAggregates(aggregate, get<3>(returned));
+							threadOverheads.push_back(get<1>(returned));
+							threadAnswerSizes.push_back(get<2>(returned));
+							threads[i].join();
+						}
 
-				auto threadOverheadsSum		  = accumulate(threadOverheads.begin(), threadOverheads.end(), 0uLL);
-				auto threadOverheadsMean	  = threadOverheadsSum / threadOverheads.size();
-				auto threadOverheadsSquareSum = inner_product(threadOverheads.begin(), threadOverheads.end(), threadOverheads.begin(), 0uLL);
-				auto threadOverheadsStdDev	  = sqrt(threadOverheadsSquareSum / threadOverheads.size() - threadOverheadsMean * threadOverheadsMean);
+						timestampAfterORAMs = chrono::steady_clock::now();
+					}
+					else
+					{
+						timestampBeforeORAMs = chrono::steady_clock::now();
 
-				fastestThread = threadOverheadsMin;
+						for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+						{
+							auto returned = queryOram(blockIds[i], orams[i], buffers[i], conditions, NULL);
+							realRecordsNumber += get<0>(returned);
+							mergeAggregates(aggregate, get<3>(returned));
+							threadOverheads.push_back(get<1>(returned));
+							threadAnswerSizes.push_back(get<2>(returned));
+						}
 
-				LOG(TRACE, boost::wformat(L"Query: {before: %7s, ORAMs: %7s, after: %7s}, threads: {min: %7s (%4i), max: %7s (%4i), avg: %7s, stddev: %7s}") % timeToString(queryOverheadBefore) % timeToString(queryOverheadORAMs) % timeToString(queryOverheadAfter) % timeToString(threadOverheadsMin) % threadAnswersizeMin % timeToString(threadOverheadsMax) % threadAnswersizeMax % timeToString(threadOverheadsMean) % timeToString(threadOverheadsStdDev));
-				if (PROFILE_THREADS)
+						timestampAfterORAMs = chrono::steady_clock::now();
+					}
+
+					auto queryOverheadBefore = chrono::duration_cast<chrono::nanoseconds>(timestampBeforeORAMs - start).count();
+					auto queryOverheadORAMs	 = chrono::duration_cast<chrono::nanoseconds>(timestampAfterORAMs - timestampBeforeORAMs).count();
+					auto queryOverheadAfter	 = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - timestampAfterORAMs).count();
+
+					auto threadOverheadsMinIndex = min_element(threadOverheads.begin(), threadOverheads.end()) - threadOverheads.begin();
+					auto threadOverheadsMaxIndex = max_element(threadOverheads.begin(), threadOverheads.end()) - threadOverheads.begin();
+					auto threadOverheadsMin		 = threadOverheads[threadOverheadsMinIndex];
+					auto threadAnswersizeMin	 = threadAnswerSizes[threadOverheadsMinIndex];
+					auto threadOverheadsMax		 = threadOverheads[threadOverheadsMaxIndex];
+					auto threadAnswersizeMax	 = threadAnswerSizes[threadOverheadsMaxIndex];
+
+					auto threadOverheadsSum		  = accumulate(threadOverheads.begin(), threadOverheads.end(), 0uLL);
+					auto threadOverheadsMean	  = threadOverheadsSum / threadOverheads.size();
+					auto threadOverheadsSquareSum = inner_product(threadOverheads.begin(), threadOverheads.end(), threadOverheads.begin(), 0uLL);
+					auto threadOverheadsStdDev	  = sqrt(threadOverheadsSquareSum / threadOverheads.size() - threadOverheadsMean * threadOverheadsMean);
+
+					fastestThread = threadOverheadsMin;
+
+					LOG(TRACE, boost::wformat(L"Query: {before: %7s, ORAMs: %7s, after: %7s}, threads: {min: %7s (%4i), max: %7s (%4i), avg: %7s, stddev: %7s}") % timeToString(queryOverheadBefore) % timeToString(queryOverheadORAMs) % timeToString(queryOverheadAfter) % timeToString(threadOverheadsMin) % threadAnswersizeMin % timeToString(threadOverheadsMax) % threadAnswersizeMax % timeToString(threadOverheadsMean) % timeToString(threadOverheadsStdDev));
+					if (PROFILE_THREADS)
+					{
+						wstringstream wss;
+						wss << L"Threads: [ ";
+						for (auto i = 0u; i < ORAMS_NUMBER; i++)
+						{
+							wss << timeToString(threadOverheads[i]);
+							if (i != ORAMS_NUMBER - 1)
+							{
+								wss << ", ";
+							}
+						}
+						wss << L" ]";
+						LOG(TRACE, wss.str());
+					}
+				}
+				else
 				{
-					wstringstream wss;
-					wss << L"Threads: [ ";
-					for (auto i = 0u; i < ORAMS_NUMBER; i++)
+					vector<bytes> result;
+					search(attribute, query.first, query.second, attribute2, query2.first, query2.second, result);
+					realRecordsNumber = result.size();
+
+					if (SIMULATE)
 					{
-						wss << timeToString(threadOverheads[i]);
-						if (i != ORAMS_NUMBER - 1)
+						for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
 						{
-							wss << ", ";
+							perOram[i] = blockIds[i].size();
 						}
+						auto prediction = predictCost(perOram, ORAM_LOG_CAPACITY, ORAM_Z, ORAM_BLOCK_SIZE, USE_ORAM_OPTIMIZATION, simulation);
+						predictions.push_back(prediction);
+
+						auto [fewest, most] = minmax_element(perOram.begin(), perOram.end());
+						LOG(TRACE, boost::wformat(L"Query predicted to take %1% and move %2%, ORAMs fetch from %3% to %4% records") % timeToString(prediction.latency) % bytesToString(prediction.bytes) % *fewest % *most);
 					}
-					wss << L" ]";
-					LOG(TRACE, wss.str());
 				}
-			}
-			else
-			{
-				vector<bytes> result;
-				(firstAttribute ? tree : tree2)->search(query.first, query.second, result);
-				realRecordsNumber = result.size();
-			}
 
-			auto paddingRecordsNumber = totalRecordsNumber >= (totalNoise + realRecordsNumber) ? totalRecordsNumber - totalNoise - realRecordsNumber : 0;
+				auto paddingRecordsNumber = totalRecordsNumber >= (totalNoise + realRecordsNumber) ? totalRecordsNumber - totalNoise - realRecordsNumber : 0;
 
-			auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
-			measurements.push_back({elapsed, fastestThread, realRecordsNumber, paddingRecordsNumber, totalNoise, totalRecordsNumber});
+				auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+				measurements.push_back({elapsed, fastestThread, realRecordsNumber, paddingRecordsNumber, totalNoise, totalRecordsNumber});
 
-			LOG(DEBUG, boost::wformat(L"Query %3i / %3i : {%9.2f, %9.2f} the real records %6i ( +%6i padding, +%6i noise, %6i total) (%7s, or %7s / record)") % queryIndex % queries.size() % numberToSalary(query.first) % numberToSalary(query.second) % realRecordsNumber % paddingRecordsNumber % totalNoise % totalRecordsNumber % timeToString(elapsed) % (realRecordsNumber > 0 ? timeToString(elapsed / realRecordsNumber) : L"0 ns"));
+				if (AGGREGATE != ANone)
+				{
+					LOG(DEBUG, boost::wformat(L"Query %3i / %3i : %s of %s is %.2f") % queryIndex % queries.size() % AGGREGATE_FUNCTION_strings[AGGREGATE] % toWString(DATASET_SCHEMA.columns[AGGREGATE_FIELD].name) % aggregateValue(aggregate, AGGREGATE, DATASET_SCHEMA.columns[AGGREGATE_FIELD].encoding));
+				}
+				LOG(DEBUG, boost::wformat(L"Query %3i / %3i : {%9.2f, %9.2f} the real records %6i ( +%6i padding, +%6i noise, %6i total) (%7s, or %7s / record)") % queryIndex % queries.size() % numberToSalary(query.first) % numberToSalary(query.second) % realRecordsNumber % paddingRecordsNumber % totalNoise % totalRecordsNumber % timeToString(elapsed) % (realRecordsNumber > 0 ? timeToString(elapsed / realRecordsNumber) : L"0 ns"));
+	#ifdef TESTING
+				LOG(DEBUG, boost::wformat(L"Query %3i / %3i : %i heap allocations") % queryIndex % queries.size() % (ALLOCATIONS.load() - allocationsBefore));
+	#endif
 
-			if (PROFILE_STORAGE_REQUESTS)
+				if (PROFILE_STORAGE_REQUESTS)
+				{
+					printProfileStats(profiles);
+				}
+
+				queriesSinceCheckpoint++;
+				if (checkpoints && ((CHECKPOINT_QUERIES > 0 && queriesSinceCheckpoint >= CHECKPOINT_QUERIES) || (CHECKPOINT_SECONDS > 0 && chrono::steady_clock::now() - lastCheckpoint >= chrono::seconds(CHECKPOINT_SECONDS))))
+				{
+					auto captureStart = chrono::steady_clock::now();
+
+					vector<pair<number, oramDelta>> deltas;
+					auto changes = 0uLL;
+					for (auto i = 0uLL; i < trackers.size(); i++)
+					{
+						auto delta = trackers[i].changes();
+						if (delta.positions.size() > 0 || delta.removed.size() > 0 || delta.stashed.size() > 0)
+						{
+							changes += delta.positions.size() + delta.removed.size() + delta.stashed.size();
+							deltas.push_back({i, move(delta)});
+						}
+					}
+					checkpoints->submit(move(deltas));
+
+					LOG(DEBUG, boost::wformat(L"Checkpoint after query %1% captured %2% changes in %3%") % queryIndex % changes % timeToString(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - captureStart).count()));
+
+					queriesSinceCheckpoint = 0;
+					lastCheckpoint		   = chrono::steady_clock::now();
+				}
+
+				queryIndex++;
+				usleep(WAIT_BETWEEN_QUERIES * 1000);
+
+				if (SIGINT_RECEIVED)
+				{
+					LOG(WARNING, L"Stopping query processing due to SIGINT");
+					break;
+				}
+			}
+
+			if (checkpoints)
 			{
-				printProfileStats(profiles);
+				try
+				{
+					checkpoints->flush();
+				}
+				catch (const Exception& e)
+				{
+					LOG(WARNING, toWString(e.what()));
+				}
+				LOG(INFO, boost::wformat(L"%1% checkpoints written") % checkpoints->written());
+				checkpoints.reset();
+
+				// the final snapshot supersedes the journal
+				snapshotWriter.add(SnapshotGeneration, 0, vector<number>{++generation});
 			}
 
-			queryIndex++;
-			usleep(WAIT_BETWEEN_QUERIES * 1000);
+#pragma endregion
+
+			if (configurations.size() > 0)
+			{
+				writeResults(measurements, predictions, allProfiles, rpcClients, queryIndex - 1);
+
+				measurements.clear();
+				predictions.clear();
+				allProfiles.clear();
+				queryIndex = 1;
+			}
 
 			if (SIGINT_RECEIVED)
 			{
-				LOG(WARNING, L"Stopping query processing due to SIGINT");
 				break;
 			}
 		}
 
-		if (!VIRTUAL_REQUESTS && rpcClients.size() == 0)
+		if (updates.size() > 0)
 		{
-			LOG(INFO, L"Saving ORAMs position map and stash to files");
-			for (auto i = 0uLL; i < oramSets.size(); i++)
+			LOG(INFO, boost::wformat(L"Applied %1% inserts, %2% updates and %3% deletes along with the queries (%4% skipped, %5% left)") % applied["insert"] % applied["update"] % applied["delete"] % applied["skipped"] % (updates.size() - nextUpdate));
+
+			// inserted values may have widened the bounds
+			vector<number> statistics;
+			for (auto a = 0uLL; a < MIN_VALUES.size(); a++)
 			{
-				static_pointer_cast<PathORAM::InMemoryPositionMapAdapter>(get<1>(oramSets[i]))->storeToFile(filename(ORAM_MAP_FILE, i));
-				static_pointer_cast<PathORAM::InMemoryStashAdapter>(get<2>(oramSets[i]))->storeToFile(filename(ORAM_STASH_FILE, i));
+				statistics.insert(statistics.end(), {MIN_VALUES[a], MAX_VALUES[a], MAX_RANGES[a]});
 			}
-		}
+			snapshotWriter.add(SnapshotStatistics, 0, statistics);
 
-#pragma endregion
+			// the overlay section is sized when added, so it is added again once the updates are applied
+			addOverlaySection();
+		}
 	}
 	else
 	{
@@ -1233,83 +2389,167 @@ int main(int argc, char* argv[])
 		if (GENERATE_INDICES)
 		{
 			storageKey = PathORAM::getRandomBlock(KEYSIZE);
-			PathORAM::storeKey(storageKey, filename(KEY_FILE, -1));
 		}
 		else
 		{
-			storageKey = PathORAM::loadKey(filename(KEY_FILE, -1));
+			storageKey = snapshot->values<uchar>(SnapshotStrawmanKey);
 		}
+		snapshotWriter.add(SnapshotStrawmanKey, 0, storageKey);
 
-		vector<shared_ptr<PathORAM::AbsStorageAdapter>> storages;
-		storages.resize(ORAMS_NUMBER);
-
-		for (number i = 0; i < ORAMS_NUMBER; i++)
-		{
-			shared_ptr<PathORAM::AbsStorageAdapter> storage;
+		auto openStorage = [&storageKey](number i) -> shared_ptr<PathORAM::AbsStorageAdapter> {
 			switch (ORAM_STORAGE)
 			{
 				case InMemory:
-					storage = make_shared<PathORAM::InMemoryStorageAdapter>(COUNT, ORAM_BLOCK_SIZE, storageKey, 1, BATCH_SIZE);
-					break;
+					return make_shared<PathORAM::InMemoryStorageAdapter>(COUNT, ORAM_BLOCK_SIZE, storageKey, 1, BATCH_SIZE);
 				case FileSystem:
-					storage = make_shared<PathORAM::FileSystemStorageAdapter>(COUNT, ORAM_BLOCK_SIZE, storageKey, filename(ORAM_STORAGE_FILE, i), false, 1, BATCH_SIZE);
-					break;
+					return make_shared<PathORAM::FileSystemStorageAdapter>(COUNT, ORAM_BLOCK_SIZE, storageKey, filename(ORAM_STORAGE_FILE, i), false, 1, BATCH_SIZE);
 				case Redis:
-					storage = make_shared<PathORAM::RedisStorageAdapter>(COUNT, ORAM_BLOCK_SIZE, storageKey, redishost(REDIS_HOSTS[i % REDIS_HOSTS.size()], i), false, 1, BATCH_SIZE);
-					break;
+					return make_shared<PathORAM::RedisStorageAdapter>(COUNT, ORAM_BLOCK_SIZE, storageKey, redishost(REDIS_HOSTS[i % REDIS_HOSTS.size()], i), false, 1, BATCH_SIZE);
 			}
-			storages[i] = storage;
+			throw Exception("unknown storage backend");
+		};
+
+		vector<shared_ptr<PathORAM::AbsStorageAdapter>> storages;
+		for (number i = 0; i < ORAMS_NUMBER; i++)
+		{
+			storages.push_back(openStorage(i));
 		}
 
 		if (GENERATE_INDICES)
 		{
 			LOG(INFO, L"Uploading strawman dataset");
 
+			auto upload = [&storages](number i, vector<pair<number, bytes>>& records) -> void {
+				vector<pair<const number, PathORAM::bucket>> input;
+				input.reserve(records.size());
+
+				for (auto&& record : records)
+				{
+					input.push_back({record.first, vector<PathORAM::block>{record}});
+				}
+
+				storages[i]->set(boost::make_iterator_range(input.begin(), input.end()));
+			};
+
 			for (number i = 0; i < ORAMS_NUMBER; i++)
 			{
-				vector<pair<const number, PathORAM::bucket>> input;
-				input.reserve(oramsIndex[i].size());
+				if (runs)
+				{
+					runs->read(i, ORAM_BLOCK_SIZE, max((MEMORY_BUDGET << 20) / (ORAM_BLOCK_SIZE * 2), 1uLL), [&upload, i](vector<pair<number, bytes>>& chunk) { upload(i, chunk); });
+				}
+				else
+				{
+					upload(i, oramsIndex[i]);
+				}
+			}
+			runs.reset();
+		}
+
+		// a file is read through an independent handle (own file stream) per scan thread;
+		// the upload handles are closed first, so that everything they wrote is visible
+		vector<vector<shared_ptr<PathORAM::AbsStorageAdapter>>> readers(ORAMS_NUMBER);
+		for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+		{
+			if (ORAM_STORAGE == FileSystem)
+			{
+				storages[i].reset();
+				for (auto t = 0uLL; t < SCAN_THREADS; t++)
+				{
+					readers[i].push_back(openStorage(i));
+				}
+			}
+			else
+			{
+				readers[i].push_back(storages[i]);
+			}
+		}
+		storages.clear();
+
+		// a partition is scanned in windows of BATCH_SIZE blocks, reader t takes windows t, t + readers, ...;
+		// the buffers are reused across windows and queries
+		struct scanBuffers
+		{
+			vector<number> locations;
+			vector<PathORAM::block> current;
+			vector<PathORAM::block> next;
+		};
+		vector<vector<scanBuffers>> scans(ORAMS_NUMBER);
+		for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
+		{
+			scans[i].resize(readers[i].size());
+		}
+
+		// counts the matching rows in the windows of one reader;
+		// the next window is fetched (and decrypted by the storage adapter) while the current one is filtered,
+		// so at most two windows per reader are in memory
+		auto scanWindows = [&readers, &scans, &oramBlockNumbers, &encoding](number queryFrom, number queryTo, number storageId, number reader) -> number {
+			// the queries are on the first queried column, filtered as queryOram does
+			vector<rangeCondition> conditions = {{DATASET_SCHEMA.indexed[QUERY_ATTRIBUTES[0]], encoding(QUERY_ATTRIBUTES[0]), queryFrom, queryTo}};
+
+			auto count	= 0uLL;
+			auto blocks = oramBlockNumbers[storageId];
+			auto window = max(BATCH_SIZE, 1uLL);
+			auto stride = window * readers[storageId].size();
+			auto& scan	= scans[storageId][reader];
+
+			auto fetch = [&readers, &scan, storageId, reader, blocks, window](number from, vector<PathORAM::block>& response) -> void {
+				scan.locations.resize(min(window, blocks - from));
+				iota(scan.locations.begin(), scan.locations.end(), from);
+				response.clear();
+				readers[storageId][reader]->get(scan.locations, response);
+			};
+
+			auto first = reader * window;
+			if (first < blocks)
+			{
+				fetch(first, scan.current);
+			}
+			for (auto from = first; from < blocks; from += stride)
+			{
+				future<void> prefetch;
+				if (from + stride < blocks)
+				{
+					prefetch = async(launch::async, fetch, from + stride, ref(scan.next));
+				}
+
+				for (auto&& record : scan.current)
+				{
+					if (matchesConditions(record.second, conditions))
+					{
+						count++;
+					}
+				}
 
-				for (number j = 0; j < oramsIndex[i].size(); j++)
+				if (prefetch.valid())
 				{
-					input.push_back({j, vector<PathORAM::block>{oramsIndex[i][j]}});
+					prefetch.get();
+					scan.current.swap(scan.next);
 				}
-
-				storages[i]->set(boost::make_iterator_range(input.begin(), input.end()));
 			}
-		}
-
-		auto storageQuery = [&storages](number queryFrom, number queryTo, number storageId, number size, promise<vector<string>>* promise) -> vector<string> {
-			vector<string> answer;
 
-			vector<PathORAM::block> returned;
+			return count;
+		};
 
-			vector<number> locations;
-			locations.resize(size);
-			for (number i = 0; i < size; i++)
+		// returns the number of matching rows without materializing them
+		auto storageQuery = [&readers, &scanWindows](number queryFrom, number queryTo, number storageId, promise<number>* promise) -> number {
+			vector<future<number>> others;
+			for (auto reader = 1uLL; reader < readers[storageId].size(); reader++)
 			{
-				locations[i] = i;
+				others.push_back(async(launch::async, scanWindows, queryFrom, queryTo, storageId, reader));
 			}
 
-			storages[storageId]->get(locations, returned);
-			for (auto record : returned)
+			auto count = scanWindows(queryFrom, queryTo, storageId, 0);
+			for (auto&& other : others)
 			{
-				auto text = PathORAM::toText(record.second, ORAM_BLOCK_SIZE);
-
-				auto salary = salaryToNumber(text);
-
-				if (salary >= queryFrom && salary <= queryTo)
-				{
-					answer.push_back(text);
-				}
+				count += other.get();
 			}
 
 			if (promise != NULL)
 			{
-				promise->set_value(answer);
+				promise->set_value(count);
 			}
 
-			return answer;
+			return count;
 		};
 
 		LOG(INFO, L"Running strawman queries");
@@ -1322,28 +2562,26 @@ int main(int argc, char* argv[])
 			if (PARALLEL)
 			{
 				thread threads[ORAMS_NUMBER];
-				promise<vector<string>> promises[ORAMS_NUMBER];
-				future<vector<string>> futures[ORAMS_NUMBER];
+				promise<number> promises[ORAMS_NUMBER];
+				future<number> futures[ORAMS_NUMBER];
 
 				for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
 				{
 					futures[i] = promises[i].get_future();
-					threads[i] = thread(storageQuery, query.first, query.second, i, oramsIndex[i].size(), &promises[i]);
+					threads[i] = thread(storageQuery, query.first, query.second, i, &promises[i]);
 				}
 
 				for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
 				{
-					auto result = futures[i].get();
+					count += futures[i].get();
 					threads[i].join();
-					count += result.size();
 				}
 			}
 			else
 			{
 				for (auto i = 0uLL; i < ORAMS_NUMBER; i++)
 				{
-					auto result = storageQuery(query.first, query.second, i, oramsIndex[i].size(), NULL);
-					count += result.size();
+					count += storageQuery(query.first, query.second, i, NULL);
 				}
 			}
 
@@ -1357,124 +2595,21 @@ int main(int argc, char* argv[])
 #pragma endregion
 	}
 
-	LOG(INFO, L"Complete!");
-
-	auto ingress = 0uLL;
-	auto egress	 = 0uLL;
-
-	for (auto&& rpcClient : rpcClients)
-	{
-		auto [rIngress, rEgress] = rpcClient->call("reset").as<pair<number, number>>();
-		ingress += rIngress;
-		egress += rEgress;
-	}
-
-	auto avg = [&measurements](function<number(const measurement&)> getter) -> pair<number, number> {
-		auto values = transform<measurement, number>(measurements, getter);
-		auto sum	= accumulate(values.begin(), values.end(), 0LL);
-		return {sum, values.size() > 0 ? sum / values.size() : 0};
-	};
-
-	auto [timeTotal, timePerQuery] = avg([](measurement v) { return get<0>(v); });
-	auto fastestThreadPerQuery	   = avg([](measurement v) { return get<1>(v); }).second;
-	auto [realTotal, realPerQuery] = avg([](measurement v) { return get<2>(v); });
-	auto paddingPerQuery		   = avg([](measurement v) { return get<3>(v); }).second;
-	auto noisePerQuery			   = avg([](measurement v) { return get<4>(v); }).second;
-	auto totalPerQuery			   = avg([](measurement v) { return get<5>(v); }).second;
-
-#pragma region WRITE_JSON
-
-	LOG(INFO, boost::wformat(L"For %1% queries: total: %2%, average: %3% / query, fastest thread: %4% / query, %5% / fetched item; (%6%+%7%+%8%=%9%) records / query") % (queryIndex - 1) % timeToString(timeTotal) % timeToString(timePerQuery) % timeToString(fastestThreadPerQuery) % timeToString(realTotal > 0 ? timeTotal / realTotal : 0) % realPerQuery % paddingPerQuery % noisePerQuery % totalPerQuery);
-	LOG(INFO, boost::wformat(L"For %1% queries: ingress: %2% (%3% / query), egress: %4% (%5% / query), network usage / query: %6%, or %7%%% of DB") % (queryIndex - 1) % bytesToString(ingress) % bytesToString(ingress / (queryIndex - 1)) % bytesToString(egress) % bytesToString(egress / (queryIndex - 1)) % bytesToString((ingress + egress) / (queryIndex - 1)) % (100 * (ingress + egress) / (queryIndex - 1) / (COUNT * ORAM_BLOCK_SIZE)));
-	if (PROFILE_STORAGE_REQUESTS)
-	{
-		printProfileStats(allProfiles, queryIndex - 1);
-	}
-
-	wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-
-	pt::ptree root;
-	pt::ptree overheadsNode;
-
-	for (auto measurement : measurements)
-	{
-		pt::ptree overhead;
-		overhead.put("overhead", get<0>(measurement));
-		overhead.put("fastestThread", get<1>(measurement));
-		overhead.put("real", get<2>(measurement));
-		overhead.put("padding", get<3>(measurement));
-		overhead.put("noise", get<4>(measurement));
-		overhead.put("total", get<5>(measurement));
-		overheadsNode.push_back({"", overhead});
-	}
+	LOG(INFO, L"Saving client state snapshot");
+	snapshotWriter.write(filename(SNAPSHOT_FILE, -1));
+	boost::filesystem::remove(filename(JOURNAL_FILE, -1));
 
-	PUT_PARAMETER(COUNT);
-	PUT_PARAMETER(DATASET_TAG);
-	PUT_PARAMETER(QUERYSET_TAG);
-	PUT_PARAMETER(GENERATE_INDICES);
-	PUT_PARAMETER(READ_INPUTS);
-	PUT_PARAMETER(ORAM_BLOCK_SIZE);
-	PUT_PARAMETER(ORAM_LOG_CAPACITY);
-	PUT_PARAMETER(ORAMS_NUMBER);
-	PUT_PARAMETER(PARALLEL);
-	PUT_PARAMETER(ORAM_Z);
-	PUT_PARAMETER(TREE_BLOCK_SIZE);
-	PUT_PARAMETER(USE_ORAMS);
-	PUT_PARAMETER(USE_ORAM_OPTIMIZATION);
-	for (auto&& rpcHost : RPC_HOSTS)
-	{
-		PUT_PARAMETER(rpcHost);
-	}
-	PUT_PARAMETER(DISABLE_ENCRYPTION);
-	PUT_PARAMETER(PROFILE_STORAGE_REQUESTS);
-	PUT_PARAMETER(PROFILE_THREADS);
-	PUT_PARAMETER(REDIS_FLUSH_ALL);
-	PUT_PARAMETER(FILE_LOGGING);
-	PUT_PARAMETER(DUMP_TO_MATTERMOST);
-	PUT_PARAMETER(VIRTUAL_REQUESTS);
-	PUT_PARAMETER(BATCH_SIZE);
-	PUT_PARAMETER(SEED);
-	PUT_PARAMETER(DP_BUCKETS);
-	PUT_PARAMETER(DP_K);
-	PUT_PARAMETER(DP_BETA);
-	PUT_PARAMETER(DP_EPSILON);
-	PUT_PARAMETER(DP_USE_GAMMA);
+	LOG(INFO, L"Complete!");
 
-	root.put("ORAM_BACKEND", converter.to_bytes(ORAM_BACKEND_strings[ORAM_STORAGE]));
-	for (auto&& redisHost : REDIS_HOSTS)
+	if (configurations.size() == 0)
 	{
-		PUT_PARAMETER(redisHost);
+		writeResults(measurements, predictions, allProfiles, rpcClients, queryIndex - 1);
 	}
 
-	root.put("LOG_FILENAME", logName);
-
-	pt::ptree aggregates;
-	aggregates.put("timeTotal", timeTotal);
-	aggregates.put("timePerQuery", timePerQuery);
-	aggregates.put("fastestThreadPerQuery", fastestThreadPerQuery);
-	aggregates.put("realTotal", realTotal);
-	aggregates.put("realPerQuery", realPerQuery);
-	aggregates.put("paddingPerQuery", paddingPerQuery);
-	aggregates.put("paddingPerQuery", paddingPerQuery);
-	aggregates.put("totalPerQuery", totalPerQuery);
-	root.add_child("aggregates", aggregates);
-
-	root.add_child("queries", overheadsNode);
-
-	auto filename = boost::str(boost::format("./results/%1%.json") % logName);
-
-	pt::write_json(filename, root);
-
-	LOG(INFO, boost::wformat(L"Log written to %1%") % converter.from_bytes(filename));
 
-	if (FILE_LOGGING)
-	{
-		logFile.close();
-	}
+	flushLog();
 	dumpToMattermost(argc, argv);
 
-#pragma endregion
-
 	return 0;
 }
 
@@ -1501,78 +2636,6 @@ wstring toWString(string input)
 	return converter.from_bytes(input);
 }
 
-inline void storeInputs(vector<pair<number, number>>& queries, vector<number>& oramBlockNumbers)
-{
-	ofstream statFile(filename(STATS_INPUT_FILE, -1));
-
-	statFile << COUNT << endl;
-	statFile << MIN_VALUE << endl;
-	statFile << MAX_VALUE << endl;
-	statFile << MAX_RANGE << endl;
-	for (auto&& blockNumber : oramBlockNumbers)
-	{
-		statFile << blockNumber << endl;
-	}
-
-	statFile.close();
-
-	ofstream queryFile(filename(QUERY_INPUT_FILE, -1));
-
-	for (auto&& query : queries)
-	{
-		queryFile << query.first << "," << query.second << endl;
-	}
-
-	queryFile.close();
-}
-
-inline void loadInputs(vector<pair<number, number>>& queries, vector<number>& oramBlockNumbers)
-{
-	ifstream statFile(filename(STATS_INPUT_FILE, -1));
-
-	statFile >> COUNT >> MIN_VALUE >> MAX_VALUE >> MAX_RANGE;
-	number blockNumber;
-	for (number i = 0; i < ORAMS_NUMBER; i++)
-	{
-		statFile >> blockNumber;
-		oramBlockNumbers.push_back(blockNumber);
-	}
-
-	statFile.close();
-
-	ifstream queryFile(filename(QUERY_INPUT_FILE, -1));
-
-	string line = "";
-	while (getline(queryFile, line))
-	{
-		vector<string> query;
-		boost::algorithm::split(query, line, boost::is_any_of(","));
-		auto left  = stoull(query[0]);
-		auto right = stoull(query[1]);
-
-		queries.push_back({left, right});
-	}
-	queryFile.close();
-}
-
-void addFakeRequests(vector<number>& blocks, number maxBlocks, number fakesNumber)
-{
-	// TODO possibly avoid sort
-	// TODO it is supposd to be sorted already
-	sort(blocks.begin(), blocks.end());
-
-	for (auto j = 0uLL, inserted = 0uLL, block = 0uLL; inserted < fakesNumber; j++)
-	{
-		if (block < blocks.size() && blocks[block] == j)
-		{
-			block++;
-			continue;
-		}
-		blocks.push_back(j % maxBlocks);
-		inserted++;
-	}
-}
-
 void printProfileStats(vector<profile>& profiles, number queries)
 {
 	if (profiles.size() == 0)
@@ -1633,19 +2696,21 @@ void dumpToMattermost(int argc, char* argv[])
 			}
 			auto cliStr = cli.str();
 
+			auto lines = logLines();
+
 			stringstream ss;
 			auto count = cliStr.size();
-			auto lines = 0u;
+			auto sent  = 0u;
 			auto part  = 1;
-			for (auto&& line : logLines)
+			for (auto&& line : lines)
 			{
 				count += line.size();
-				lines++;
+				sent++;
 				ss << line << endl;
 
-				if (count >= 16383 - 512 || lines == logLines.size() - 1)
+				if (count >= 16383 - 512 || sent == lines.size() - 1)
 				{
-					auto partString = (lines == logLines.size() - 1) && part == 1 ? "" : boost::str(boost::format("**PART %i**\n") % part);
+					auto partString = (sent == lines.size() - 1) && part == 1 ? "" : boost::str(boost::format("**PART %i**\n") % part);
 
 					exec(boost::str(boost::format("curl -s -i -X POST -H 'Content-Type: application/json' -d '{\"text\": \"%s\n`%s`\n```\n%s\n```\"}' %s") % partString % cliStr % ss.str() % hook));
 
@@ -1682,36 +2747,170 @@ void setupRPCHosts(vector<unique_ptr<rpc::client>>& rpcClients)
 	}
 }
 
-void LOG(LOG_LEVEL level, boost::wformat message)
+void writeResults(const vector<measurement>& measurements, const vector<costPrediction>& predictions, vector<profile>& allProfiles, vector<unique_ptr<rpc::client>>& rpcClients, number queries)
 {
-	LOG(level, boost::str(message));
-}
+	auto ingress = 0uLL;
+	auto egress	 = 0uLL;
 
-void LOG(LOG_LEVEL level, wstring message)
-{
-	if (level >= __logLevel)
+	for (auto&& rpcClient : rpcClients)
 	{
-		auto t = time(nullptr);
-		wcout << L"[" << put_time(localtime(&t), L"%d/%m/%Y %H:%M:%S") << L"] " << setw(10) << logLevelColors[level] << LOG_LEVEL_strings[level] << L": " << message << RESET << endl;
+		auto [rIngress, rEgress] = rpcClient->call("reset").as<pair<number, number>>();
+		ingress += rIngress;
+		egress += rEgress;
+	}
 
-		if (DUMP_TO_MATTERMOST)
-		{
-			stringstream ss;
-			wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-			ss << "[" << put_time(localtime(&t), "%d/%m/%Y %H:%M:%S") << "] " << setw(10) << converter.to_bytes(LOG_LEVEL_strings[level]) << ": " << converter.to_bytes(message);
-			logLines.push_back(ss.str());
-		}
+	auto avg = [&measurements](function<number(const measurement&)> getter) -> pair<number, number> {
+		auto values = transform<measurement, number>(measurements, getter);
+		auto sum	= accumulate(values.begin(), values.end(), 0LL);
+		return {sum, values.size() > 0 ? sum / values.size() : 0};
+	};
+
+	auto [timeTotal, timePerQuery] = avg([](measurement v) { return get<0>(v); });
+	auto fastestThreadPerQuery	   = avg([](measurement v) { return get<1>(v); }).second;
+	auto [realTotal, realPerQuery] = avg([](measurement v) { return get<2>(v); });
+	auto paddingPerQuery		   = avg([](measurement v) { return get<3>(v); }).second;
+	auto noisePerQuery			   = avg([](measurement v) { return get<4>(v); }).second;
+	auto totalPerQuery			   = avg([](measurement v) { return get<5>(v); }).second;
+
+	auto predictedLatencyPerQuery = 0.0, predictedBytesPerQuery = 0.0;
+	for (auto&& prediction : predictions)
+	{
+		predictedLatencyPerQuery += prediction.latency / predictions.size();
+		predictedBytesPerQuery += prediction.bytes / predictions.size();
+	}
+
+	LOG(INFO, boost::wformat(L"For %1% queries: total: %2%, average: %3% / query, fastest thread: %4% / query, %5% / fetched item; (%6%+%7%+%8%=%9%) records / query") % queries % timeToString(timeTotal) % timeToString(timePerQuery) % timeToString(fastestThreadPerQuery) % timeToString(realTotal > 0 ? timeTotal / realTotal : 0) % realPerQuery % paddingPerQuery % noisePerQuery % totalPerQuery);
+	LOG(INFO, boost::wformat(L"For %1% queries: ingress: %2% (%3% / query), egress: %4% (%5% / query), network usage / query: %6%, or %7%%% of DB") % queries % bytesToString(ingress) % bytesToString(ingress / queries) % bytesToString(egress) % bytesToString(egress / queries) % bytesToString((ingress + egress) / queries) % (100 * (ingress + egress) / queries / (COUNT * ORAM_BLOCK_SIZE)));
+	if (SIMULATE)
+	{
+		LOG(INFO, boost::wformat(L"For %1% queries: predicted latency: %2% / query, predicted network usage: %3% / query") % predictions.size() % timeToString(predictedLatencyPerQuery) % bytesToString(predictedBytesPerQuery));
+	}
+	if (PROFILE_STORAGE_REQUESTS)
+	{
+		printProfileStats(allProfiles, queries);
+	}
+
+	wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+
+	pt::ptree root;
+	pt::ptree overheadsNode;
+
+	for (auto i = 0uLL; i < measurements.size(); i++)
+	{
+		auto measurement = measurements[i];
 
-		if (FILE_LOGGING || DUMP_TO_MATTERMOST)
+		pt::ptree overhead;
+		overhead.put("overhead", get<0>(measurement));
+		overhead.put("fastestThread", get<1>(measurement));
+		overhead.put("real", get<2>(measurement));
+		overhead.put("padding", get<3>(measurement));
+		overhead.put("noise", get<4>(measurement));
+		overhead.put("total", get<5>(measurement));
+		if (i < predictions.size())
 		{
-			wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-			logFile << "[" << put_time(localtime(&t), "%d/%m/%Y %H:%M:%S") << "] " << setw(10) << converter.to_bytes(LOG_LEVEL_strings[level]) << ": " << converter.to_bytes(message) << endl;
+			overhead.put("predictedLatency", predictions[i].latency);
+			overhead.put("predictedBytes", predictions[i].bytes);
 		}
+		overheadsNode.push_back({"", overhead});
 	}
-	if (level == CRITICAL)
+
+	PUT_PARAMETER(COUNT);
+	PUT_PARAMETER(DATASET_TAG);
+	PUT_PARAMETER(QUERYSET_TAG);
+	PUT_PARAMETER(UPDATES_TAG);
+	PUT_PARAMETER(UPDATES_BATCH);
+	PUT_PARAMETER(SCHEMA);
+	PUT_PARAMETER(QUERY_COLUMNS);
+	PUT_PARAMETER(AGGREGATE);
+	PUT_PARAMETER(AGGREGATE_COLUMN);
+	PUT_PARAMETER(PROJECTION);
+	PUT_PARAMETER(GENERATE_INDICES);
+	PUT_PARAMETER(READ_INPUTS);
+	PUT_PARAMETER(SKEW);
+	PUT_PARAMETER(DISTINCT);
+	PUT_PARAMETER(SELECTIVITY);
+	PUT_PARAMETER(HOTSPOT);
+	PUT_PARAMETER(HOTSPOT_WIDTH);
+	PUT_PARAMETER(ORAM_BLOCK_SIZE);
+	PUT_PARAMETER(ORAM_LOG_CAPACITY);
+	PUT_PARAMETER(ORAMS_NUMBER);
+	PUT_PARAMETER(PARALLEL);
+	PUT_PARAMETER(ORAM_Z);
+	PUT_PARAMETER(TREE_BLOCK_SIZE);
+	PUT_PARAMETER(USE_ORAMS);
+	PUT_PARAMETER(USE_ORAM_OPTIMIZATION);
+	for (auto&& rpcHost : RPC_HOSTS)
 	{
-		exit(1);
+		PUT_PARAMETER(rpcHost);
+	}
+	PUT_PARAMETER(DISABLE_ENCRYPTION);
+	PUT_PARAMETER(PROFILE_STORAGE_REQUESTS);
+	PUT_PARAMETER(PROFILE_THREADS);
+	PUT_PARAMETER(REDIS_FLUSH_ALL);
+	PUT_PARAMETER(FILE_LOGGING);
+	PUT_PARAMETER(DUMP_TO_MATTERMOST);
+	PUT_PARAMETER(VIRTUAL_REQUESTS);
+	PUT_PARAMETER(SIMULATE);
+	PUT_PARAMETER(SIM_ROUND_TRIP);
+	PUT_PARAMETER(SIM_BANDWIDTH);
+	PUT_PARAMETER(SIM_BYTE_COST);
+	PUT_PARAMETER(SIM_PARALLELISM);
+	PUT_PARAMETER(BATCH_SIZE);
+	PUT_PARAMETER(INGEST_THREADS);
+	PUT_PARAMETER(MEMORY_BUDGET);
+	PUT_PARAMETER(CHECKPOINT_QUERIES);
+	PUT_PARAMETER(CHECKPOINT_SECONDS);
+	PUT_PARAMETER(SCAN_THREADS);
+	PUT_PARAMETER(PARTITIONING);
+	PUT_PARAMETER(PACK_RECORDS);
+	PUT_PARAMETER(SIZE_CLASSES_OPTION);
+	PUT_PARAMETER(SEED);
+	PUT_PARAMETER(DP_BUCKETS);
+	PUT_PARAMETER(DP_K);
+	PUT_PARAMETER(DP_BETA);
+	PUT_PARAMETER(DP_EPSILON);
+	PUT_PARAMETER(DP_USE_GAMMA);
+	PUT_PARAMETER(DP_LEVELS);
+	PUT_PARAMETER(WAIT_BETWEEN_QUERIES);
+	if (SWEEP != "")
+	{
+		PUT_PARAMETER(SWEEP);
+		PUT_PARAMETER(SWEEP_CONFIGURATION);
+	}
+
+	root.put("ORAM_BACKEND", converter.to_bytes(ORAM_BACKEND_strings[ORAM_STORAGE]));
+	root.put("DISTRIBUTION", converter.to_bytes(VALUE_DISTRIBUTION_strings[DISTRIBUTION]));
+	for (auto&& redisHost : REDIS_HOSTS)
+	{
+		PUT_PARAMETER(redisHost);
+	}
+
+	root.put("LOG_FILENAME", logName);
+
+	pt::ptree aggregates;
+	aggregates.put("timeTotal", timeTotal);
+	aggregates.put("timePerQuery", timePerQuery);
+	aggregates.put("fastestThreadPerQuery", fastestThreadPerQuery);
+	aggregates.put("realTotal", realTotal);
+	aggregates.put("realPerQuery", realPerQuery);
+	aggregates.put("paddingPerQuery", paddingPerQuery);
+	aggregates.put("paddingPerQuery", paddingPerQuery);
+	aggregates.put("totalPerQuery", totalPerQuery);
+	if (SIMULATE)
+	{
+		aggregates.put("predictedLatencyPerQuery", predictedLatencyPerQuery);
+		aggregates.put("predictedBytesPerQuery", predictedBytesPerQuery);
 	}
+	root.add_child("aggregates", aggregates);
+
+	root.add_child("queries", overheadsNode);
+
+	// every sweep configuration is a result of its own
+	auto filename = SWEEP == "" ? boost::str(boost::format("./results/%1%.json") % logName) : boost::str(boost::format("./results/%1%--%2%.json") % logName % SWEEP_CONFIGURATION);
+
+	pt::write_json(filename, root);
+
+	LOG(INFO, boost::wformat(L"Log written to %1%") % converter.from_bytes(filename));
 }
 
 #pragma endregion
@@ -1,6 +1,7 @@
 #include "definitions.h"
 #include "path-oram/oram.hpp"
 #include "path-oram/utility.hpp"
+#include "schema.hpp"
 #include "utility.hpp"
 
 #include <boost/program_options.hpp>
@@ -26,9 +27,15 @@ number ingress, egress;
 
 // returns tuple<real records, thread overhead, # of processed requests>
 using queryReturnType = tuple<vector<bytes>, chrono::steady_clock::rep, number>;
+// returns tuple<partial aggregate of real records, thread overhead, # of processed requests>
+using aggregateReturnType = tuple<partialAggregate, chrono::steady_clock::rep, number>;
+// returns tuple<projected columns of real records, thread overhead, # of processed requests>
+using projectionReturnType = tuple<projectedValues, chrono::steady_clock::rep, number>;
 
 void setOram(number oramNumber, string redisHost, vector<pair<number, bytes>> indices, number logCapacity, number blockSize, number z);
-vector<queryReturnType> runQuery(vector<pair<number, vector<number>>> blockIds, pair<number, number> query, bool twoAttributes, bool firstAttribute);
+vector<queryReturnType> runQuery(vector<pair<number, vector<number>>> blockIds, vector<rangeCondition> conditions);
+vector<aggregateReturnType> runAggregate(vector<pair<number, vector<number>>> blockIds, vector<rangeCondition> conditions, number field, number encoding);
+vector<projectionReturnType> runProjection(vector<pair<number, vector<number>>> blockIds, vector<rangeCondition> conditions, vector<projectedColumn> columns);
 pair<number, number> reset();
 
 int main(int argc, char* argv[])
@@ -53,6 +60,8 @@ int main(int argc, char* argv[])
 	rpc::server srv(PORT);
 	srv.bind("setOram", &setOram);
 	srv.bind("runQuery", &runQuery);
+	srv.bind("runAggregate", &runAggregate);
+	srv.bind("runProjection", &runProjection);
 	srv.bind("reset", &reset);
 	srv.run();
 
@@ -73,14 +82,26 @@ pair<number, number> reset()
 	return {rIngress, rEgress};
 }
 
-vector<queryReturnType> runQuery(vector<pair<number, vector<number>>> blockIds, pair<number, number> query, bool twoAttributes, bool firstAttribute)
+vector<queryReturnType> runQuery(vector<pair<number, vector<number>>> blockIds, vector<rangeCondition> conditions)
 {
-	cout << "runQuery: " << blockIds.size() << " sets, query={" << numberToSalary(query.first) << ", " << numberToSalary(query.second) << "}, firstAttribute: " << firstAttribute << endl;
+	cout << "runQuery: " << blockIds.size() << " sets, " << conditions.size() << " conditions" << endl;
 
-	auto queryOram = [](const vector<number>& ids, shared_ptr<PathORAM::ORAM> oram, number from, number to, bool twoAttributes, bool firstAttribute, promise<queryReturnType>* promise) -> void {
+	auto queryOram = [](const vector<number>& ids, const shared_ptr<PathORAM::ORAM>& oram, const vector<rangeCondition>& conditions, promise<queryReturnType>* promise) -> void {
 		vector<bytes> answer;
 		vector<bytes> realRecords;
 
+		// conjunctive queries have a condition for each column, and a block holds several records if they are packed
+		auto collect = [&conditions, &realRecords](const bytes& block) {
+			bytes record;
+			for (auto position = 0uLL; nextRecord(block, position, record);)
+			{
+				if (matchesConditions(record, conditions))
+				{
+					realRecords.push_back(move(record));
+				}
+			}
+		};
+
 		auto start = chrono::steady_clock::now();
 
 		if (ids.size() > 0)
@@ -89,67 +110,36 @@ vector<queryReturnType> runQuery(vector<pair<number, vector<number>>> blockIds,
 			{
 				answer.reserve(ids.size());
 				vector<pair<number, bytes>> requests;
-				requests.resize(ids.size());
-
-				transform(ids.begin(), ids.end(), requests.begin(), [](number id) { return make_pair(id, bytes()); });
+				requests.reserve(ids.size());
+				for (auto&& id : ids)
+				{
+					requests.emplace_back(id, bytes());
+				}
 				oram->multiple(requests, answer);
 			}
 			else
 			{
 				for (auto&& id : ids)
 				{
-					bytes record;
-					oram->get(id, record);
-					auto text = PathORAM::toText(record, ORAM_BLOCK_SIZE);
-
-					number salary;
-					if (twoAttributes)
-					{
-						vector<string> salaries;
-						boost::algorithm::split(salaries, text, boost::is_any_of(","));
-						salary = salaryToNumber(salaries[firstAttribute ? 0 : 1]);
-					}
-					else
-					{
-						salary = salaryToNumber(text);
-					}
-
-					if (salary >= from && salary <= to)
-					{
-						realRecords.push_back(record);
-					}
+					bytes block;
+					oram->get(id, block);
+
+					collect(block);
 				}
 			}
 
 			if (USE_ORAM_OPTIMIZATION)
 			{
-				for (auto&& record : answer)
+				for (auto&& block : answer)
 				{
-					auto text = PathORAM::toText(record, ORAM_BLOCK_SIZE);
-
-					number salary;
-					if (twoAttributes)
-					{
-						vector<string> salaries;
-						boost::algorithm::split(salaries, text, boost::is_any_of(","));
-						salary = salaryToNumber(salaries[firstAttribute ? 0 : 1]);
-					}
-					else
-					{
-						salary = salaryToNumber(text);
-					}
-
-					if (salary >= from && salary <= to)
-					{
-						realRecords.push_back(record);
-					}
+					collect(block);
 				}
 			}
 		}
 
 		auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
 
-		promise->set_value({realRecords, elapsed, ids.size()});
+		promise->set_value({move(realRecords), elapsed, ids.size()});
 	};
 
 	thread threads[orams.size()];
@@ -167,7 +157,7 @@ vector<queryReturnType> runQuery(vector<pair<number, vector<number>>> blockIds,
 		{
 			if (blockIdsSet.first == orams[i].first)
 			{
-				threads[i] = thread(queryOram, blockIdsSet.second, orams[i].second, query.first, query.second, twoAttributes, firstAttribute, &promises[i]);
+				threads[i] = thread(queryOram, cref(blockIdsSet.second), cref(orams[i].second), cref(conditions), &promises[i]);
 				break;
 			}
 		}
@@ -184,6 +174,44 @@ vector<queryReturnType> runQuery(vector<pair<number, vector<number>>> blockIds,
 	return result;
 }
 
+vector<aggregateReturnType> runAggregate(vector<pair<number, vector<number>>> blockIds, vector<rangeCondition> conditions, number field, number encoding)
+{
+	cout << "runAggregate: field " << field << endl;
+
+	// the records are fetched and matched as for runQuery, but only the partial aggregates are sent back
+	vector<aggregateReturnType> result;
+	for (auto&& [records, overhead, processed] : runQuery(move(blockIds), move(conditions)))
+	{
+		auto aggregate = emptyAggregate();
+		for (auto&& record : records)
+		{
+			aggregateRecord(aggregate, record, field, (COLUMN_ENCODING)encoding);
+		}
+		result.push_back({aggregate, overhead, processed});
+	}
+
+	return result;
+}
+
+vector<projectionReturnType> runProjection(vector<pair<number, vector<number>>> blockIds, vector<rangeCondition> conditions, vector<projectedColumn> columns)
+{
+	cout << "runProjection: " << columns.size() << " columns" << endl;
+
+	// the records are fetched and matched as for runQuery, but only the projected columns are sent back
+	vector<projectionReturnType> result;
+	for (auto&& [records, overhead, processed] : runQuery(move(blockIds), move(conditions)))
+	{
+		auto projection = emptyProjection(columns);
+		for (auto&& record : records)
+		{
+			projectRecord(projection, record, columns);
+		}
+		result.push_back({move(projection), overhead, processed});
+	}
+
+	return result;
+}
+
 void setOram(number oramNumber, string redisHost, vector<pair<number, bytes>> indices, number logCapacity, number blockSize, number z)
 {
 	ORAM_BLOCK_SIZE = blockSize;
@@ -0,0 +1,309 @@
+#include "overlay.hpp"
+
+#include "b-plus-tree/utility.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	namespace
+	{
+		const pair<number, number> DELETED = {ULLONG_MAX, ULLONG_MAX};
+
+		// reads a number at position (in bytes), advancing it, throws past the end
+		number getNumber(const uchar* input, number length, number& position)
+		{
+			if (position + sizeof(number) > length)
+			{
+				throw Exception("Index overlay is truncated");
+			}
+			number value;
+			memcpy(&value, input + position, sizeof(number));
+			position += sizeof(number);
+			return value;
+		}
+
+		void putNumber(uchar*& output, number value)
+		{
+			memcpy(output, &value, sizeof(number));
+			output += sizeof(number);
+		}
+	}
+
+	IndexOverlay::IndexOverlay(const vector<pair<number, bytes>>& index, const vector<number>& used, const vector<number>& capacities, number attributes) :
+		attributes(attributes),
+		capacities(capacities),
+		inserted(attributes),
+		usedBlocks(used),
+		liveRecords(used.size(), 0),
+		freeBlocks(used.size())
+	{
+		directory.reserve(index.size());
+		for (auto&& [value, locator] : index)
+		{
+			auto fromTree = BPlusTree::deconstructNumbers(locator);
+			directory.push_back({fromTree[0], fromTree[1]});
+			liveRecords[fromTree[0]]++;
+		}
+	}
+
+	IndexOverlay::IndexOverlay(const uchar* serialized, number length, const vector<number>& capacities) :
+		capacities(capacities)
+	{
+		auto position = 0uLL;
+		attributes	  = getNumber(serialized, length, position);
+		inserted.resize(attributes);
+
+		auto records = getNumber(serialized, length, position);
+		for (auto id = 0uLL; id < records; id++)
+		{
+			auto oram  = getNumber(serialized, length, position);
+			auto block = getNumber(serialized, length, position);
+			directory.push_back({oram, block});
+		}
+
+		auto orams = getNumber(serialized, length, position);
+		if (orams != capacities.size())
+		{
+			throw Exception(boost::format("Index overlay has %1% ORAMs, expected %2%") % orams % capacities.size());
+		}
+		usedBlocks.resize(orams);
+		liveRecords.resize(orams, 0);
+		freeBlocks.resize(orams);
+		for (auto i = 0uLL; i < orams; i++)
+		{
+			usedBlocks[i] = getNumber(serialized, length, position);
+			freeBlocks[i].resize(getNumber(serialized, length, position));
+			for (auto&& block : freeBlocks[i])
+			{
+				block = getNumber(serialized, length, position);
+			}
+		}
+		for (auto&& [oram, block] : directory)
+		{
+			if (oram != DELETED.first)
+			{
+				liveRecords[oram]++;
+			}
+		}
+
+		auto deleted = getNumber(serialized, length, position);
+		for (auto j = 0uLL; j < deleted; j++)
+		{
+			auto oram  = getNumber(serialized, length, position);
+			auto block = getNumber(serialized, length, position);
+			removed.insert({oram, block});
+		}
+
+		auto added = getNumber(serialized, length, position);
+		for (auto j = 0uLL; j < added; j++)
+		{
+			auto id = getNumber(serialized, length, position);
+			vector<number> recordValues(attributes);
+			for (auto&& value : recordValues)
+			{
+				value = getNumber(serialized, length, position);
+			}
+			for (auto a = 0uLL; a < attributes; a++)
+			{
+				inserted[a].insert({recordValues[a], id});
+			}
+			insertedValues[id] = move(recordValues);
+		}
+	}
+
+	number IndexOverlay::capacity(number logCapacity, number z)
+	{
+		return (1uLL << logCapacity) * z / 2;
+	}
+
+	pair<number, number> IndexOverlay::insert(const vector<number>& values, number oram)
+	{
+		auto id = directory.size();
+		return {id, place(id, values, oram)};
+	}
+
+	pair<pair<number, number>, number> IndexOverlay::update(number id, const vector<number>& values, number oram)
+	{
+		if (id >= directory.size() || directory[id] == DELETED)
+		{
+			throw Exception(boost::format("Record %1% does not exist") % id);
+		}
+		if (values.size() != attributes)
+		{
+			throw Exception(boost::format("Record has %1% indexed values, expected %2%") % values.size() % attributes);
+		}
+		if (directory[id].first != oram && freeBlocks[oram].size() == 0 && usedBlocks[oram] >= capacities[oram])
+		{
+			throw Exception(boost::format("ORAM %1% is full (%2% blocks)") % oram % capacities[oram]);
+		}
+
+		auto freed = remove(id);
+		return {freed, place(id, values, oram)};
+	}
+
+	pair<number, number> IndexOverlay::remove(number id)
+	{
+		if (id >= directory.size() || directory[id] == DELETED)
+		{
+			throw Exception(boost::format("Record %1% does not exist") % id);
+		}
+
+		auto locator = directory[id];
+		auto found	 = insertedValues.find(id);
+		if (found == insertedValues.end())
+		{
+			// the entries of the record are in the trees
+			removed.insert(locator);
+		}
+		else
+		{
+			for (auto a = 0uLL; a < attributes; a++)
+			{
+				auto [first, last] = inserted[a].equal_range(found->second[a]);
+				inserted[a].erase(find_if(first, last, [id](const pair<const number, number>& entry) { return entry.second == id; }));
+			}
+			insertedValues.erase(found);
+		}
+
+		directory[id] = DELETED;
+		liveRecords[locator.first]--;
+		freeBlocks[locator.first].push_back(locator.second);
+
+		return locator;
+	}
+
+	void IndexOverlay::search(number attribute, number from, number to, vector<bytes>& result) const
+	{
+		if (removed.size() > 0)
+		{
+			auto deleted = [this](const bytes& locator) {
+				auto fromTree = BPlusTree::deconstructNumbers(locator);
+				return removed.count({fromTree[0], fromTree[1]}) > 0;
+			};
+			result.erase(remove_if(result.begin(), result.end(), deleted), result.end());
+		}
+
+		for (auto entry = inserted[attribute].lower_bound(from); entry != inserted[attribute].end() && entry->first <= to; entry++)
+		{
+			auto [oram, block] = directory[entry->second];
+			result.push_back(BPlusTree::concatNumbers(2, oram, block));
+		}
+	}
+
+	number IndexOverlay::records() const
+	{
+		return directory.size();
+	}
+
+	number IndexOverlay::used(number oram) const
+	{
+		return usedBlocks[oram];
+	}
+
+	number IndexOverlay::live(number oram) const
+	{
+		return liveRecords[oram];
+	}
+
+	number IndexOverlay::serializedLength() const
+	{
+		auto numbers = 2 + 2 * directory.size() + 1 + 2 * usedBlocks.size() + 1 + 2 * removed.size() + 1 + insertedValues.size() * (1 + attributes);
+		for (auto&& blocks : freeBlocks)
+		{
+			numbers += blocks.size();
+		}
+		return numbers * sizeof(number);
+	}
+
+	void IndexOverlay::serialize(uchar* output) const
+	{
+		putNumber(output, attributes);
+		putNumber(output, directory.size());
+		for (auto&& [oram, block] : directory)
+		{
+			putNumber(output, oram);
+			putNumber(output, block);
+		}
+
+		putNumber(output, usedBlocks.size());
+		for (auto i = 0uLL; i < usedBlocks.size(); i++)
+		{
+			putNumber(output, usedBlocks[i]);
+			putNumber(output, freeBlocks[i].size());
+			for (auto&& block : freeBlocks[i])
+			{
+				putNumber(output, block);
+			}
+		}
+
+		putNumber(output, removed.size());
+		for (auto&& [oram, block] : removed)
+		{
+			putNumber(output, oram);
+			putNumber(output, block);
+		}
+
+		putNumber(output, insertedValues.size());
+		for (auto&& [id, recordValues] : insertedValues)
+		{
+			putNumber(output, id);
+			for (auto&& value : recordValues)
+			{
+				putNumber(output, value);
+			}
+		}
+	}
+
+	bytes IndexOverlay::serialize() const
+	{
+		bytes result(serializedLength());
+		serialize(result.data());
+		return result;
+	}
+
+	number IndexOverlay::allocate(number oram)
+	{
+		if (freeBlocks[oram].size() > 0)
+		{
+			auto block = freeBlocks[oram].back();
+			freeBlocks[oram].pop_back();
+			return block;
+		}
+		if (usedBlocks[oram] >= capacities[oram])
+		{
+			throw Exception(boost::format("ORAM %1% is full (%2% blocks)") % oram % capacities[oram]);
+		}
+		return usedBlocks[oram]++;
+	}
+
+	number IndexOverlay::place(number id, const vector<number>& values, number oram)
+	{
+		if (values.size() != attributes)
+		{
+			throw Exception(boost::format("Record has %1% indexed values, expected %2%") % values.size() % attributes);
+		}
+
+		auto block = allocate(oram);
+		if (id == directory.size())
+		{
+			directory.push_back({oram, block});
+		}
+		else
+		{
+			directory[id] = {oram, block};
+		}
+		liveRecords[oram]++;
+
+		for (auto a = 0uLL; a < attributes; a++)
+		{
+			inserted[a].insert({values[a], id});
+		}
+		insertedValues[id] = values;
+
+		return block;
+	}
+}
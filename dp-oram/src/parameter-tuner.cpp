@@ -0,0 +1,285 @@
+#include "definitions.h"
+#include "generator.hpp"
+#include "path-oram/utility.hpp"
+#include "tuner.hpp"
+#include "utility.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace DPORAM;
+
+namespace po = boost::program_options;
+namespace pt = boost::property_tree;
+
+const auto INPUT_FILES_DIR = string("../../experiments-scripts/output/");
+
+auto READ_INPUTS  = true;
+auto DATASET_TAG  = string("dataset-PUMS-louisiana");
+auto QUERYSET_TAG = string("queries-PUMS-louisiana-0.5-uniform");
+auto QUERIES	  = 100uLL;
+
+// synthetic inputs (if READ_INPUTS == false), same as main
+auto COUNT		   = 1000uLL;
+auto DISTRIBUTION  = Uniform;
+auto SKEW		   = 0.8;
+auto DISTINCT	   = 1000uLL;
+auto SELECTIVITY   = 0.005;
+auto HOTSPOT	   = 0.0;
+auto HOTSPOT_WIDTH = 0.1;
+auto SEED		   = 1305;
+
+auto CALIBRATE	 = false;
+auto STORAGE	 = InMemory;
+auto REDIS_HOST	 = string("tcp://127.0.0.1:6379");
+auto TOP		 = 10uLL;
+auto OUTPUT_FILE = string("tuning.json");
+
+int main(int argc, char* argv[])
+{
+	tuningSpace space;
+	hardwareProfile hardware;
+	double roundTrip = 0, bandwidth = 1000;
+
+	po::options_description desc("Parameter tuner; ranks ORAM count, fanout, buckets, levels and record size by predicted cost", 120);
+	desc.add_options()("help,h", "produce help message");
+	desc.add_options()("readInputs,r", po::value<bool>(&READ_INPUTS)->default_value(READ_INPUTS), "if set, will read inputs from files, otherwise will generate them as main does");
+	desc.add_options()("dataset", po::value<string>(&DATASET_TAG)->default_value(DATASET_TAG), "the dataset tag to use when reading dataset file");
+	desc.add_options()("queryset", po::value<string>(&QUERYSET_TAG)->default_value(QUERYSET_TAG), "the queryset tag to use when reading queryset file");
+	desc.add_options()("queries", po::value<number>(&QUERIES)->default_value(QUERIES), "number of sample queries to generate or read");
+	desc.add_options()("count", po::value<number>(&COUNT)->default_value(COUNT), "number of synthetic records to generate");
+	desc.add_options()("distribution", po::value<VALUE_DISTRIBUTION>(&DISTRIBUTION)->default_value(DISTRIBUTION), "the distribution of synthetic values");
+	desc.add_options()("skew", po::value<double>(&SKEW)->default_value(SKEW), "the skew of Zipf distribution of synthetic values, in (0, 1)");
+	desc.add_options()("distinct", po::value<number>(&DISTINCT)->default_value(DISTINCT), "the number of distinct synthetic values for Zipf and Duplicates distributions");
+	desc.add_options()("selectivity", po::value<double>(&SELECTIVITY)->default_value(SELECTIVITY), "the fraction of records each synthetic query matches");
+	desc.add_options()("hotspot", po::value<double>(&HOTSPOT)->default_value(HOTSPOT), "the fraction of synthetic queries that fall within the hotspot");
+	desc.add_options()("hotspotWidth", po::value<double>(&HOTSPOT_WIDTH)->default_value(HOTSPOT_WIDTH), "the width of the hotspot as a fraction of records");
+	desc.add_options()("seed", po::value<int>(&SEED)->default_value(SEED), "the seed of synthetic inputs");
+	desc.add_options()("oramsNumber,n", po::value<vector<number>>(&space.oramsNumbers)->multitoken()->default_value(space.oramsNumbers, "1 2 4 8 16 32 64"), "the numbers of ORAMs to consider");
+	desc.add_options()("fanout,k", po::value<vector<number>>(&space.fanouts)->multitoken()->default_value(space.fanouts, "2 4 8 16 32 64"), "the DP tree fanouts to consider");
+	desc.add_options()("recordSize", po::value<vector<number>>(&space.blockSizes)->multitoken()->default_value(space.blockSizes, "256 512 1024 2048 4096"), "the record sizes in bytes to consider");
+	desc.add_options()("oramsZ,z", po::value<number>(&space.z)->default_value(space.z), "the Z parameter for ORAMs");
+	desc.add_options()("beta", po::value<number>(&space.beta)->default_value(space.beta), "beta parameter for DP; x such that beta = 2^{-x}");
+	desc.add_options()("epsilon", po::value<double>(&space.epsilon)->default_value(space.epsilon), "epsilon parameter for DP");
+	desc.add_options()("useGamma", po::value<bool>(&space.gamma)->default_value(space.gamma), "if set, will use Gamma method to add noise per ORAM");
+	desc.add_options()("objective", po::value<TUNING_OBJECTIVE>(&space.objective)->default_value(space.objective), "what to minimize, query latency or bandwidth");
+	desc.add_options()("roundTrip", po::value<double>(&roundTrip)->default_value(roundTrip), "storage round trip in microseconds");
+	desc.add_options()("bandwidth", po::value<double>(&bandwidth)->default_value(bandwidth), "bandwidth between client and storage in MB/s");
+	desc.add_options()("byteCost", po::value<double>(&hardware.byteCost)->default_value(hardware.byteCost), "client work (encryption, stash) in nanoseconds per byte moved");
+	desc.add_options()("parallelism", po::value<number>(&hardware.parallelism)->default_value(hardware.parallelism), "the number of ORAMs served concurrently (e.g. cores or RPC hosts)");
+	desc.add_options()("batch", po::value<number>(&hardware.batchSize)->default_value(hardware.batchSize), "batch size of storage adapters");
+	desc.add_options()("calibrate", po::value<bool>(&CALIBRATE)->default_value(CALIBRATE), "if set, will measure client work, round trip and bandwidth instead of using the options above");
+	desc.add_options()("storage,s", po::value<ORAM_BACKEND>(&STORAGE)->default_value(STORAGE), "the storage backend to calibrate against");
+	desc.add_options()("redis", po::value<string>(&REDIS_HOST)->default_value(REDIS_HOST), "Redis host to calibrate against");
+	desc.add_options()("top", po::value<number>(&TOP)->default_value(TOP), "the number of best configurations to print");
+	desc.add_options()("output", po::value<string>(&OUTPUT_FILE)->default_value(OUTPUT_FILE), "the JSON file to write all ranked configurations to");
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if (vm.count("help"))
+	{
+		cout << desc << "\n";
+		exit(1);
+	}
+
+	try
+	{
+		setlocale(LC_ALL, "en_US.utf8");
+		locale loc("en_US.UTF-8");
+		std::wcout.imbue(loc);
+	}
+	catch (...)
+	{
+		wcerr << L"Could not set locale: en_US.UTF-8" << endl;
+	}
+
+	hardware.roundTrip = roundTrip * 1000;
+	hardware.bandwidth = bandwidth * 1024 * 1024;
+
+	vector<number> values;
+	vector<pair<number, number>> queries;
+	auto longestRecord = 0uLL;
+
+	if (READ_INPUTS)
+	{
+		auto dataFilePath = (boost::filesystem::path(INPUT_FILES_DIR) / (DATASET_TAG + ".csv")).string();
+		ifstream dataFile(dataFilePath);
+		if (!dataFile.is_open())
+		{
+			cerr << "File cannot be opened: " << dataFilePath << endl;
+			exit(1);
+		}
+
+		string line = "";
+		while (getline(dataFile, line))
+		{
+			values.push_back(salaryToNumber(line));
+			longestRecord = max(longestRecord, (number)line.size());
+		}
+		dataFile.close();
+
+		auto queryFilePath = (boost::filesystem::path(INPUT_FILES_DIR) / (QUERYSET_TAG + ".csv")).string();
+		ifstream queryFile(queryFilePath);
+		if (!queryFile.is_open())
+		{
+			cerr << "File cannot be opened: " << queryFilePath << endl;
+			exit(1);
+		}
+
+		while (getline(queryFile, line) && queries.size() < QUERIES)
+		{
+			vector<string> query;
+			boost::algorithm::split(query, line, boost::is_any_of(","));
+			queries.push_back({salaryToNumber(query[0]), salaryToNumber(query[1])});
+		}
+		queryFile.close();
+	}
+	else
+	{
+		// main fills synthetic records up to the record size, so only the values matter
+		datasetConfig config;
+		config.distribution = DISTRIBUTION;
+		config.count		= COUNT;
+		config.maxValue		= COUNT;
+		config.mean			= COUNT / 2.0;
+		config.deviation	= COUNT / 6.0;
+		config.skew			= SKEW;
+		config.distinct		= DISTINCT;
+		config.seed			= SEED;
+		DatasetGenerator generator(config);
+
+		for (auto i = 0uLL; i < COUNT; i++)
+		{
+			values.push_back(generator.value(i));
+			longestRecord = max(longestRecord, (number)generator.record(i).size());
+		}
+		queries = generator.queries(QUERIES, SELECTIVITY, HOTSPOT, HOTSPOT_WIDTH);
+	}
+
+	cout << "Dataset: " << values.size() << " records (longest is " << longestRecord << " bytes), " << queries.size() << " sample queries" << endl;
+
+	if (CALIBRATE)
+	{
+		// the largest record size is the most expensive per request, and the least affected by per-request overheads
+		auto blockSize = *max_element(space.blockSizes.begin(), space.blockSizes.end());
+
+		calibrateClient(hardware, blockSize, space.z);
+
+		auto file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("calibration-%%%%-%%%%.bin")).string();
+		shared_ptr<PathORAM::AbsStorageAdapter> storage;
+		switch (STORAGE)
+		{
+			case InMemory:
+				storage = make_shared<PathORAM::InMemoryStorageAdapter>(hardware.batchSize, blockSize, PathORAM::getRandomBlock(KEYSIZE), 1, hardware.batchSize);
+				break;
+			case FileSystem:
+				storage = make_shared<PathORAM::FileSystemStorageAdapter>(hardware.batchSize, blockSize, PathORAM::getRandomBlock(KEYSIZE), file, true, 1, hardware.batchSize);
+				break;
+			case Redis:
+				storage = make_shared<PathORAM::RedisStorageAdapter>(hardware.batchSize, blockSize, PathORAM::getRandomBlock(KEYSIZE), REDIS_HOST, true, 1, hardware.batchSize);
+				break;
+		}
+		calibrateStorage(hardware, storage);
+		storage.reset();
+		boost::filesystem::remove(file);
+	}
+
+	std::wcout
+		<< L"Hardware: round trip " << timeToString(hardware.roundTrip)
+		<< L", bandwidth " << bytesToString(hardware.bandwidth) << L"/s"
+		<< L", client " << hardware.byteCost << L" ns/byte"
+		<< L", " << hardware.parallelism << L" ORAMs in parallel"
+		<< endl
+		<< endl;
+
+	auto results = tune(values, queries, longestRecord, space, hardware);
+	if (results.size() == 0)
+	{
+		cerr << "No feasible configuration; consider smaller fanouts or larger record sizes" << endl;
+		exit(1);
+	}
+
+	cout << "| Rank | ORAMs | Fanout | Buckets | Levels | Record size |     Mu | Real records | Fetched records | Bandwidth |  Latency |" << endl;
+	cout << "| ---: | ----: | -----: | ------: | -----: | ----------: | -----: | -----------: | --------------: | --------: | -------: |" << endl;
+
+	pt::ptree ranked;
+	for (auto i = 0uLL; i < results.size(); i++)
+	{
+		auto&& result = results[i];
+
+		pt::ptree entry;
+		entry.put("ORAMS_NUMBER", result.oramsNumber);
+		entry.put("DP_K", result.fanout);
+		entry.put("DP_BUCKETS", result.buckets);
+		entry.put("DP_LEVELS", result.levels);
+		entry.put("ORAM_BLOCK_SIZE", result.blockSize);
+		entry.put("DP_MU", result.mu);
+		entry.put("real", result.real);
+		entry.put("records", result.records);
+		entry.put("bytes", result.bytes);
+		entry.put("latency", result.latency);
+		ranked.push_back({"", entry});
+
+		if (i < TOP)
+		{
+			std::wcout
+				<< "| "
+				<< setw(4) << i + 1
+				<< " | "
+				<< setw(5) << result.oramsNumber
+				<< " | "
+				<< setw(6) << result.fanout
+				<< " | "
+				<< setw(7) << result.buckets
+				<< " | "
+				<< setw(6) << result.levels
+				<< " | "
+				<< setw(11) << bytesToString(result.blockSize)
+				<< " | "
+				<< setw(6) << result.mu
+				<< " | "
+				<< setw(12) << (number)result.real
+				<< " | "
+				<< setw(15) << (number)result.records
+				<< " | "
+				<< setw(9) << bytesToString(result.bytes)
+				<< " | "
+				<< setw(8) << timeToString(result.latency)
+				<< " |"
+				<< endl;
+		}
+	}
+
+	auto best = results[0];
+	auto recommendation =
+		boost::str(boost::format("-n %1% -k %2% -b %3% --levels %4% --recordSize %5% -z %6% --beta %7% --epsilon %8% --useGamma %9%") % best.oramsNumber % best.fanout % best.buckets % best.levels % best.blockSize % space.z % space.beta % space.epsilon % space.gamma);
+
+	cout << endl
+		 << "Recommended: bin/main " << recommendation << endl;
+
+	pt::ptree hardwareTree;
+	hardwareTree.put("roundTrip", hardware.roundTrip);
+	hardwareTree.put("bandwidth", hardware.bandwidth);
+	hardwareTree.put("byteCost", hardware.byteCost);
+	hardwareTree.put("parallelism", hardware.parallelism);
+	hardwareTree.put("batchSize", hardware.batchSize);
+
+	wstring_convert<codecvt_utf8_utf16<wchar_t>> converter;
+	pt::ptree root;
+	root.put("objective", converter.to_bytes(TUNING_OBJECTIVE_strings[space.objective]));
+	root.put("recommendation", recommendation);
+	root.add_child("hardware", hardwareTree);
+	root.add_child("results", ranked);
+	pt::write_json(OUTPUT_FILE, root);
+
+	cout << "Results written to " << OUTPUT_FILE << endl;
+
+	return 0;
+}
@@ -1,40 +1,51 @@
-#include "b-plus-tree/tree.hpp"
-#include "b-plus-tree/utility.hpp"
 #include "definitions.h"
+#include "ingest.hpp"
 #include "utility.hpp"
+#include "workload.hpp"
 
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <iomanip>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <chrono>
 #include <iostream>
+#include <numeric>
 
 using namespace std;
 using namespace DPORAM;
 
 namespace po = boost::program_options;
+namespace pt = boost::property_tree;
 
 const auto INPUT_FILES_DIR = string("../../experiments-scripts/output/");
-const auto FILES_DIR	   = string("./storage-files");
 
 auto DATASET_TAG  = string("270K-1.7M-uniform");
 auto QUERYSET_TAG = string("270K-1.7M-uniform-500");
 
-auto GENERATE_INDICES = true;
-auto VERBOSE		  = false;
+auto VERBOSE   = false;
+auto DATA_SIZE = 0uLL;
+auto BUCKETS   = 0uLL;
+auto FANOUT	   = 16uLL;
+auto THREADS   = 0uLL;
+auto OUTPUT	   = string("");
 
-const auto TREE_BLOCK_SIZE = 64uLL;
-const auto TREE_FILE	   = string("tree");
-number DATA_SIZE;
+template <class T>
+pt::ptree toArray(const vector<T>& values);
+pt::ptree percentiles(const vector<number>& values);
+number elapsedSince(chrono::steady_clock::time_point start);
 
 int main(int argc, char* argv[])
 {
 	po::options_description desc("Query deducer", 120);
 	desc.add_options()("help,h", "produce help message");
-	desc.add_options()("generate,g", po::value<bool>(&GENERATE_INDICES)->default_value(GENERATE_INDICES), "if set, will (re)generate tree indices, otherwise will read files");
 	desc.add_options()("verbose,v", po::value<bool>(&VERBOSE)->default_value(VERBOSE), "if set, will print query results sizes");
-	desc.add_options()("size", po::value<number>(&DATA_SIZE)->required(), "the number of datapoints to correctly compute selectivity");
+	desc.add_options()("size", po::value<number>(&DATA_SIZE)->default_value(DATA_SIZE), "the number of datapoints to compute selectivity against (0 for the dataset size)");
 	desc.add_options()("dataset", po::value<string>(&DATASET_TAG)->default_value(DATASET_TAG), "the dataset tag to use when reading dataset file");
 	desc.add_options()("queryset", po::value<string>(&QUERYSET_TAG)->default_value(QUERYSET_TAG), "the queryset tag to use when reading queryset file");
+	desc.add_options()("bucketsNumber,b", po::value<number>(&BUCKETS)->default_value(BUCKETS), "the number of buckets for histograms (if 0, will choose as main does, the max power of fanout less than the domain size)");
+	desc.add_options()("fanout,k", po::value<number>(&FANOUT)->default_value(FANOUT), "DP tree fanout, to choose the number of buckets");
+	desc.add_options()("threads", po::value<number>(&THREADS)->default_value(THREADS), "the number of threads to parse, sort and query with (0 for all cores)");
+	desc.add_options()("output", po::value<string>(&OUTPUT)->default_value(OUTPUT), "if set, will write the histograms and statistics to this JSON file");
 
 	po::variables_map vm;
 	po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -46,37 +57,24 @@ int main(int argc, char* argv[])
 		exit(1);
 	}
 
-	auto treeStorage = make_shared<BPlusTree::FileSystemStorageAdapter>(TREE_BLOCK_SIZE, (boost::filesystem::path(FILES_DIR) / (TREE_FILE + ".bin")).string(), GENERATE_INDICES);
-	shared_ptr<BPlusTree::Tree> tree;
-
-	if (GENERATE_INDICES)
+	auto dataFilePath = (boost::filesystem::path(INPUT_FILES_DIR) / (DATASET_TAG + ".csv")).string();
+	if (!boost::filesystem::exists(dataFilePath))
 	{
-		cout << "Generating tree" << endl;
-
-		vector<pair<number, bytes>> treeIndex;
+		cerr << "File cannot be opened: " << dataFilePath << endl;
+		exit(1);
+	}
 
-		auto dataFilePath = (boost::filesystem::path(INPUT_FILES_DIR) / (DATASET_TAG + ".csv")).string();
-		ifstream dataFile(dataFilePath);
-		if (!dataFile.is_open())
-		{
-			cerr << "File cannot be opened: " << dataFilePath << endl;
-			exit(1);
-		}
+	cout << "Reading dataset" << endl;
 
-		string line = "";
-		while (getline(dataFile, line))
-		{
-			treeIndex.push_back({salaryToNumber(line), bytes()});
-		}
-		dataFile.close();
+	auto start = chrono::steady_clock::now();
+	auto keys  = ingestKeys(dataFilePath, THREADS);
+	parallelSort(keys, THREADS);
 
-		tree = make_shared<BPlusTree::Tree>(treeStorage, treeIndex);
+	cout << "Size: " << keys.size() << " (read and sorted in " << elapsedSince(start) / 1000000 << " ms)" << endl;
 
-		cout << "Size: " << treeIndex.size() << endl;
-	}
-	else
+	if (DATA_SIZE == 0)
 	{
-		tree = make_shared<BPlusTree::Tree>(treeStorage);
+		DATA_SIZE = keys.size();
 	}
 
 	cout << "Reading queries" << endl;
@@ -102,20 +100,17 @@ int main(int argc, char* argv[])
 	}
 	queryFile.close();
 
-	vector<number> responseSizes;
-	for (auto&& query : queries)
-	{
-		vector<bytes> response;
-		tree->search(query.first, query.second, response);
-		responseSizes.push_back(response.size());
+	start			   = chrono::steady_clock::now();
+	auto responseSizes = rangeCounts(keys, queries, THREADS);
+
+	cout << "Counted " << queries.size() << " queries in " << elapsedSince(start) / 1000000 << " ms" << endl;
 
-		if (VERBOSE)
-		{
-			cout << response.size() << "\t";
-		}
-	}
 	if (VERBOSE)
 	{
+		for (auto&& size : responseSizes)
+		{
+			cout << size << "\t";
+		}
 		cout << endl;
 	}
 
@@ -126,6 +121,101 @@ int main(int argc, char* argv[])
 	double stddev = sqrt(sq_sum / responseSizes.size() - mean * mean);
 
 	cout << "For " << DATA_SIZE << " datapoints, average selectivity is " << (mean / DATA_SIZE) * 100 << "%, stddev: " << stddev << ", avg result size: " << mean << endl;
+	cout << "Result size p50: " << percentile(responseSizes, 50) << ", p90: " << percentile(responseSizes, 90) << ", p99: " << percentile(responseSizes, 99) << ", max: " << percentile(responseSizes, 100) << endl;
+
+	// IMPORTANT: salaries are in cents, but we still compute domain in dollars
+	vector<number> widths;
+	for (auto&& [left, right] : queries)
+	{
+		widths.push_back(right >= left ? (right - left) / 100 : 0);
+	}
+	cout << "Range width (dollars) p50: " << percentile(widths, 50) << ", p90: " << percentile(widths, 90) << ", p99: " << percentile(widths, 99) << ", max: " << percentile(widths, 100) << endl;
+
+	if (keys.size() == 0)
+	{
+		return 0;
+	}
+
+	auto domain = (keys.back() - keys.front()) / 100;
+	if (BUCKETS == 0)
+	{
+		BUCKETS = 1;
+		while (FANOUT > 1 && BUCKETS * FANOUT <= domain)
+		{
+			BUCKETS *= FANOUT;
+		}
+	}
+
+	start		   = chrono::steady_clock::now();
+	auto histogram = histograms(keys, queries, BUCKETS, THREADS);
+
+	cout << "Histograms over " << BUCKETS << " buckets built in " << elapsedSince(start) / 1000000 << " ms" << endl;
+
+	auto emptyBuckets = count(histogram.records.begin(), histogram.records.end(), 0uLL);
+	auto fullest	  = max_element(histogram.records.begin(), histogram.records.end()) - histogram.records.begin();
+	auto hottest	  = max_element(histogram.queries.begin(), histogram.queries.end()) - histogram.queries.begin();
+
+	cout << "Records per bucket: " << DATA_SIZE / BUCKETS << " on average, " << histogram.records[fullest] << " at most (bucket " << fullest << "), " << emptyBuckets << " buckets empty" << endl;
+	cout << "Queries per bucket: " << histogram.queries[hottest] << " at most (bucket " << hottest << "), " << histogram.spans[0] << " queries outside the data" << endl;
+
+	vector<number> spans;
+	for (auto s = 1uLL; s < histogram.spans.size(); s++)
+	{
+		spans.insert(spans.end(), histogram.spans[s], s);
+	}
+	cout << "Range width (buckets) p50: " << percentile(spans, 50) << ", p90: " << percentile(spans, 90) << ", p99: " << percentile(spans, 99) << ", max: " << percentile(spans, 100) << endl;
+
+	if (OUTPUT != "")
+	{
+		pt::ptree root;
+		root.put("dataset", DATASET_TAG);
+		root.put("queryset", QUERYSET_TAG);
+		root.put("records", keys.size());
+		root.put("queries", queries.size());
+		root.put("buckets", BUCKETS);
+		root.put("minValue", numberToSalary(keys.front()));
+		root.put("maxValue", numberToSalary(keys.back()));
+		root.put("meanSelectivity", mean / DATA_SIZE);
+		root.put("meanResult", mean);
+		root.put("stddevResult", stddev);
+		root.add_child("bucketRecords", toArray(histogram.records));
+		root.add_child("bucketQueries", toArray(histogram.queries));
+		root.add_child("spans", toArray(histogram.spans));
+		root.add_child("widths", percentiles(widths));
+		root.add_child("results", percentiles(responseSizes));
+
+		pt::write_json(OUTPUT, root);
+
+		cout << "Histograms written to " << OUTPUT << endl;
+	}
 
 	return 0;
 }
+
+template <class T>
+pt::ptree toArray(const vector<T>& values)
+{
+	pt::ptree array;
+	for (auto&& value : values)
+	{
+		pt::ptree element;
+		element.put("", value);
+		array.push_back({"", element});
+	}
+	return array;
+}
+
+pt::ptree percentiles(const vector<number>& values)
+{
+	pt::ptree result;
+	result.put("p50", percentile(values, 50));
+	result.put("p90", percentile(values, 90));
+	result.put("p99", percentile(values, 99));
+	result.put("max", percentile(values, 100));
+	return result;
+}
+
+number elapsedSince(chrono::steady_clock::time_point start)
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
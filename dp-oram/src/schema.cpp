@@ -0,0 +1,314 @@
+#include "schema.hpp"
+
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	datasetSchema parseSchema(const string& description)
+	{
+		datasetSchema schema;
+
+		vector<string> columns;
+		boost::algorithm::split(columns, description, boost::is_any_of(","));
+		for (auto&& text : columns)
+		{
+			vector<string> fields;
+			boost::algorithm::split(fields, text, boost::is_any_of(":"));
+			if (fields.size() > 3 || fields[0] == "")
+			{
+				throw Exception(boost::format("Malformed schema column: '%1%'") % text);
+			}
+
+			column result{fields[0]};
+			if (fields.size() > 1)
+			{
+				istringstream encoding(fields[1]);
+				encoding >> result.encoding;
+				if (encoding.fail())
+				{
+					throw Exception(boost::format("Unknown encoding '%1%' of column %2%") % fields[1] % result.name);
+				}
+			}
+			if (fields.size() > 2)
+			{
+				if (fields[2] != "indexed")
+				{
+					throw Exception(boost::format("Unknown flag '%1%' of column %2%") % fields[2] % result.name);
+				}
+				result.indexed = true;
+			}
+
+			if (result.indexed && result.encoding == Text)
+			{
+				throw Exception(boost::format("Text column %1% cannot be indexed") % result.name);
+			}
+			for (auto&& other : schema.columns)
+			{
+				if (other.name == result.name)
+				{
+					throw Exception(boost::format("Column %1% is repeated") % result.name);
+				}
+			}
+
+			if (result.indexed)
+			{
+				schema.indexed.push_back(schema.columns.size());
+			}
+			schema.columns.push_back(result);
+		}
+
+		if (schema.indexed.size() == 0)
+		{
+			throw Exception(boost::format("Schema '%1%' has no indexed columns") % description);
+		}
+
+		return schema;
+	}
+
+	datasetSchema defaultSchema(number attributes)
+	{
+		datasetSchema schema;
+		for (auto i = 0uLL; i < attributes; i++)
+		{
+			schema.columns.push_back({"attribute" + to_string(i + 1), Decimal, true});
+			schema.indexed.push_back(i);
+		}
+		return schema;
+	}
+
+	number columnPosition(const datasetSchema& schema, const string& name)
+	{
+		for (auto i = 0uLL; i < schema.columns.size(); i++)
+		{
+			if (schema.columns[i].name == name)
+			{
+				return i;
+			}
+		}
+		throw Exception(boost::format("Schema does not have column %1%") % name);
+	}
+
+	number encodeValue(const string& text, COLUMN_ENCODING encoding)
+	{
+		char* end;
+		long long value;
+		switch (encoding)
+		{
+			case Decimal:
+				// exactly as salaryToNumber
+				value = (long long)(strtod(text.c_str(), &end) * 100);
+				break;
+			case Integer:
+				value = strtoll(text.c_str(), &end, 10);
+				break;
+			default:
+				throw Exception(boost::format("Text value '%1%' cannot be encoded") % text);
+		}
+
+		if (end == text.c_str())
+		{
+			throw Exception(boost::format("Cannot parse value from '%1%'") % text);
+		}
+		if ((number)(value + OFFSET) >= ULLONG_MAX / 2)
+		{
+			throw Exception(boost::format("Looks like one of the data points (%1%) is smaller than minus OFFSET (-%2%)") % text % OFFSET);
+		}
+
+		return (number)(value + OFFSET);
+	}
+
+	number encodingScale(COLUMN_ENCODING encoding)
+	{
+		return encoding == Decimal ? 100 : 1;
+	}
+
+	number valueFromRecord(const bytes& record, number field, COLUMN_ENCODING encoding)
+	{
+		if (encoding != Integer)
+		{
+			return salaryFromRecord(record, field);
+		}
+
+		// integers are parsed as encodeValue does, through a double they would lose precision above 2^53
+		auto position = 0uLL;
+		for (auto skipped = 0uLL; skipped < field; position++)
+		{
+			if (position == record.size() || record[position] == '\0')
+			{
+				throw Exception(boost::format("Record does not have field %1%") % field);
+			}
+			if (record[position] == ',')
+			{
+				skipped++;
+			}
+		}
+
+		// enough for any 64-bit integer
+		char buffer[32];
+		auto length = 0uLL;
+		while (position < record.size() && length < sizeof(buffer) - 1 && record[position] != ',' && record[position] != '\0')
+		{
+			buffer[length++] = record[position++];
+		}
+		buffer[length] = '\0';
+
+		char* end;
+		auto value = strtoll(buffer, &end, 10);
+		if (end == buffer)
+		{
+			throw Exception(boost::format("Cannot parse value from record field %1%") % field);
+		}
+		return (number)(value + OFFSET);
+	}
+
+	bool nextRecord(const bytes& block, number& position, bytes& record)
+	{
+		if (position >= block.size() || block[position] == '\0')
+		{
+			return false;
+		}
+
+		auto end = position;
+		while (end < block.size() && block[end] != '\n' && block[end] != '\0')
+		{
+			end++;
+		}
+		record.assign(block.begin() + position, block.begin() + end);
+		position = end < block.size() && block[end] == '\n' ? end + 1 : end;
+
+		return true;
+	}
+
+	bool matchesConditions(const bytes& record, const vector<rangeCondition>& conditions)
+	{
+		for (auto&& [field, encoding, from, to] : conditions)
+		{
+			auto value = valueFromRecord(record, field, (COLUMN_ENCODING)encoding);
+			if (value < from || value > to)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	partialAggregate emptyAggregate()
+	{
+		return {0, 0, ULLONG_MAX, 0};
+	}
+
+	void aggregateRecord(partialAggregate& aggregate, const bytes& record, number field, COLUMN_ENCODING encoding)
+	{
+		auto& [count, sum, min, max] = aggregate;
+		count++;
+
+		if (encoding != Text)
+		{
+			auto value = valueFromRecord(record, field, encoding);
+			sum += (long long)value - OFFSET;
+			min = std::min(min, value);
+			max = std::max(max, value);
+		}
+	}
+
+	void mergeAggregates(partialAggregate& aggregate, const partialAggregate& other)
+	{
+		auto& [count, sum, min, max] = aggregate;
+		count += get<0>(other);
+		sum += get<1>(other);
+		min = std::min(min, get<2>(other));
+		max = std::max(max, get<3>(other));
+	}
+
+	double aggregateValue(const partialAggregate& aggregate, AGGREGATE_FUNCTION function, COLUMN_ENCODING encoding)
+	{
+		auto [count, sum, min, max] = aggregate;
+		auto scale					= (double)encodingScale(encoding);
+
+		if (function == ACount)
+		{
+			return count;
+		}
+		if (function == ASum)
+		{
+			return sum / scale;
+		}
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		switch (function)
+		{
+			case AMin:
+				return ((long long)min - OFFSET) / scale;
+			case AMax:
+				return ((long long)max - OFFSET) / scale;
+			case AAvg:
+				return sum / scale / count;
+			default:
+				throw Exception(boost::format("No value for aggregate function %1%") % function);
+		}
+	}
+
+	string textFromRecord(const bytes& record, number field)
+	{
+		// a text record is zero-padded to the block size
+		auto position = 0uLL;
+		for (auto skipped = 0uLL; skipped < field; position++)
+		{
+			if (position == record.size() || record[position] == '\0')
+			{
+				throw Exception(boost::format("Record does not have field %1%") % field);
+			}
+			if (record[position] == ',')
+			{
+				skipped++;
+			}
+		}
+
+		auto end = position;
+		while (end < record.size() && record[end] != ',' && record[end] != '\0')
+		{
+			end++;
+		}
+		return string(record.begin() + position, record.begin() + end);
+	}
+
+	projectedValues emptyProjection(const vector<projectedColumn>& columns)
+	{
+		auto texts = (number)count_if(columns.begin(), columns.end(), [](const projectedColumn& column) { return column.second == Text; });
+		return {vector<vector<number>>(columns.size() - texts), vector<vector<string>>(texts)};
+	}
+
+	void projectRecord(projectedValues& projection, const bytes& record, const vector<projectedColumn>& columns)
+	{
+		auto numbers = 0uLL, texts = 0uLL;
+		for (auto&& [field, encoding] : columns)
+		{
+			if (encoding == Text)
+			{
+				projection.second[texts++].push_back(textFromRecord(record, field));
+			}
+			else
+			{
+				projection.first[numbers++].push_back(valueFromRecord(record, field, (COLUMN_ENCODING)encoding));
+			}
+		}
+	}
+
+	number projectedRows(const projectedValues& projection)
+	{
+		if (projection.first.size() > 0)
+		{
+			return projection.first[0].size();
+		}
+		return projection.second.size() > 0 ? projection.second[0].size() : 0;
+	}
+}
@@ -0,0 +1,439 @@
+#include "snapshot.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	namespace
+	{
+		const char MAGIC[8] = {'D', 'P', 'O', 'R', 'A', 'M', 'S', 'S'};
+
+		// sections start on page boundaries
+		const number ALIGNMENT = 4096;
+
+		struct snapshotHeader
+		{
+			char magic[8];
+			number version;
+			number fingerprint;
+			number sections;
+		};
+
+		struct snapshotSection
+		{
+			number type;
+			number id;
+			number offset;
+			number length;
+			number checksum;
+		};
+
+		number align(number offset)
+		{
+			return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+		}
+
+		// runs task(0) ... task(count - 1) on threads, each thread picks the next index when done,
+		// so that a few large sections do not hold up the rest; rethrows the first exception
+		void parallelFor(number count, number threads, function<void(number)> task)
+		{
+			threads = min(threads > 0 ? threads : max(thread::hardware_concurrency(), 1u), max(count, 1uLL));
+
+			atomic<number> next{0};
+			vector<future<void>> workers;
+			for (auto t = 0uLL; t < threads; t++)
+			{
+				workers.push_back(async(launch::async, [&next, count, &task]() {
+					for (auto i = next++; i < count; i = next++)
+					{
+						task(i);
+					}
+				}));
+			}
+			for (auto&& worker : workers)
+			{
+				worker.get();
+			}
+		}
+	}
+
+	number fingerprint(const vector<string>& parts)
+	{
+		auto hash = 14695981039346656037uLL;
+		auto mix  = [&hash](uchar byte) {
+			hash ^= byte;
+			hash *= 1099511628211uLL;
+		};
+
+		for (auto&& part : parts)
+		{
+			for (auto&& character : part)
+			{
+				mix(character);
+			}
+			mix(0);
+		}
+
+		return hash;
+	}
+
+	number checksum(const uchar* data, number length)
+	{
+		auto hash  = 0x9E3779B97F4A7C15uLL ^ length;
+		auto words = length / sizeof(number);
+
+		for (auto i = 0uLL; i < words; i++)
+		{
+			number word;
+			memcpy(&word, data + i * sizeof(number), sizeof(number));
+			hash = (hash ^ word) * 0xFF51AFD7ED558CCDuLL;
+			hash ^= hash >> 32;
+		}
+		for (auto i = words * sizeof(number); i < length; i++)
+		{
+			hash = (hash ^ data[i]) * 0xFF51AFD7ED558CCDuLL;
+			hash ^= hash >> 32;
+		}
+
+		return hash;
+	}
+
+	Snapshot::Snapshot(const string& path)
+	{
+		auto descriptor = open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+		{
+			throw Exception(boost::format("Snapshot cannot be opened: %1%") % path);
+		}
+
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || (number)status.st_size < sizeof(snapshotHeader))
+		{
+			close(descriptor);
+			throw Exception(boost::format("Snapshot is truncated: %1%") % path);
+		}
+		length = status.st_size;
+
+		// private and writable, so that sections can be modified in memory
+		auto address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+		close(descriptor);
+		if (address == MAP_FAILED)
+		{
+			throw Exception(boost::format("Snapshot cannot be mapped: %1%") % path);
+		}
+		mapped = (uchar*)address;
+
+		auto header = (const snapshotHeader*)mapped;
+		if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+		{
+			munmap(mapped, length);
+			throw Exception(boost::format("Not a snapshot: %1%") % path);
+		}
+		if (header->version != SNAPSHOT_VERSION)
+		{
+			munmap(mapped, length);
+			throw Exception(boost::format("Snapshot %1% has version %2%, expected %3%") % path % header->version % SNAPSHOT_VERSION);
+		}
+		if (sizeof(snapshotHeader) + header->sections * sizeof(snapshotSection) > length)
+		{
+			munmap(mapped, length);
+			throw Exception(boost::format("Snapshot is truncated: %1%") % path);
+		}
+		stamp = header->fingerprint;
+
+		auto table = (const snapshotSection*)(mapped + sizeof(snapshotHeader));
+		for (auto i = 0uLL; i < header->sections; i++)
+		{
+			if (table[i].offset > length || table[i].length > length - table[i].offset)
+			{
+				munmap(mapped, length);
+				throw Exception(boost::format("Snapshot is truncated: %1%") % path);
+			}
+			sections[{table[i].type, table[i].id}] = {table[i].offset, table[i].length, table[i].checksum};
+		}
+	}
+
+	Snapshot::~Snapshot()
+	{
+		munmap(mapped, length);
+	}
+
+	number Snapshot::fingerprint() const
+	{
+		return stamp;
+	}
+
+	bool Snapshot::has(SNAPSHOT_SECTION type, number id) const
+	{
+		return sections.count({type, id}) > 0;
+	}
+
+	void Snapshot::verify(number threads) const
+	{
+		vector<pair<pair<number, number>, tuple<number, number, number>>> entries(sections.begin(), sections.end());
+
+		parallelFor(entries.size(), threads, [this, &entries](number i) {
+			auto [key, section]				= entries[i];
+			auto [offset, length, expected] = section;
+			if (checksum(mapped + offset, length) != expected)
+			{
+				throw Exception(boost::format("Snapshot section %1% with ID %2% is corrupted") % key.first % key.second);
+			}
+		});
+	}
+
+	pair<uchar*, number> Snapshot::section(SNAPSHOT_SECTION type, number id) const
+	{
+		auto found = sections.find({type, id});
+		if (found == sections.end())
+		{
+			throw Exception(boost::format("Snapshot does not have section %1% with ID %2%") % type % id);
+		}
+
+		return {mapped + get<0>(found->second), get<1>(found->second)};
+	}
+
+	SnapshotWriter::SnapshotWriter(number fingerprint) :
+		stamp(fingerprint)
+	{
+	}
+
+	void SnapshotWriter::add(SNAPSHOT_SECTION type, number id, number length, function<void(uchar*)> fill)
+	{
+		sections[{type, id}] = {length, fill, nullptr};
+	}
+
+	void SnapshotWriter::add(SNAPSHOT_SECTION type, number id, function<bytes()> produce)
+	{
+		sections[{type, id}] = {0, nullptr, produce};
+	}
+
+	void SnapshotWriter::remove(SNAPSHOT_SECTION type, number id)
+	{
+		sections.erase({type, id});
+	}
+
+	void SnapshotWriter::write(const string& path, number threads) const
+	{
+		vector<const pendingSection*> pending;
+		for (auto&& [key, section] : sections)
+		{
+			pending.push_back(&section);
+		}
+
+		// sections of unknown length are produced first, since they define the layout
+		vector<bytes> produced(pending.size());
+		parallelFor(pending.size(), threads, [&pending, &produced](number i) {
+			if (pending[i]->produce)
+			{
+				produced[i] = pending[i]->produce();
+			}
+		});
+
+		// layout: header, table, then page-aligned sections
+		vector<snapshotSection> table;
+		auto size = align(sizeof(snapshotHeader) + sections.size() * sizeof(snapshotSection));
+		for (auto&& [key, section] : sections)
+		{
+			auto length = section.produce ? produced[table.size()].size() : section.length;
+			table.push_back({key.first, key.second, size, length, 0});
+			size = align(size + length);
+		}
+
+		auto temporary	= path + ".tmp";
+		auto descriptor = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (descriptor < 0)
+		{
+			throw Exception(boost::format("Snapshot cannot be created: %1%") % temporary);
+		}
+		// every failure from here until the rename leaves no temporary file behind
+		auto address = MAP_FAILED;
+		try
+		{
+			if (ftruncate(descriptor, size) != 0)
+			{
+				throw Exception(boost::format("Snapshot cannot be allocated: %1%") % temporary);
+			}
+
+			address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+			if (address == MAP_FAILED)
+			{
+				throw Exception(boost::format("Snapshot cannot be mapped: %1%") % temporary);
+			}
+			auto output = (uchar*)address;
+
+			// each section is filled and checksummed while its pages are hot
+			parallelFor(pending.size(), threads, [&pending, &produced, &table, output](number i) {
+				auto destination = output + table[i].offset;
+				if (pending[i]->produce)
+				{
+					if (produced[i].size() > 0)
+					{
+						memcpy(destination, produced[i].data(), produced[i].size());
+					}
+					bytes().swap(produced[i]);
+				}
+				else
+				{
+					pending[i]->fill(destination);
+				}
+				table[i].checksum = checksum(destination, table[i].length);
+			});
+
+			snapshotHeader header;
+			memcpy(header.magic, MAGIC, sizeof(MAGIC));
+			header.version	   = SNAPSHOT_VERSION;
+			header.fingerprint = stamp;
+			header.sections	   = table.size();
+			memcpy(output, &header, sizeof(header));
+			memcpy(output + sizeof(header), table.data(), table.size() * sizeof(snapshotSection));
+
+			munmap(address, size);
+			address		= MAP_FAILED;
+			auto synced = fsync(descriptor) == 0;
+			close(descriptor);
+			descriptor = -1;
+
+			if (!synced || rename(temporary.c_str(), path.c_str()) != 0)
+			{
+				throw Exception(boost::format("Snapshot cannot be written: %1%") % path);
+			}
+		}
+		catch (...)
+		{
+			if (address != MAP_FAILED)
+			{
+				munmap(address, size);
+			}
+			if (descriptor >= 0)
+			{
+				close(descriptor);
+			}
+			::remove(temporary.c_str());
+			throw;
+		}
+
+		// the rename is durable only once the directory is synced
+		auto slash				 = path.find_last_of('/');
+		auto directory			 = slash == string::npos ? string(".") : slash == 0 ? string("/") : path.substr(0, slash);
+		auto directoryDescriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+		if (directoryDescriptor < 0)
+		{
+			throw Exception(boost::format("Snapshot directory cannot be opened: %1%") % path);
+		}
+		auto synced = fsync(directoryDescriptor) == 0;
+		close(directoryDescriptor);
+		if (!synced)
+		{
+			throw Exception(boost::format("Snapshot cannot be synced: %1%") % path);
+		}
+	}
+
+	SnapshotPositionMapAdapter::SnapshotPositionMapAdapter(number capacity) :
+		owned(capacity, 0),
+		positions(owned.data()),
+		capacity(capacity)
+	{
+	}
+
+	SnapshotPositionMapAdapter::SnapshotPositionMapAdapter(shared_ptr<Snapshot> snapshot, number oram, number capacity) :
+		snapshot(snapshot),
+		capacity(capacity)
+	{
+		auto [data, length] = snapshot->section(SnapshotPositionMap, oram);
+		if (length != capacity * sizeof(number))
+		{
+			throw Exception(boost::format("Position map of ORAM %1% has %2% entries, expected %3%") % oram % (length / sizeof(number)) % capacity);
+		}
+		positions = (number*)data;
+	}
+
+	number SnapshotPositionMapAdapter::get(const number block) const
+	{
+		return positions[block];
+	}
+
+	void SnapshotPositionMapAdapter::set(const number block, const number leaf)
+	{
+		positions[block] = leaf;
+
+		if (tracking && !dirty[block])
+		{
+			dirty[block] = true;
+			changed.push_back(block);
+		}
+	}
+
+	const number* SnapshotPositionMapAdapter::data() const
+	{
+		return positions;
+	}
+
+	number SnapshotPositionMapAdapter::size() const
+	{
+		return capacity;
+	}
+
+	void SnapshotPositionMapAdapter::track()
+	{
+		tracking = true;
+		dirty.assign(capacity, false);
+		changed.clear();
+	}
+
+	vector<pair<number, number>> SnapshotPositionMapAdapter::changes()
+	{
+		vector<pair<number, number>> result;
+		result.reserve(changed.size());
+		for (auto&& block : changed)
+		{
+			result.push_back({block, positions[block]});
+			dirty[block] = false;
+		}
+		changed.clear();
+
+		return result;
+	}
+
+	bytes stashToSection(const shared_ptr<PathORAM::AbsStashAdapter>& stash, number blockSize)
+	{
+		vector<PathORAM::block> blocks;
+		stash->getAll(blocks);
+
+		bytes result(blocks.size() * (sizeof(number) + blockSize), 0);
+		auto position = result.data();
+		for (auto&& [id, data] : blocks)
+		{
+			memcpy(position, &id, sizeof(number));
+			memcpy(position + sizeof(number), data.data(), min((number)data.size(), blockSize));
+			position += sizeof(number) + blockSize;
+		}
+
+		return result;
+	}
+
+	void stashFromSection(const shared_ptr<PathORAM::AbsStashAdapter>& stash, const Snapshot& snapshot, number oram, number blockSize)
+	{
+		auto [data, length] = snapshot.section(SnapshotStash, oram);
+		if (length % (sizeof(number) + blockSize) != 0)
+		{
+			throw Exception(boost::format("Stash of ORAM %1% does not consist of %2%-byte blocks") % oram % blockSize);
+		}
+
+		for (auto position = data; position < data + length; position += sizeof(number) + blockSize)
+		{
+			number id;
+			memcpy(&id, position, sizeof(number));
+			stash->add(id, bytes(position + sizeof(number), position + sizeof(number) + blockSize));
+		}
+	}
+}
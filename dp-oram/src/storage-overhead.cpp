@@ -0,0 +1,321 @@
+#include "definitions.h"
+#include "path-oram/storage-adapter.hpp"
+#include "path-oram/utility.hpp"
+#include "utility.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+using namespace std;
+using namespace DPORAM;
+
+namespace po = boost::program_options;
+namespace pt = boost::property_tree;
+
+struct experiment
+{
+	ORAM_BACKEND storage;
+	number recordSize;
+	number batchSize;
+	number threads;
+	double readRatio;
+	number adapters;
+};
+
+struct outcome
+{
+	vector<number> reads;
+	vector<number> writes;
+	number elapsed; // ns
+};
+
+pt::ptree latencies(vector<number> values);
+outcome run(const experiment& config, const po::variables_map& vm);
+
+int main(int argc, char* argv[])
+{
+	po::options_description desc("Storage adapters macro benchmark; every combination of the multi-valued options is an experiment", 120);
+	desc.add_options()("help,h", "produce help message");
+	desc.add_options()("storage,s", po::value<vector<ORAM_BACKEND>>()->multitoken()->default_value({InMemory, FileSystem}, "InMemory FileSystem"), "the storage backends to benchmark");
+	desc.add_options()("recordSize", po::value<vector<number>>()->multitoken()->default_value({256, 4096}, "256 4096"), "the record (block) sizes in bytes");
+	desc.add_options()("batch", po::value<vector<number>>()->multitoken()->default_value({100, 10000}, "100 10000"), "the adapter batch sizes (BATCH_SIZE)");
+	desc.add_options()("threads", po::value<vector<number>>()->multitoken()->default_value({1, 4}, "1 4"), "the numbers of client threads");
+	desc.add_options()("readRatio", po::value<vector<double>>()->multitoken()->default_value({1.0, 0.5}, "1.0 0.5"), "the shares of read requests (the rest are writes)");
+	desc.add_options()("adapters", po::value<vector<number>>()->multitoken()->default_value({1}, "1"), "the numbers of adapters (databases for Redis) per host; threads are distributed uniformly among adapters");
+	desc.add_options()("requestSize", po::value<number>()->default_value(100), "the number of records in a single get or set request");
+	desc.add_options()("records", po::value<number>()->default_value(10000), "the number of records in each adapter");
+	desc.add_options()("operations", po::value<number>()->default_value(100), "the number of requests each thread makes");
+	desc.add_options()("redis", po::value<vector<string>>()->multitoken()->composing()->default_value({"tcp://127.0.0.1:6379"}, "tcp://127.0.0.1:6379"), "Redis host(s) to use; adapters are created on every host");
+	desc.add_options()("directory", po::value<string>()->default_value(boost::filesystem::temp_directory_path().string()), "the directory for FileSystem storage files");
+	desc.add_options()("encrypt", po::value<bool>()->default_value(true), "enable encryption for storage provider");
+	desc.add_options()("output", po::value<string>()->default_value("storage-overhead.json"), "the JSON file to write the results to");
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if (vm.count("help"))
+	{
+		cout << desc << "\n";
+		exit(1);
+	}
+
+	try
+	{
+		setlocale(LC_ALL, "en_US.utf8");
+		locale loc("en_US.UTF-8");
+		std::wcout.imbue(loc);
+	}
+	catch (...)
+	{
+		wcerr << L"Could not set locale: en_US.UTF-8" << endl;
+	}
+
+	cout << "STORAGE MACRO BENCHMARK"
+		 << endl
+		 << endl
+		 << "`";
+	for (auto i = 0; i < argc; i++)
+	{
+		cout << argv[i] << " ";
+	}
+	cout << "`"
+		 << endl
+		 << endl;
+
+	if (!vm["encrypt"].as<bool>())
+	{
+		cout << "**Encryption disabled**" << endl;
+		PathORAM::__blockCipherMode = PathORAM::BlockCipherMode::NONE;
+	}
+
+	cout << "| Storage    | Record size | Batch size | Threads | Reads | Adapters | Throughput | Read p50 | Read p99 | Write p50 | Write p99 |" << endl;
+	cout << "| :--------- | :---------: | ---------: | ------: | ----: | -------: | ---------: | -------: | -------: | --------: | --------: |" << endl;
+
+	wstring_convert<codecvt_utf8_utf16<wchar_t>> converter;
+	pt::ptree results;
+
+	for (auto&& storage : vm["storage"].as<vector<ORAM_BACKEND>>())
+	{
+		for (auto&& recordSize : vm["recordSize"].as<vector<number>>())
+		{
+			for (auto&& batchSize : vm["batch"].as<vector<number>>())
+			{
+				for (auto&& threads : vm["threads"].as<vector<number>>())
+				{
+					for (auto&& readRatio : vm["readRatio"].as<vector<double>>())
+					{
+						for (auto&& adapters : vm["adapters"].as<vector<number>>())
+						{
+							experiment config{storage, recordSize, batchSize, threads, readRatio, adapters};
+							auto result = run(config, vm);
+
+							auto requests = result.reads.size() + result.writes.size();
+							auto records  = requests * vm["requestSize"].as<number>();
+							auto seconds  = max(result.elapsed, 1uLL) / 1e9;
+
+							pt::ptree entry;
+							entry.put("storage", converter.to_bytes(ORAM_BACKEND_strings[storage]));
+							entry.put("recordSize", recordSize);
+							entry.put("batchSize", batchSize);
+							entry.put("threads", threads);
+							entry.put("readRatio", readRatio);
+							entry.put("adaptersPerHost", adapters);
+							entry.put("requestSize", vm["requestSize"].as<number>());
+							entry.put("records", vm["records"].as<number>());
+							entry.put("reads", result.reads.size());
+							entry.put("writes", result.writes.size());
+							entry.put("elapsed", result.elapsed);
+							entry.put("requestsPerSecond", requests / seconds);
+							entry.put("recordsPerSecond", records / seconds);
+							entry.put("bytesPerSecond", records * recordSize / seconds);
+							entry.add_child("read", latencies(result.reads));
+							entry.add_child("write", latencies(result.writes));
+							results.push_back({"", entry});
+
+							std::wcout
+								<< "| "
+								<< setw(10) << ORAM_BACKEND_strings[storage]
+								<< " | "
+								<< setw(11) << bytesToString(recordSize)
+								<< " | "
+								<< setw(10) << batchSize
+								<< " | "
+								<< setw(7) << threads
+								<< " | "
+								<< setw(4) << (int)(readRatio * 100) << "%"
+								<< " | "
+								<< setw(8) << adapters
+								<< " | "
+								<< setw(8) << bytesToString(records * recordSize / seconds) << "/s"
+								<< " | "
+								<< setw(8) << timeToString(percentile(result.reads, 50))
+								<< " | "
+								<< setw(8) << timeToString(percentile(result.reads, 99))
+								<< " | "
+								<< setw(9) << timeToString(percentile(result.writes, 50))
+								<< " | "
+								<< setw(9) << timeToString(percentile(result.writes, 99))
+								<< " |"
+								<< endl;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	pt::ptree root;
+	root.add_child("results", results);
+	pt::write_json(vm["output"].as<string>(), root);
+
+	cout << endl
+		 << "Results written to " << vm["output"].as<string>() << endl;
+
+	return 0;
+}
+
+pt::ptree latencies(vector<number> values)
+{
+	pt::ptree result;
+	result.put("count", values.size());
+	result.put("mean", values.size() > 0 ? accumulate(values.begin(), values.end(), 0uLL) / values.size() : 0);
+	result.put("p50", percentile(values, 50));
+	result.put("p90", percentile(values, 90));
+	result.put("p99", percentile(values, 99));
+	result.put("max", percentile(values, 100));
+	return result;
+}
+
+outcome run(const experiment& config, const po::variables_map& vm)
+{
+	auto records	 = vm["records"].as<number>();
+	auto requestSize = vm["requestSize"].as<number>();
+	auto operations	 = vm["operations"].as<number>();
+	auto key		 = PathORAM::getRandomBlock(KEYSIZE);
+
+	auto hosts	  = config.storage == Redis ? vm["redis"].as<vector<string>>() : vector<string>{""};
+	auto adapters = hosts.size() * config.adapters;
+
+	vector<string> files;
+	for (auto i = 0uLL; i < adapters; i++)
+	{
+		files.push_back((boost::filesystem::path(vm["directory"].as<string>()) / ("storage-overhead-" + to_string(i) + ".bin")).string());
+	}
+
+	auto open = [&](number i, bool initialize) -> shared_ptr<PathORAM::AbsStorageAdapter> {
+		switch (config.storage)
+		{
+			case InMemory:
+				return make_shared<PathORAM::InMemoryStorageAdapter>(records, config.recordSize, key, 1, config.batchSize);
+			case FileSystem:
+				return make_shared<PathORAM::FileSystemStorageAdapter>(records, config.recordSize, key, files[i], initialize, 1, config.batchSize);
+			case Redis:
+				return make_shared<PathORAM::RedisStorageAdapter>(records, config.recordSize, key, redishost(hosts[i / config.adapters], i % config.adapters), initialize, 1, config.batchSize);
+		}
+		throw Exception("unknown storage backend");
+	};
+
+	// initialization (filling the adapters) is not timed
+	vector<shared_ptr<PathORAM::AbsStorageAdapter>> storages;
+	for (auto i = 0uLL; i < adapters; i++)
+	{
+		storages.push_back(open(i, true));
+	}
+
+	if (config.storage == FileSystem)
+	{
+		// flush and close the files before the threads open their own handles
+		storages.clear();
+	}
+
+	// thread t uses adapter t % adapters, and the threads sharing an adapter work on disjoint ranges of its locations
+	vector<shared_ptr<PathORAM::AbsStorageAdapter>> clients;
+	for (auto t = 0uLL; t < config.threads; t++)
+	{
+		// InMemory storage is shared, the others get a connection (file handle) per thread
+		clients.push_back(config.storage == InMemory ? storages[t % adapters] : open(t % adapters, false));
+	}
+
+	auto payload = bytes(config.recordSize, 0x13);
+
+	auto client = [&](number t) -> pair<vector<number>, vector<number>> {
+		auto sharing = (config.threads - t % adapters + adapters - 1) / adapters;
+		auto share	 = t / adapters;
+		auto from	 = records * share / sharing;
+		auto to		 = max(records * (share + 1) / sharing, from + 1);
+
+		mt19937_64 generator(t);
+		uniform_int_distribution<number> location(from, to - 1);
+		uniform_real_distribution<double> kind(0, 1);
+
+		vector<number> reads, writes;
+		vector<number> getRequests(requestSize);
+		vector<PathORAM::block> getResponse;
+		vector<pair<const number, PathORAM::bucket>> setRequests;
+		for (auto i = 0uLL; i < operations; i++)
+		{
+			auto read = kind(generator) < config.readRatio;
+
+			auto start = chrono::steady_clock::now();
+			if (read)
+			{
+				generate(getRequests.begin(), getRequests.end(), [&]() { return location(generator); });
+				getResponse.clear();
+
+				start = chrono::steady_clock::now();
+				clients[t]->get(getRequests, getResponse);
+			}
+			else
+			{
+				setRequests.clear();
+				for (auto j = 0uLL; j < requestSize; j++)
+				{
+					auto id = location(generator);
+					setRequests.push_back({id, PathORAM::bucket{{id, payload}}});
+				}
+
+				start = chrono::steady_clock::now();
+				clients[t]->set(boost::make_iterator_range(setRequests.begin(), setRequests.end()));
+			}
+			auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+			(read ? reads : writes).push_back(elapsed);
+		}
+
+		return {reads, writes};
+	};
+
+	outcome result;
+
+	auto start = chrono::steady_clock::now();
+	vector<future<pair<vector<number>, vector<number>>>> threads;
+	for (auto t = 0uLL; t < config.threads; t++)
+	{
+		threads.push_back(async(launch::async, client, t));
+	}
+	for (auto&& thread : threads)
+	{
+		auto [reads, writes] = thread.get();
+		result.reads.insert(result.reads.end(), reads.begin(), reads.end());
+		result.writes.insert(result.writes.end(), writes.begin(), writes.end());
+	}
+	result.elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+	clients.clear();
+	storages.clear();
+	for (auto&& file : files)
+	{
+		boost::filesystem::remove(file);
+	}
+
+	return result;
+}
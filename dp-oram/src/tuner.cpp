@@ -0,0 +1,228 @@
+#include "tuner.hpp"
+
+#include "path-oram/utility.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	namespace
+	{
+		// encrypted blocks carry an IV and padding, as main estimates the storage size
+		const number BLOCK_OVERHEAD = 2 * 16;
+
+		const number CALIBRATION_LOG_CAPACITY = 10;
+
+		number elapsedSince(chrono::steady_clock::time_point start)
+		{
+			return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	double pathBuckets(number records, number logCapacity, bool batched)
+	{
+		if (!batched || records == 0)
+		{
+			return (double)records * logCapacity;
+		}
+
+		// level l has 2^l buckets, each on the path of a random leaf with probability 2^{-l}
+		auto buckets = 0.0;
+		for (auto level = 0uLL; level < logCapacity; level++)
+		{
+			auto width = pow(2.0, level);
+			buckets += width * -expm1(records * log1p(-1 / width));
+		}
+		return buckets;
+	}
+
+	costPrediction predictCost(const vector<number>& perOram, number logCapacity, number z, number blockSize, bool batched, const hardwareProfile& hardware)
+	{
+		costPrediction result{0, 0};
+		vector<double> workers(max(hardware.parallelism, 1uLL), 0);
+
+		for (auto i = 0uLL; i < perOram.size(); i++)
+		{
+			auto buckets  = pathBuckets(perOram[i], logCapacity, batched);
+			auto requests = batched ? ceil(buckets / hardware.batchSize) : (double)perOram[i];
+			auto bytes	  = 2 * buckets * z * (blockSize + BLOCK_OVERHEAD);
+
+			result.bytes += bytes;
+			workers[i % workers.size()] += 2 * requests * hardware.roundTrip + bytes * (1e9 / hardware.bandwidth + hardware.byteCost);
+		}
+		result.latency = *max_element(workers.begin(), workers.end());
+
+		return result;
+	}
+
+	tuningResult estimate(const vector<number>& values, const vector<pair<number, number>>& queries, number oramsNumber, number fanout, number buckets, number blockSize, const tuningSpace& space, const hardwareProfile& hardware)
+	{
+		tuningResult result{oramsNumber, fanout, buckets, 0, blockSize, 0, 0, 0, 0, 0};
+		if (values.size() == 0 || queries.size() == 0)
+		{
+			return result;
+		}
+
+		auto minValue = values.front();
+		auto maxValue = values.back();
+		auto beta	  = 1.0 / (1 << space.beta);
+
+		// the fewest levels the queries need, and whether main keeps that many for these buckets
+		vector<tuple<number, number, number>> padded; // from, to, noise nodes
+		auto levels = 1uLL;
+		for (auto&& query : queries)
+		{
+			auto [fromBucket, toBucket, from, to] = padToBuckets(query, minValue, maxValue, buckets);
+			auto nodes							  = BRC(fanout, fromBucket, toBucket);
+			for (auto&& node : nodes)
+			{
+				levels = max(levels, node.first + 1);
+			}
+			padded.push_back({from, to, nodes.size()});
+		}
+		if (levels > floorLog(fanout, buckets))
+		{
+			return result;
+		}
+		result.levels = levels;
+		result.mu	  = optimalMu(beta, fanout, buckets, space.epsilon, levels, space.gamma ? 1 : oramsNumber);
+
+		// as main sizes the ORAMs
+		auto logCapacity = (number)ceil(log2(max(values.size() / oramsNumber / space.z, 1uLL))) + 1;
+		vector<number> perOram(oramsNumber);
+
+		for (auto&& [from, to, nodes] : padded)
+		{
+			auto real  = (double)(upper_bound(values.begin(), values.end(), to) - lower_bound(values.begin(), values.end(), from));
+			auto noise = (double)nodes * result.mu;
+
+			// real records are spread evenly, Gamma pads every ORAM to the same number
+			auto records = space.gamma ? gammaNodes(oramsNumber, beta, max((number)(real + noise), 1uLL)) : (number)ceil(real / oramsNumber + noise);
+			fill(perOram.begin(), perOram.end(), records);
+
+			auto cost = predictCost(perOram, logCapacity, space.z, blockSize, space.batched, hardware);
+
+			result.real += real;
+			result.records += (double)records * oramsNumber;
+			result.bytes += cost.bytes;
+			result.latency += cost.latency;
+		}
+
+		result.real /= queries.size();
+		result.records /= queries.size();
+		result.bytes /= queries.size();
+		result.latency /= queries.size();
+
+		return result;
+	}
+
+	vector<tuningResult> tune(vector<number> values, const vector<pair<number, number>>& queries, number longestRecord, const tuningSpace& space, const hardwareProfile& hardware)
+	{
+		vector<tuningResult> results;
+		if (values.size() == 0)
+		{
+			return results;
+		}
+		sort(values.begin(), values.end());
+
+		// salaries are in cents, but the domain is in dollars
+		auto domain = (values.back() - values.front()) / 100;
+
+		for (auto&& blockSize : space.blockSizes)
+		{
+			if (blockSize <= longestRecord)
+			{
+				continue;
+			}
+			for (auto&& fanout : space.fanouts)
+			{
+				for (auto buckets = fanout; buckets <= domain; buckets *= fanout)
+				{
+					for (auto&& oramsNumber : space.oramsNumbers)
+					{
+						auto result = estimate(values, queries, oramsNumber, fanout, buckets, blockSize, space, hardware);
+						if (result.levels > 0)
+						{
+							results.push_back(result);
+						}
+					}
+				}
+			}
+		}
+
+		auto cost = [&space](const tuningResult& result) {
+			return space.objective == Latency ? make_pair(result.latency, result.bytes) : make_pair(result.bytes, result.latency);
+		};
+		stable_sort(results.begin(), results.end(), [&cost](const tuningResult& a, const tuningResult& b) { return cost(a) < cost(b); });
+
+		return results;
+	}
+
+	void calibrateClient(hardwareProfile& hardware, number blockSize, number z, number requests)
+	{
+		auto capacity = (1uLL << CALIBRATION_LOG_CAPACITY) * z;
+		auto storage  = make_shared<PathORAM::InMemoryStorageAdapter>((1 << CALIBRATION_LOG_CAPACITY) + z, blockSize, PathORAM::getRandomBlock(KEYSIZE), z);
+		auto map	  = make_shared<PathORAM::InMemoryPositionMapAdapter>(capacity + z);
+		auto stash	  = make_shared<PathORAM::InMemoryStashAdapter>(3 * CALIBRATION_LOG_CAPACITY * z);
+		auto oram	  = make_shared<PathORAM::ORAM>(CALIBRATION_LOG_CAPACITY, blockSize, z, storage, map, stash, true, hardware.batchSize);
+
+		vector<PathORAM::block> batch;
+		for (auto i = 0uLL; i < min(requests, capacity); i++)
+		{
+			batch.push_back({i * (capacity / min(requests, capacity)), bytes()});
+		}
+
+		// the first run warms up the caches and the allocator
+		vector<bytes> response;
+		oram->multiple(batch, response);
+
+		response.clear();
+		auto start = chrono::steady_clock::now();
+		oram->multiple(batch, response);
+		auto elapsed = elapsedSince(start);
+
+		hardware.byteCost = elapsed / (2 * pathBuckets(batch.size(), CALIBRATION_LOG_CAPACITY, true) * z * (blockSize + BLOCK_OVERHEAD));
+	}
+
+	void calibrateStorage(hardwareProfile& hardware, const shared_ptr<PathORAM::AbsStorageAdapter>& storage, number rounds)
+	{
+		vector<number> single{0};
+		vector<number> full(hardware.batchSize);
+		iota(full.begin(), full.end(), 0);
+
+		vector<number> trips, batches;
+		auto batchBytes = 0uLL;
+		for (auto round = 0uLL; round < rounds; round++)
+		{
+			vector<PathORAM::block> response;
+			auto start = chrono::steady_clock::now();
+			storage->get(single, response);
+			trips.push_back(elapsedSince(start));
+
+			response.clear();
+			start = chrono::steady_clock::now();
+			storage->get(full, response);
+			batches.push_back(elapsedSince(start));
+
+			batchBytes = 0;
+			for (auto&& block : response)
+			{
+				batchBytes += block.second.size() + BLOCK_OVERHEAD;
+			}
+		}
+
+		hardware.roundTrip = percentile(trips, 50);
+
+		auto transfer = (double)percentile(batches, 50) - hardware.roundTrip;
+		if (transfer > 0 && batchBytes > 0)
+		{
+			hardware.bandwidth = batchBytes / (transfer / 1e9);
+		}
+	}
+}
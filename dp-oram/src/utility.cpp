@@ -33,6 +33,24 @@ namespace DPORAM
 		return (number)ceil((1 + gamma) * kZero / (long)m);
 	}
 
+	void addFakeRequests(vector<number>& blocks, number maxBlocks, number fakesNumber)
+	{
+		// TODO possibly avoid sort
+		// TODO it is supposd to be sorted already
+		sort(blocks.begin(), blocks.end());
+
+		for (auto j = 0uLL, inserted = 0uLL, block = 0uLL; inserted < fakesNumber; j++)
+		{
+			if (block < blocks.size() && blocks[block] == j)
+			{
+				block++;
+				continue;
+			}
+			blocks.push_back(j % maxBlocks);
+			inserted++;
+		}
+	}
+
 	tuple<number, number, number, number> padToBuckets(pair<number, number> query, number min, number max, number buckets)
 	{
 		auto step = (double)(max - min) / buckets;
@@ -46,22 +64,39 @@ namespace DPORAM
 		return {fromBucket, toBucket, fromBucket * step + min, (toBucket + 1) * step + min};
 	}
 
-	number optimalMu(double beta, number k, number N, double epsilon, number levels, number orams)
+	namespace
 	{
-		auto nodes	 = 0uLL;
-		auto atLevel = (number)(log(N) / log(k));
-		for (auto level = 0uLL; level <= levels; level++)
+		number treeNodes(number k, number N, number levels)
 		{
-			nodes += atLevel;
-			atLevel /= k;
+			auto nodes	 = 0uLL;
+			auto atLevel = (number)(log(N) / log(k));
+			for (auto level = 0uLL; level <= levels; level++)
+			{
+				nodes += atLevel;
+				atLevel /= k;
+			}
+			return nodes;
 		}
-		nodes *= orams;
+	}
+
+	number optimalMu(double beta, number k, number N, double epsilon, number levels, number orams)
+	{
+		auto nodes = treeNodes(k, N, levels) * orams;
 
 		auto mu = (number)ceil(-(double)levels * log(2 - 2 * pow(1 - beta, 1.0 / nodes)) / epsilon);
 
 		return mu;
 	}
 
+	number optimalMu2D(double beta, number k, number N, number N2, double epsilon, number levels, number levels2, number orams)
+	{
+		auto nodes = treeNodes(k, N, levels) * treeNodes(k, N2, levels2) * orams;
+
+		auto mu = (number)ceil(-(double)(levels * levels2) * log(2 - 2 * pow(1 - beta, 1.0 / nodes)) / epsilon);
+
+		return mu;
+	}
+
 	double sampleLaplace(double mu, double lambda)
 	{
 		auto seed = PathORAM::getRandomULong(ULONG_MAX);
@@ -114,6 +149,32 @@ namespace DPORAM
 		} while (true);
 	}
 
+	number floorLog(number fanout, number value)
+	{
+		auto levels = 0uLL;
+		auto power	= 1uLL;
+		while (fanout > 1 && power <= value / fanout)
+		{
+			power *= fanout;
+			levels++;
+		}
+		return levels;
+	}
+
+	vector<pair<pair<number, number>, pair<number, number>>> BRC2D(number fanout, number from, number to, number from2, number to2)
+	{
+		vector<pair<pair<number, number>, pair<number, number>>> result;
+		auto nodes2 = BRC(fanout, from2, to2);
+		for (auto&& node : BRC(fanout, from, to))
+		{
+			for (auto&& node2 : nodes2)
+			{
+				result.push_back({node, node2});
+			}
+		}
+		return result;
+	}
+
 	wstring timeToString(long long time)
 	{
 		wstringstream text;
@@ -138,6 +199,18 @@ namespace DPORAM
 		return text.str();
 	}
 
+	number percentile(vector<number> values, double p)
+	{
+		if (values.size() == 0)
+		{
+			return 0;
+		}
+
+		auto rank = min(max((number)ceil(p / 100 * values.size()), 1uLL), (number)values.size()) - 1;
+		nth_element(values.begin(), values.begin() + rank, values.end());
+		return values[rank];
+	}
+
 	wstring bytesToString(long long bytes)
 	{
 		wstringstream text;
@@ -169,6 +242,41 @@ namespace DPORAM
 		return (number)salaryNumber;
 	}
 
+	number salaryFromRecord(const bytes& record, number field)
+	{
+		// a text record is zero-padded to the block size
+		auto position = 0uLL;
+		for (auto skipped = 0uLL; skipped < field; position++)
+		{
+			if (position == record.size() || record[position] == '\0')
+			{
+				throw Exception(boost::format("Record does not have field %1%") % field);
+			}
+			if (record[position] == ',')
+			{
+				skipped++;
+			}
+		}
+
+		// enough for any double in decimal notation
+		char buffer[64];
+		auto length = 0uLL;
+		while (position < record.size() && length < sizeof(buffer) - 1 && record[position] != ',' && record[position] != '\0')
+		{
+			buffer[length++] = record[position++];
+		}
+		buffer[length] = '\0';
+
+		char* end;
+		auto salaryDouble = strtod(buffer, &end) * 100;
+		if (end == buffer)
+		{
+			throw Exception(boost::format("Cannot parse salary from record field %1%") % field);
+		}
+		auto salaryNumber = (long long)salaryDouble + OFFSET;
+		return (number)salaryNumber;
+	}
+
 	double numberToSalary(number salary)
 	{
 		return ((long long)salary - OFFSET) * 0.01;
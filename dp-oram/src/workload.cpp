@@ -0,0 +1,154 @@
+#include "workload.hpp"
+
+#include "utility.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace DPORAM
+{
+	using namespace std;
+
+	namespace
+	{
+		// runs task(from, to) on (at most) threads contiguous ranges covering [0, count)
+		void parallelRanges(number count, number threads, function<void(number, number)> task)
+		{
+			threads = min(threads > 0 ? threads : max(thread::hardware_concurrency(), 1u), max(count, 1uLL));
+
+			vector<future<void>> running;
+			for (auto t = 0uLL; t < threads; t++)
+			{
+				running.push_back(async(launch::async, task, count * t / threads, count * (t + 1) / threads));
+			}
+			for (auto&& future : running)
+			{
+				future.get();
+			}
+		}
+	}
+
+	void parallelSort(vector<number>& keys, number threads)
+	{
+		threads = min(threads > 0 ? threads : max(thread::hardware_concurrency(), 1u), max((number)keys.size(), 1uLL));
+
+		vector<number> bounds;
+		for (auto t = 0uLL; t <= threads; t++)
+		{
+			bounds.push_back(keys.size() * t / threads);
+		}
+
+		parallelRanges(threads, threads, [&keys, &bounds](number from, number to) {
+			for (auto run = from; run < to; run++)
+			{
+				sort(keys.begin() + bounds[run], keys.begin() + bounds[run + 1]);
+			}
+		});
+
+		// runs i and i + width become run i
+		for (auto width = 1uLL; width < threads; width *= 2)
+		{
+			vector<future<void>> merging;
+			for (auto run = 0uLL; run + width < threads; run += 2 * width)
+			{
+				auto first	= keys.begin() + bounds[run];
+				auto middle = keys.begin() + bounds[run + width];
+				auto last	= keys.begin() + bounds[min(run + 2 * width, threads)];
+				merging.push_back(async(launch::async, [first, middle, last]() { inplace_merge(first, middle, last); }));
+			}
+			for (auto&& future : merging)
+			{
+				future.get();
+			}
+		}
+	}
+
+	vector<number> rangeCounts(const vector<number>& keys, const vector<pair<number, number>>& queries, number threads)
+	{
+		vector<number> counts(queries.size(), 0);
+
+		parallelRanges(queries.size(), threads, [&keys, &queries, &counts](number from, number to) {
+			for (auto i = from; i < to; i++)
+			{
+				auto [left, right] = queries[i];
+				if (left <= right)
+				{
+					counts[i] = upper_bound(keys.begin(), keys.end(), right) - lower_bound(keys.begin(), keys.end(), left);
+				}
+			}
+		});
+
+		return counts;
+	}
+
+	workloadHistograms histograms(const vector<number>& keys, const vector<pair<number, number>>& queries, number buckets, number threads)
+	{
+		workloadHistograms result;
+		result.records.resize(buckets, 0);
+		result.queries.resize(buckets, 0);
+		result.spans.resize(buckets + 1, 0);
+		if (keys.size() == 0 || buckets == 0)
+		{
+			result.spans[0] = queries.size();
+			return result;
+		}
+
+		auto minValue = keys.front();
+		auto maxValue = keys.back();
+		auto bucket	  = [minValue, maxValue, buckets](number value) -> number {
+			// a single distinct key has no width to split
+			return minValue == maxValue ? 0 : get<0>(padToBuckets({value, value}, minValue, maxValue, buckets));
+		};
+
+		// buckets are monotone in the key, so each one is a range of the sorted keys
+		auto begin = keys.begin();
+		for (auto b = 0uLL; b < buckets; b++)
+		{
+			auto end		  = partition_point(begin, keys.end(), [&bucket, b](number key) { return bucket(key) <= b; });
+			result.records[b] = end - begin;
+			begin			  = end;
+		}
+
+		// each thread adds its queries to its own difference array
+		mutex merge;
+		vector<long long> coverage(buckets + 1, 0);
+		parallelRanges(queries.size(), threads, [&](number from, number to) {
+			vector<long long> local(buckets + 1, 0);
+			vector<number> spans(buckets + 1, 0);
+			for (auto i = from; i < to; i++)
+			{
+				auto [left, right] = queries[i];
+				if (left > right || right < minValue || left > maxValue)
+				{
+					spans[0]++;
+					continue;
+				}
+
+				auto fromBucket = bucket(max(left, minValue));
+				auto toBucket	= bucket(min(right, maxValue));
+				local[fromBucket]++;
+				local[toBucket + 1]--;
+				spans[toBucket - fromBucket + 1]++;
+			}
+
+			lock_guard<mutex> guard(merge);
+			for (auto b = 0uLL; b <= buckets; b++)
+			{
+				coverage[b] += local[b];
+				result.spans[b] += spans[b];
+			}
+		});
+
+		long long overlapping = 0;
+		for (auto b = 0uLL; b < buckets; b++)
+		{
+			overlapping += coverage[b];
+			result.queries[b] = overlapping;
+		}
+
+		return result;
+	}
+}
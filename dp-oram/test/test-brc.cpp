@@ -31,6 +31,17 @@ namespace DPORAM
 		EXPECT_EQ(expected, actual);
 	}
 
+	TEST(UtilityFloorLogTest, ExactPowers)
+	{
+		EXPECT_EQ(3, floorLog(10, 1000));
+		EXPECT_EQ(5, floorLog(3, 243));
+		EXPECT_EQ(7, floorLog(8, 2097152));
+		EXPECT_EQ(2, floorLog(10, 999));
+		EXPECT_EQ(0, floorLog(2, 1));
+		EXPECT_EQ(0, floorLog(2, 0));
+		EXPECT_EQ(63, floorLog(2, ULLONG_MAX));
+	}
+
 	vector<tuple<number, number, number, number, vector<pair<number, number>>>> cases()
 	{
 		vector<tuple<number, number, number, number, vector<pair<number, number>>>> result =
@@ -71,6 +82,38 @@ namespace DPORAM
 		return result;
 	}
 
+	TEST(UtilityBRC2DTest, CoversRectangleOnce)
+	{
+		const auto fanout = 3uLL, buckets = 27uLL;
+
+		for (auto [from, to, from2, to2] : vector<tuple<number, number, number, number>>{{2, 7, 0, 8}, {0, 26, 3, 3}, {5, 20, 1, 25}, {4, 4, 4, 4}})
+		{
+			vector<vector<number>> covered(buckets, vector<number>(buckets, 0));
+			auto nodes = BRC2D(fanout, from, to, from2, to2);
+			for (auto&& [node, node2] : nodes)
+			{
+				auto width	= (number)pow(fanout, node.first);
+				auto width2 = (number)pow(fanout, node2.first);
+				for (auto i = node.second * width; i < (node.second + 1) * width; i++)
+				{
+					for (auto j = node2.second * width2; j < (node2.second + 1) * width2; j++)
+					{
+						covered[i][j]++;
+					}
+				}
+			}
+
+			EXPECT_EQ(BRC(fanout, from, to).size() * BRC(fanout, from2, to2).size(), nodes.size());
+			for (auto i = 0uLL; i < buckets; i++)
+			{
+				for (auto j = 0uLL; j < buckets; j++)
+				{
+					EXPECT_EQ(i >= from && i <= to && j >= from2 && j <= to2 ? 1 : 0, covered[i][j]);
+				}
+			}
+		}
+	}
+
 	INSTANTIATE_TEST_SUITE_P(UtilityBRCSuite, UtilityBRCTest, testing::ValuesIn(cases()));
 }
 
@@ -0,0 +1,157 @@
+#include "checkpoint.hpp"
+#include "definitions.h"
+
+#include "gtest/gtest.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+using namespace std;
+
+namespace DPORAM
+{
+	class CheckpointTest : public testing::Test
+	{
+		public:
+		inline static const number BLOCK_SIZE = 64;
+		inline static const number CAPACITY	  = 1000;
+
+		protected:
+		string file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("journal-%%%%-%%%%.bin")).string();
+
+		shared_ptr<SnapshotPositionMapAdapter> map	= make_shared<SnapshotPositionMapAdapter>(CAPACITY);
+		shared_ptr<PathORAM::AbsStashAdapter> stash = make_shared<PathORAM::InMemoryStashAdapter>(100);
+
+		~CheckpointTest() override
+		{
+			boost::filesystem::remove(file);
+		}
+
+		vector<PathORAM::block> blocks(const shared_ptr<PathORAM::AbsStashAdapter>& stash)
+		{
+			vector<PathORAM::block> result;
+			stash->getAll(result);
+			sort(result.begin(), result.end());
+			return result;
+		}
+	};
+
+	TEST_F(CheckpointTest, OnlyChanges)
+	{
+		stash->add(1, bytes(BLOCK_SIZE, 0x01));
+		stash->add(2, bytes(BLOCK_SIZE, 0x02));
+
+		StateTracker tracker(map, stash);
+		auto empty = tracker.changes();
+		EXPECT_EQ(0, empty.positions.size() + empty.removed.size() + empty.stashed.size());
+
+		map->set(5, 50);
+		map->set(7, 70);
+		map->set(5, 55);
+		stash->remove(1);
+		stash->update(2, bytes(BLOCK_SIZE, 0x22));
+		stash->add(3, bytes(BLOCK_SIZE, 0x03));
+
+		auto delta = tracker.changes();
+		sort(delta.positions.begin(), delta.positions.end());
+		sort(delta.stashed.begin(), delta.stashed.end());
+		EXPECT_EQ((vector<pair<number, number>>{{5, 55}, {7, 70}}), delta.positions);
+		EXPECT_EQ(vector<number>{1}, delta.removed);
+		EXPECT_EQ((vector<pair<number, bytes>>{{2, bytes(BLOCK_SIZE, 0x22)}, {3, bytes(BLOCK_SIZE, 0x03)}}), delta.stashed);
+
+		// the next delta starts where the previous one ended
+		map->set(7, 71);
+		delta = tracker.changes();
+		EXPECT_EQ((vector<pair<number, number>>{{7, 71}}), delta.positions);
+		EXPECT_EQ(0, delta.removed.size() + delta.stashed.size());
+	}
+
+	TEST_F(CheckpointTest, ReplayMatchesState)
+	{
+		for (auto i = 0uLL; i < CAPACITY; i++)
+		{
+			map->set(i, i);
+		}
+		stash->add(1, bytes(BLOCK_SIZE, 0x01));
+
+		// the state at the base snapshot
+		auto baseMap   = make_shared<SnapshotPositionMapAdapter>(CAPACITY);
+		auto baseStash = make_shared<PathORAM::InMemoryStashAdapter>(100);
+		memcpy((void*)baseMap->data(), map->data(), CAPACITY * sizeof(number));
+		baseStash->add(1, bytes(BLOCK_SIZE, 0x01));
+
+		StateTracker tracker(map, stash);
+		{
+			CheckpointJournal journal(file, 3, BLOCK_SIZE);
+			for (auto round = 0uLL; round < 5; round++)
+			{
+				for (auto i = 0uLL; i < 50; i++)
+				{
+					map->set((round * 37 + i * 11) % CAPACITY, round * 1000 + i);
+				}
+				stash->add(10 + round, bytes(BLOCK_SIZE, (uchar)round));
+				if (round > 0)
+				{
+					stash->remove(10 + round - 1);
+				}
+				journal.submit({{0, tracker.changes()}});
+			}
+			journal.flush();
+			EXPECT_EQ(5, journal.written());
+		}
+
+		auto deltas = readJournal(file, 3, BLOCK_SIZE);
+		ASSERT_EQ(1, deltas.size());
+		EXPECT_EQ(5, deltas[0].size());
+		for (auto&& delta : deltas[0])
+		{
+			applyDelta(delta, baseMap, baseStash);
+		}
+
+		for (auto i = 0uLL; i < CAPACITY; i++)
+		{
+			ASSERT_EQ(map->get(i), baseMap->get(i));
+		}
+		EXPECT_EQ(blocks(stash), blocks(baseStash));
+	}
+
+	TEST_F(CheckpointTest, TornRecord)
+	{
+		{
+			CheckpointJournal journal(file, 1, BLOCK_SIZE);
+			map->set(1, 10);
+			journal.submit({{0, {{{1, 10}}, {}, {}}}});
+			journal.submit({{0, {{{2, 20}}, {}, {{5, bytes(BLOCK_SIZE, 0x05)}}}}});
+		}
+
+		// the process crashed in the middle of the second record
+		boost::filesystem::resize_file(file, boost::filesystem::file_size(file) - 10);
+
+		auto deltas = readJournal(file, 1, BLOCK_SIZE);
+		ASSERT_EQ(1, deltas[0].size());
+		EXPECT_EQ((vector<pair<number, number>>{{1, 10}}), deltas[0][0].positions);
+	}
+
+	TEST_F(CheckpointTest, OtherGeneration)
+	{
+		{
+			CheckpointJournal journal(file, 1, BLOCK_SIZE);
+			journal.submit({{0, {{{1, 10}}, {}, {}}}});
+		}
+
+		EXPECT_EQ(1, readJournal(file, 1, BLOCK_SIZE).size());
+		EXPECT_EQ(0, readJournal(file, 2, BLOCK_SIZE).size());
+		EXPECT_EQ(0, readJournal(file + "-missing", 1, BLOCK_SIZE).size());
+
+		// a new journal starts from scratch
+		{
+			CheckpointJournal journal(file, 2, BLOCK_SIZE);
+		}
+		EXPECT_EQ(0, readJournal(file, 1, BLOCK_SIZE).size());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,165 @@
+#include "definitions.h"
+#include "generator.hpp"
+#include "path-oram/utility.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+#include <map>
+
+using namespace std;
+
+namespace DPORAM
+{
+	class GeneratorTest : public testing::TestWithParam<VALUE_DISTRIBUTION>
+	{
+		public:
+		inline static const number COUNT = 20000;
+
+		protected:
+		datasetConfig config(VALUE_DISTRIBUTION distribution)
+		{
+			datasetConfig result;
+			result.distribution = distribution;
+			result.count		= COUNT;
+			result.attributes	= 2;
+			result.recordLength = 100;
+			result.distinct		= 50;
+			result.seed			= 42;
+			return result;
+		}
+	};
+
+	TEST_P(GeneratorTest, Reproducible)
+	{
+		DatasetGenerator first(config(GetParam())), second(config(GetParam()));
+
+		auto other = config(GetParam());
+		other.seed++;
+		DatasetGenerator third(other);
+
+		auto differ = 0uLL;
+		for (auto i = 0uLL; i < 100; i++)
+		{
+			ASSERT_EQ(first.record(i), second.record(i));
+			differ += first.record(i) != third.record(i);
+		}
+		EXPECT_GT(differ, 0);
+	}
+
+	TEST_P(GeneratorTest, RecordsParseToValues)
+	{
+		DatasetGenerator generator(config(GetParam()));
+
+		for (auto i = 0uLL; i < 1000; i++)
+		{
+			auto record = generator.record(i);
+			EXPECT_EQ(100, record.size());
+
+			auto block = PathORAM::fromText(record, 128);
+			ASSERT_EQ(generator.value(i, 0), salaryFromRecord(block, 0));
+			ASSERT_EQ(generator.value(i, 1), salaryFromRecord(block, 1));
+			ASSERT_GE(generator.value(i), salaryToNumber("0"));
+			ASSERT_LE(generator.value(i), salaryToNumber("100000"));
+		}
+	}
+
+	TEST_P(GeneratorTest, Selectivity)
+	{
+		DatasetGenerator generator(config(GetParam()));
+
+		for (auto attribute = 0uLL; attribute < 2; attribute++)
+		{
+			vector<number> values(COUNT);
+			for (auto i = 0uLL; i < COUNT; i++)
+			{
+				values[i] = generator.value(i, attribute);
+			}
+
+			auto queries = generator.queries(50, 0.05, 0, 0.1, attribute);
+			ASSERT_EQ(50, queries.size());
+			for (auto&& [from, to] : queries)
+			{
+				ASSERT_LE(from, to);
+				if (GetParam() == Uniform || GetParam() == Normal)
+				{
+					// with duplicates selectivity can only be met up to the frequency of a value
+					auto matching = count_if(values.begin(), values.end(), [from = from, to = to](number value) { return value >= from && value <= to; });
+					EXPECT_NEAR(0.05, (double)matching / COUNT, 0.01);
+				}
+			}
+		}
+	}
+
+	TEST_P(GeneratorTest, Hotspot)
+	{
+		DatasetGenerator generator(config(GetParam()));
+
+		auto spread	 = generator.queries(200, 0.01);
+		auto hotspot = generator.queries(200, 0.01, 1, 0.05);
+
+		auto width = [](const vector<pair<number, number>>& queries) {
+			auto [low, high] = minmax_element(queries.begin(), queries.end());
+			return high->first - low->first;
+		};
+		EXPECT_LE(width(hotspot), width(spread));
+	}
+
+	TEST_F(GeneratorTest, Shapes)
+	{
+		auto frequencies = [this](VALUE_DISTRIBUTION distribution) {
+			DatasetGenerator generator(config(distribution));
+			map<number, number> result;
+			for (auto i = 0uLL; i < COUNT; i++)
+			{
+				result[generator.value(i)]++;
+			}
+			return result;
+		};
+
+		auto top = [](const map<number, number>& frequencies) {
+			return max_element(frequencies.begin(), frequencies.end(), [](auto a, auto b) { return a.second < b.second; })->second;
+		};
+
+		auto duplicates = frequencies(Duplicates);
+		auto zipf		= frequencies(Zipf);
+		EXPECT_LE(duplicates.size(), 50);
+		EXPECT_LE(zipf.size(), 50);
+		// the most frequent Zipf value is much more frequent than the Duplicates one
+		EXPECT_GT(top(zipf), 2 * top(duplicates));
+
+		DatasetGenerator normal(config(Normal));
+		auto sum = 0.0;
+		for (auto i = 0uLL; i < COUNT; i++)
+		{
+			sum += numberToSalary(normal.value(i));
+		}
+		EXPECT_NEAR(50000, sum / COUNT, 500);
+
+		EXPECT_GT(frequencies(Uniform).size(), COUNT * 0.9);
+	}
+
+	TEST_F(GeneratorTest, Invalid)
+	{
+		auto zipf = config(Zipf);
+		zipf.skew = 1.5;
+		EXPECT_ANY_THROW(DatasetGenerator generator(zipf));
+
+		auto empty	   = config(Duplicates);
+		empty.distinct = 0;
+		EXPECT_ANY_THROW(DatasetGenerator generator(empty));
+	}
+
+	string printTestName(testing::TestParamInfo<VALUE_DISTRIBUTION> input)
+	{
+		auto name = VALUE_DISTRIBUTION_strings[input.param];
+		return string(name.begin(), name.end());
+	}
+
+	INSTANTIATE_TEST_SUITE_P(GeneratorSuite, GeneratorTest, testing::Values(Uniform, Normal, Zipf, Duplicates), printTestName);
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,424 @@
+#include "b-plus-tree/utility.hpp"
+#include "definitions.h"
+#include "ingest.hpp"
+#include "path-oram/utility.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+using namespace std;
+
+namespace DPORAM
+{
+	class IngestTest : public testing::TestWithParam<tuple<number, number, bool, bool>>
+	{
+		public:
+		inline static const number BLOCK_SIZE = 256;
+
+		protected:
+		string file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("ingest-%%%%-%%%%.csv")).string();
+
+		~IngestTest() override
+		{
+			boost::filesystem::remove(file);
+		}
+
+		void writeDataset(number lines, bool trailingNewline)
+		{
+			ofstream output(file);
+			for (auto i = 0uLL; i < lines; i++)
+			{
+				// negative, fractional and repeated values
+				output << (i % 97) * 13.37 - 200 << "," << (i * 7919) % 1000 << ",row-" << i;
+				if (i < lines - 1 || trailingNewline)
+				{
+					output << "\n";
+				}
+			}
+		}
+
+		// the original single-threaded getline loader
+		ingestedDataset reference(number orams, bool twoAttributes)
+		{
+			ingestedDataset result;
+			result.oramsIndex.resize(orams);
+			result.treeIndices.resize(twoAttributes ? 2 : 1);
+			result.minValues.resize(twoAttributes ? 2 : 1, ULONG_MAX);
+			result.maxValues.resize(twoAttributes ? 2 : 1, 0);
+
+			ifstream input(file);
+			string line;
+			while (getline(input, line))
+			{
+				number salary, salary2 = 0;
+				if (!twoAttributes)
+				{
+					salary = salaryToNumber(line);
+				}
+				else
+				{
+					vector<string> salaries;
+					boost::algorithm::split(salaries, line, boost::is_any_of(","));
+					salary	= salaryToNumber(salaries[0]);
+					salary2 = salaryToNumber(salaries[1]);
+				}
+
+				result.maxValues[0] = max(salary, result.maxValues[0]);
+				result.minValues[0] = min(salary, result.minValues[0]);
+
+				auto oramId	 = PathORAM::hashToNumber(BPlusTree::bytesFromNumber(salary), orams);
+				auto blockId = result.oramsIndex[oramId].size();
+
+				result.oramsIndex[oramId].push_back({blockId, PathORAM::fromText(line, BLOCK_SIZE)});
+				result.treeIndices[0].push_back({salary, BPlusTree::concatNumbers(2, oramId, blockId)});
+				if (twoAttributes)
+				{
+					result.maxValues[1] = max(salary2, result.maxValues[1]);
+					result.minValues[1] = min(salary2, result.minValues[1]);
+					result.treeIndices[1].push_back({salary2, BPlusTree::concatNumbers(2, oramId, blockId)});
+				}
+			}
+
+			return result;
+		}
+	};
+
+	TEST_P(IngestTest, SameAsSequential)
+	{
+		auto [orams, threads, twoAttributes, trailingNewline] = GetParam();
+
+		writeDataset(1000, trailingNewline);
+
+		auto expected = reference(orams, twoAttributes);
+		auto actual	  = ingestDataset(file, orams, BLOCK_SIZE, defaultSchema(twoAttributes ? 2 : 1), threads);
+
+		EXPECT_EQ(expected.oramsIndex, actual.oramsIndex);
+		EXPECT_EQ(expected.treeIndices, actual.treeIndices);
+		EXPECT_EQ(expected.minValues, actual.minValues);
+		EXPECT_EQ(expected.maxValues, actual.maxValues);
+	}
+
+	TEST_P(IngestTest, Spilled)
+	{
+		auto [orams, threads, twoAttributes, trailingNewline] = GetParam();
+
+		// large enough for several waves of minimal chunks
+		writeDataset(30000, trailingNewline);
+
+		auto runFile = [this](number i) { return file + "-run-" + to_string(i); };
+
+		auto schema	  = defaultSchema(twoAttributes ? 2 : 1);
+		auto expected = ingestDataset(file, orams, BLOCK_SIZE, schema, threads);
+
+		ingestedDataset actual;
+		{
+			PartitionRuns runs(orams, runFile, 4096);
+			actual = ingestDataset(file, orams, schema, threads, 1, runs);
+
+			for (auto i = 0uLL; i < orams; i++)
+			{
+				EXPECT_EQ(expected.oramsIndex[i].size(), runs.size(i));
+
+				vector<pair<number, bytes>> read;
+				runs.read(i, BLOCK_SIZE, 100, [&read](vector<pair<number, bytes>>& chunk) {
+					EXPECT_LE(chunk.size(), 100);
+					read.insert(read.end(), chunk.begin(), chunk.end());
+				});
+				EXPECT_EQ(expected.oramsIndex[i], read);
+			}
+		}
+
+		EXPECT_EQ(expected.treeIndices, actual.treeIndices);
+		EXPECT_EQ(expected.minValues, actual.minValues);
+		EXPECT_EQ(expected.maxValues, actual.maxValues);
+		EXPECT_EQ(0, actual.oramsIndex.size());
+
+		for (auto i = 0uLL; i < orams; i++)
+		{
+			EXPECT_FALSE(boost::filesystem::exists(runFile(i)));
+		}
+	}
+
+	TEST_P(IngestTest, Keys)
+	{
+		auto [orams, threads, twoAttributes, trailingNewline] = GetParam();
+
+		writeDataset(1000, trailingNewline);
+
+		auto expected = reference(orams, twoAttributes);
+		auto actual	  = ingestKeys(file, threads);
+
+		ASSERT_EQ(expected.treeIndices[0].size(), actual.size());
+		for (auto i = 0uLL; i < actual.size(); i++)
+		{
+			EXPECT_EQ(expected.treeIndices[0][i].first, actual[i]);
+		}
+	}
+
+	TEST_P(IngestTest, Schema)
+	{
+		auto [orams, threads, twoAttributes, trailingNewline] = GetParam();
+
+		writeDataset(1000, trailingNewline);
+
+		// the second column is indexed as an integer, the third is carried along; the first indexed column partitions the records
+		auto schema	  = parseSchema(string("salary:Decimal") + (twoAttributes ? ":indexed" : "") + ",count:Integer:indexed,row:Text");
+		auto expected = reference(orams, true);
+		auto actual	  = ingestDataset(file, orams, BLOCK_SIZE, schema, threads);
+
+		ASSERT_EQ(schema.indexed.size(), actual.treeIndices.size());
+		auto& counts = actual.treeIndices.back();
+		ASSERT_EQ(expected.treeIndices[1].size(), counts.size());
+
+		vector<number> oramSizes(orams, 0);
+		for (auto i = 0uLL; i < counts.size(); i++)
+		{
+			// integers are encoded in units, not in cents
+			auto count = ((long long)expected.treeIndices[1][i].first - OFFSET) / 100 + OFFSET;
+			EXPECT_EQ(count, counts[i].first);
+
+			auto oramId = PathORAM::hashToNumber(BPlusTree::bytesFromNumber(twoAttributes ? expected.treeIndices[0][i].first : count), orams);
+			EXPECT_EQ(BPlusTree::concatNumbers(2, oramId, oramSizes[oramId]++), counts[i].second);
+			if (twoAttributes)
+			{
+				EXPECT_EQ(expected.treeIndices[0][i].first, actual.treeIndices[0][i].first);
+				EXPECT_EQ(counts[i].second, actual.treeIndices[0][i].second);
+			}
+		}
+		EXPECT_EQ(OFFSET, actual.minValues.back());
+		EXPECT_EQ(OFFSET + 999, actual.maxValues.back());
+
+		ASSERT_ANY_THROW(ingestDataset(file, orams, BLOCK_SIZE, parseSchema("a,b,c,missing:Integer:indexed"), threads));
+	}
+
+	TEST_P(IngestTest, PartitionRecords)
+	{
+		auto [orams, threads, twoAttributes, trailingNewline] = GetParam();
+
+		writeDataset(1000, trailingNewline);
+
+		auto original = ingestDataset(file, orams, BLOCK_SIZE, defaultSchema(twoAttributes ? 2 : 1), threads);
+		for (auto&& strategy : {PValue, PRecord, PRoundRobin, PBalanced})
+		{
+			auto partitioned = original;
+			partitionRecords(partitioned.oramsIndex, partitioned.treeIndices, strategy);
+
+			auto records = 0uLL, largest = 0uLL;
+			for (auto i = 0uLL; i < orams; i++)
+			{
+				for (auto blockId = 0uLL; blockId < partitioned.oramsIndex[i].size(); blockId++)
+				{
+					EXPECT_EQ(blockId, partitioned.oramsIndex[i][blockId].first);
+				}
+				records += partitioned.oramsIndex[i].size();
+				largest = max(largest, (number)partitioned.oramsIndex[i].size());
+			}
+			EXPECT_EQ(1000, records);
+
+			// equal values share an ORAM, others keep the ORAMs within one record of the share
+			if (strategy == PValue)
+			{
+				EXPECT_EQ(original.oramsIndex, partitioned.oramsIndex);
+			}
+			if (strategy == PRoundRobin || strategy == PBalanced)
+			{
+				EXPECT_LE(largest, (1000 + orams - 1) / orams);
+			}
+
+			// every locator points to the same record as before
+			for (auto a = 0uLL; a < partitioned.treeIndices.size(); a++)
+			{
+				ASSERT_EQ(original.treeIndices[a].size(), partitioned.treeIndices[a].size());
+				for (auto i = 0uLL; i < partitioned.treeIndices[a].size(); i++)
+				{
+					EXPECT_EQ(original.treeIndices[a][i].first, partitioned.treeIndices[a][i].first);
+
+					auto from = BPlusTree::deconstructNumbers(original.treeIndices[a][i].second);
+					auto to	  = BPlusTree::deconstructNumbers(partitioned.treeIndices[a][i].second);
+					ASSERT_EQ(2, to.size());
+					EXPECT_EQ(original.oramsIndex[from[0]][from[1]].second, partitioned.oramsIndex[to[0]][to[1]].second);
+					if (strategy == PRoundRobin && a == 0)
+					{
+						EXPECT_EQ(i % orams, to[0]);
+					}
+				}
+			}
+		}
+	}
+
+	TEST_P(IngestTest, PackRecords)
+	{
+		auto [orams, threads, twoAttributes, trailingNewline] = GetParam();
+
+		writeDataset(1000, trailingNewline);
+
+		auto original = ingestDataset(file, orams, BLOCK_SIZE, defaultSchema(twoAttributes ? 2 : 1), threads);
+		auto packed	  = original;
+		EXPECT_EQ(1000, packRecords(packed.oramsIndex, packed.treeIndices, BLOCK_SIZE));
+
+		auto blocks = 0uLL;
+		for (auto i = 0uLL; i < orams; i++)
+		{
+			EXPECT_LT(packed.oramsIndex[i].size(), original.oramsIndex[i].size());
+			blocks += packed.oramsIndex[i].size();
+
+			// the records of a block are in the order of the first attribute
+			for (auto&& [blockId, block] : packed.oramsIndex[i])
+			{
+				EXPECT_EQ(BLOCK_SIZE, block.size());
+
+				bytes record;
+				auto previous = 0uLL;
+				for (auto position = 0uLL; nextRecord(block, position, record);)
+				{
+					EXPECT_LE(previous, salaryFromRecord(record));
+					previous = salaryFromRecord(record);
+				}
+			}
+		}
+		EXPECT_LT(blocks * 4, 1000);
+
+		// every locator points to the same record as before
+		for (auto a = 0uLL; a < packed.treeIndices.size(); a++)
+		{
+			ASSERT_EQ(original.treeIndices[a].size(), packed.treeIndices[a].size());
+			for (auto i = 0uLL; i < packed.treeIndices[a].size(); i++)
+			{
+				EXPECT_EQ(original.treeIndices[a][i].first, packed.treeIndices[a][i].first);
+
+				auto from = BPlusTree::deconstructNumbers(original.treeIndices[a][i].second);
+				auto to	  = BPlusTree::deconstructNumbers(packed.treeIndices[a][i].second);
+				ASSERT_EQ(3, to.size());
+				EXPECT_EQ(from[0], to[0]);
+
+				bytes record;
+				auto position = 0uLL;
+				for (auto slot = 0uLL; slot <= to[2]; slot++)
+				{
+					ASSERT_TRUE(nextRecord(packed.oramsIndex[to[0]][to[1]].second, position, record));
+				}
+				EXPECT_EQ(PathORAM::toText(original.oramsIndex[from[0]][from[1]].second, BLOCK_SIZE), string(record.begin(), record.end()));
+			}
+		}
+
+		// a record must fit a block with its terminator
+		auto large = original;
+		large.oramsIndex[0][0].second.assign(BLOCK_SIZE, 'x');
+		ASSERT_ANY_THROW(packRecords(large.oramsIndex, large.treeIndices, BLOCK_SIZE));
+	}
+
+	TEST_P(IngestTest, AssignSizeClasses)
+	{
+		auto [orams, threads, twoAttributes, trailingNewline] = GetParam();
+
+		writeDataset(1000, trailingNewline);
+
+		// two groups of orams ORAMs, the shorter rows and the rest
+		const vector<number> sizeClasses = {16, BLOCK_SIZE};
+
+		auto original = ingestDataset(file, 2 * orams, BLOCK_SIZE, defaultSchema(twoAttributes ? 2 : 1), threads);
+		auto assigned = original;
+		auto records  = assignSizeClasses(assigned.oramsIndex, assigned.treeIndices, sizeClasses, BLOCK_SIZE);
+
+		ASSERT_EQ(2, records.size());
+		EXPECT_EQ(1000, records[0] + records[1]);
+		EXPECT_GT(records[0], 0);
+		EXPECT_GT(records[1], 0);
+
+		for (auto i = 0uLL; i < 2 * orams; i++)
+		{
+			auto size = sizeClasses[i / orams];
+			for (auto&& [blockId, block] : assigned.oramsIndex[i])
+			{
+				EXPECT_EQ(size, block.size());
+				EXPECT_LT(PathORAM::toText(block, size).size(), size);
+			}
+		}
+
+		// every locator points to the same record as before
+		for (auto a = 0uLL; a < assigned.treeIndices.size(); a++)
+		{
+			ASSERT_EQ(original.treeIndices[a].size(), assigned.treeIndices[a].size());
+			for (auto i = 0uLL; i < assigned.treeIndices[a].size(); i++)
+			{
+				auto from = BPlusTree::deconstructNumbers(original.treeIndices[a][i].second);
+				auto to	  = BPlusTree::deconstructNumbers(assigned.treeIndices[a][i].second);
+				ASSERT_EQ(2, to.size());
+
+				auto& block = assigned.oramsIndex[to[0]][to[1]];
+				EXPECT_EQ(to[1], block.first);
+				EXPECT_EQ(PathORAM::toText(original.oramsIndex[from[0]][from[1]].second, BLOCK_SIZE), PathORAM::toText(block.second, sizeClasses[to[0] / orams]));
+			}
+		}
+
+		// a record must fit the largest class with its terminator
+		ASSERT_ANY_THROW(assignSizeClasses(original.oramsIndex, original.treeIndices, {8, 16}, BLOCK_SIZE));
+	}
+
+	TEST_P(IngestTest, LineChunks)
+	{
+		auto threads = get<1>(GetParam());
+
+		string data = "1\n22\n333\n\n4444\n55555";
+		for (auto chunks : {1uLL, threads, 100uLL})
+		{
+			auto ranges = lineChunks(data.c_str(), data.size(), chunks);
+
+			ASSERT_GT(ranges.size(), 0);
+			EXPECT_LE(ranges.size(), chunks);
+			EXPECT_EQ(0, ranges.front().first);
+			EXPECT_EQ(data.size(), ranges.back().second);
+			for (auto i = 0uLL; i < ranges.size(); i++)
+			{
+				EXPECT_LT(ranges[i].first, ranges[i].second);
+				if (i > 0)
+				{
+					EXPECT_EQ(ranges[i - 1].second, ranges[i].first);
+				}
+				if (i < ranges.size() - 1)
+				{
+					EXPECT_EQ('\n', data[ranges[i].second - 1]);
+				}
+			}
+		}
+	}
+
+	TEST_F(IngestTest, SizeClassLogCapacities)
+	{
+		// one ORAM of the first class holds far more than the average of its class
+		vector<number> blockNumbers = {10, 10, 10, 1000, 40, 40, 40, 40};
+		auto capacities				= sizeClassLogCapacities(blockNumbers, 4, 3);
+		ASSERT_EQ(2, capacities.size());
+
+		for (auto i = 0uLL; i < blockNumbers.size(); i++)
+		{
+			EXPECT_GE((1uLL << capacities[i / 4]) * 3, 2 * blockNumbers[i]);
+		}
+		EXPECT_EQ(10, capacities[0]);
+		EXPECT_EQ(5, capacities[1]);
+
+		EXPECT_EQ(vector<number>{1}, sizeClassLogCapacities({0, 0}, 2, 4));
+	}
+
+	TEST_F(IngestTest, NoFile)
+	{
+		ASSERT_ANY_THROW(ingestDataset(file + "-missing", 1, BLOCK_SIZE, defaultSchema(1)));
+		ASSERT_ANY_THROW(ingestKeys(file + "-missing"));
+	}
+
+	string printTestName(testing::TestParamInfo<tuple<number, number, bool, bool>> input)
+	{
+		auto [orams, threads, twoAttributes, trailingNewline] = input.param;
+		return boost::str(boost::format("orams%1%threads%2%%3%%4%") % orams % threads % (twoAttributes ? "two" : "one") % (trailingNewline ? "newline" : "eof"));
+	}
+
+	INSTANTIATE_TEST_SUITE_P(IngestSuite, IngestTest, testing::Combine(testing::Values(1, 4, 7), testing::Values(1, 3, 8), testing::Bool(), testing::Bool()), printTestName);
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,116 @@
+#include "definitions.h"
+#include "logger.hpp"
+
+#include "gtest/gtest.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+
+namespace DPORAM
+{
+	class LoggerTest : public testing::Test
+	{
+		protected:
+		LoggerTest()
+		{
+			logToConsole(false);
+			collectLogLines(true);
+			__logLevel = INFO;
+		}
+	};
+
+	TEST_F(LoggerTest, FilteredNotFormatted)
+	{
+		auto formatted = false;
+		auto message   = [&formatted]() -> wstring {
+			formatted = true;
+			return L"formatted";
+		};
+
+		LOG(DEBUG, message());
+		EXPECT_FALSE(formatted);
+
+		LOG(WARNING, message());
+		EXPECT_TRUE(formatted);
+	}
+
+	TEST_F(LoggerTest, OrderPerThread)
+	{
+		const auto THREADS	= 8;
+		const auto MESSAGES = 500;
+
+		auto before = logLines().size();
+
+		vector<thread> threads;
+		for (auto t = 0; t < THREADS; t++)
+		{
+			threads.push_back(thread([t]() {
+				for (auto i = 0; i < MESSAGES; i++)
+				{
+					LOG(INFO, boost::wformat(L"thread %1% message %2%") % t % i);
+				}
+			}));
+		}
+		for (auto&& thread : threads)
+		{
+			thread.join();
+		}
+
+		auto lines = logLines();
+		ASSERT_EQ(before + THREADS * MESSAGES, lines.size());
+
+		vector<int> last(THREADS, -1);
+		for (auto i = before; i < lines.size(); i++)
+		{
+			auto position = lines[i].find("thread ");
+			ASSERT_NE(string::npos, position);
+
+			int t, message;
+			ASSERT_EQ(2, sscanf(lines[i].c_str() + position, "thread %d message %d", &t, &message));
+			EXPECT_EQ(last[t] + 1, message);
+			last[t] = message;
+		}
+	}
+
+	TEST_F(LoggerTest, ExitedThreads)
+	{
+		const auto THREADS = 100;
+
+		auto before = logLines().size();
+
+		// each thread exits right after logging, before the writer drains its buffer
+		for (auto t = 0; t < THREADS; t++)
+		{
+			thread([t]() { LOG(INFO, boost::wformat(L"short-lived thread %1%") % t); }).join();
+		}
+		LOG(INFO, L"after");
+
+		auto lines = logLines();
+		ASSERT_EQ(before + THREADS + 1, lines.size());
+		EXPECT_NE(string::npos, lines.back().find("after"));
+	}
+
+	TEST_F(LoggerTest, File)
+	{
+		auto file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("logger-%%%%-%%%%.log")).string();
+
+		logToFile(file);
+		LOG(ERROR, L"to file");
+		flushLog();
+
+		ifstream input(file);
+		string line;
+		ASSERT_TRUE(getline(input, line));
+		EXPECT_NE(string::npos, line.find("ERROR: to file"));
+
+		boost::filesystem::remove(file);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
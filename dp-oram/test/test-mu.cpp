@@ -46,6 +46,43 @@ namespace DPORAM
 		EXPECT_EQ((number)expected, actual);
 	}
 
+	TEST_P(UtilityMuTest, OptimalMu2D)
+	{
+		auto [beta, k, N, epsilon, levels, orams] = GetParam();
+
+		levels		 = min(levels, (number)(log(N) / log(k)));
+		auto levels2 = min(levels, 2uLL);
+		auto N2		 = (number)pow(k, levels2);
+
+		auto nodes = [k](number N, number levels) {
+			auto nodes	 = 0uLL;
+			auto atLevel = (number)(log(N) / log(k));
+			for (auto level = 0uLL; level <= levels; level++)
+			{
+				nodes += atLevel;
+				atLevel /= k;
+			}
+			return nodes;
+		};
+		auto total		 = nodes(N, levels) * nodes(N2, levels2) * orams;
+		auto sensitivity = levels * levels2;
+
+		auto predicate = [beta = beta, epsilon = epsilon, sensitivity, total](double mu) -> bool {
+			return pow(1 - 0.5 * exp(-(mu * epsilon) / (double)sensitivity), total) <= 1 - beta;
+		};
+
+		auto expected = 0.0;
+		while (predicate(expected))
+		{
+			expected += 1.0;
+		}
+
+		EXPECT_EQ((number)expected, optimalMu2D(beta, k, N, N2, epsilon, levels, levels2, orams));
+
+		// the product has more nodes and a higher sensitivity than the first tree alone
+		EXPECT_GE(optimalMu2D(beta, k, N, N2, epsilon, levels, levels2, orams), optimalMu(beta, k, N, epsilon, levels, orams));
+	}
+
 	vector<tuple<double, number, number, double, number, number>> cases = {
 		{0.001, 16, 1000000, 1.0, ULONG_MAX, 1},
 		{0.0001, 16, 10000000, 0.69, ULONG_MAX, 1},
@@ -0,0 +1,213 @@
+#include "definitions.h"
+#include "overlay.hpp"
+
+#include "b-plus-tree/utility.hpp"
+#include "gtest/gtest.h"
+
+using namespace std;
+
+namespace DPORAM
+{
+	class OverlayTest : public testing::Test
+	{
+		public:
+		inline static const number RECORDS	= 10;
+		inline static const number CAPACITY = 8;
+
+		protected:
+		// record i is in ORAM i % 2, block i / 2, with values i and 100 + i
+		vector<bytes> locators;
+		vector<pair<number, bytes>> index;
+		vector<number> used = {5, 5};
+
+		OverlayTest()
+		{
+			for (auto i = 0uLL; i < RECORDS; i++)
+			{
+				locators.push_back(BPlusTree::concatNumbers(2, i % 2, i / 2));
+				index.push_back({i, locators.back()});
+			}
+		}
+
+		// what the trees return for the range of the first column
+		vector<bytes> treeSearch(number from, number to)
+		{
+			vector<bytes> result;
+			for (auto i = from; i <= min(to, RECORDS - 1); i++)
+			{
+				result.push_back(locators[i]);
+			}
+			return result;
+		}
+
+		vector<pair<number, number>> search(const IndexOverlay& overlay, number attribute, number from, number to)
+		{
+			auto result = attribute == 0 ? treeSearch(from, to) : treeSearch(from - 100, to - 100);
+			overlay.search(attribute, from, to, result);
+
+			vector<pair<number, number>> found;
+			for (auto&& locator : result)
+			{
+				auto fromTree = BPlusTree::deconstructNumbers(locator);
+				found.push_back({fromTree[0], fromTree[1]});
+			}
+			sort(found.begin(), found.end());
+			return found;
+		}
+	};
+
+	TEST_F(OverlayTest, Unchanged)
+	{
+		IndexOverlay overlay(index, used, {CAPACITY, CAPACITY}, 2);
+
+		EXPECT_EQ(treeSearch(2, 5).size(), search(overlay, 0, 2, 5).size());
+		EXPECT_EQ(RECORDS, overlay.records());
+		EXPECT_EQ(5, overlay.used(0));
+		EXPECT_EQ(5, overlay.live(1));
+	}
+
+	TEST_F(OverlayTest, InsertAndDelete)
+	{
+		IndexOverlay overlay(index, used, {CAPACITY, CAPACITY}, 2);
+
+		// a new record goes to a never used block
+		auto [id, block] = overlay.insert({3, 103}, 1);
+		EXPECT_EQ(RECORDS, id);
+		EXPECT_EQ(5, block);
+		EXPECT_EQ(6, overlay.used(1));
+
+		vector<pair<number, number>> expected = {{0, 1}, {1, 1}, {1, 5}};
+		EXPECT_EQ(expected, search(overlay, 0, 2, 3));
+		EXPECT_EQ(expected, search(overlay, 1, 102, 103));
+
+		// a deleted dataset record is dropped from the tree results, and its block is reused first
+		EXPECT_EQ(make_pair(1uLL, 1uLL), overlay.remove(3));
+		expected = {{0, 1}, {1, 5}};
+		EXPECT_EQ(expected, search(overlay, 0, 2, 3));
+		EXPECT_EQ(5, overlay.live(1));
+
+		auto reused = overlay.insert({50, 150}, 1);
+		EXPECT_EQ(1, reused.second);
+		EXPECT_EQ(expected, search(overlay, 0, 2, 3));
+		expected = {{1, 1}};
+		EXPECT_EQ(expected, search(overlay, 0, 50, 50));
+
+		// a deleted inserted record leaves the overlay
+		overlay.remove(id);
+		expected = {{0, 1}};
+		EXPECT_EQ(expected, search(overlay, 0, 2, 3));
+
+		EXPECT_ANY_THROW(overlay.remove(id));
+		EXPECT_ANY_THROW(overlay.remove(RECORDS + 5));
+		EXPECT_ANY_THROW(overlay.insert({1}, 0));
+	}
+
+	TEST_F(OverlayTest, Update)
+	{
+		IndexOverlay overlay(index, used, {CAPACITY, CAPACITY}, 2);
+
+		// a record moves to the value 7 in the same ORAM, taking its own block back
+		EXPECT_EQ(make_pair(make_pair(0uLL, 1uLL), 1uLL), overlay.update(2, {7, 107}, 0));
+
+		vector<pair<number, number>> expected = {{0, 1}, {0, 2}, {0, 3}, {1, 1}, {1, 2}, {1, 3}};
+		EXPECT_EQ(expected, search(overlay, 0, 2, 7));
+		expected = {{1, 1}};
+		EXPECT_EQ(expected, search(overlay, 0, 2, 3));
+
+		overlay.remove(2);
+		EXPECT_ANY_THROW(overlay.update(2, {7, 107}, 0));
+		EXPECT_ANY_THROW(overlay.update(3, {7}, 0));
+	}
+
+	TEST_F(OverlayTest, UpdateIntoFull)
+	{
+		IndexOverlay overlay(index, used, {CAPACITY, CAPACITY}, 2);
+		for (auto i = used[0]; i < CAPACITY; i++)
+		{
+			overlay.insert({i, i}, 0);
+		}
+
+		// a record of ORAM 1 cannot move to the full ORAM 0 and stays as it was
+		EXPECT_ANY_THROW(overlay.update(3, {50, 150}, 0));
+		vector<pair<number, number>> expected = {{1, 1}};
+		EXPECT_EQ(expected, search(overlay, 0, 3, 3));
+		EXPECT_EQ(5, overlay.live(1));
+
+		// within the full ORAM a record can still move
+		EXPECT_EQ(0, overlay.update(0, {50, 150}, 0).second);
+		expected = {{0, 0}};
+		EXPECT_EQ(expected, search(overlay, 0, 50, 50));
+	}
+
+	TEST_F(OverlayTest, Full)
+	{
+		IndexOverlay overlay(index, used, {CAPACITY, CAPACITY}, 2);
+
+		for (auto i = used[0]; i < CAPACITY; i++)
+		{
+			overlay.insert({i, i}, 0);
+		}
+		EXPECT_ANY_THROW(overlay.insert({0, 0}, 0));
+		EXPECT_EQ(CAPACITY, overlay.used(0));
+
+		// a deleted record frees a block
+		overlay.remove(0);
+		EXPECT_EQ(0, overlay.insert({0, 0}, 0).second);
+	}
+
+	TEST_F(OverlayTest, ProvisionedCapacity)
+	{
+		// 2^2 buckets of 4 blocks: the 16 slots take 8 blocks, the dataset uses 5 of them
+		auto capacity = IndexOverlay::capacity(2, 4);
+		ASSERT_EQ(8, capacity);
+		IndexOverlay overlay(index, used, {capacity, capacity}, 2);
+
+		auto inserted = 0uLL;
+		while (overlay.used(1) < capacity)
+		{
+			overlay.insert({inserted, inserted}, 1);
+			inserted++;
+		}
+		EXPECT_EQ(capacity - used[1], inserted);
+		EXPECT_ANY_THROW(overlay.insert({0, 0}, 1));
+		EXPECT_EQ(capacity, overlay.live(1));
+		EXPECT_EQ(5, overlay.used(0));
+	}
+
+	TEST_F(OverlayTest, Serialize)
+	{
+		IndexOverlay overlay(index, used, {CAPACITY, CAPACITY}, 2);
+		overlay.insert({3, 103}, 1);
+		overlay.remove(4);
+		overlay.update(5, {8, 108}, 1);
+
+		auto serialized = overlay.serialize();
+		ASSERT_EQ(overlay.serializedLength(), serialized.size());
+		IndexOverlay restored(serialized.data(), serialized.size(), {CAPACITY, CAPACITY});
+
+		EXPECT_EQ(overlay.serialize(), restored.serialize());
+		EXPECT_EQ(overlay.records(), restored.records());
+		for (auto i = 0uLL; i < 2; i++)
+		{
+			EXPECT_EQ(overlay.used(i), restored.used(i));
+			EXPECT_EQ(overlay.live(i), restored.live(i));
+		}
+		for (auto&& [from, to] : vector<pair<number, number>>{{0, 9}, {3, 3}, {4, 8}})
+		{
+			EXPECT_EQ(search(overlay, 0, from, to), search(restored, 0, from, to));
+			EXPECT_EQ(search(overlay, 1, from + 100, to + 100), search(restored, 1, from + 100, to + 100));
+		}
+
+		// the free block of the deleted record is restored as well
+		EXPECT_EQ(2, restored.insert({1, 101}, 0).second);
+
+		EXPECT_ANY_THROW(IndexOverlay(serialized.data(), serialized.size() - 1, {CAPACITY, CAPACITY}));
+		EXPECT_ANY_THROW(IndexOverlay(serialized.data(), serialized.size(), {CAPACITY}));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,43 @@
+#include "definitions.h"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+namespace DPORAM
+{
+	class UtilityPercentileTest : public testing::TestWithParam<tuple<double, number>>
+	{
+	};
+
+	TEST_P(UtilityPercentileTest, NearestRank)
+	{
+		auto [p, expected] = GetParam();
+
+		// shuffled 1 ... 100
+		vector<number> values(100);
+		for (auto i = 0uLL; i < values.size(); i++)
+		{
+			values[i] = (i * 37) % 100 + 1;
+		}
+
+		EXPECT_EQ(expected, percentile(values, p));
+	}
+
+	TEST(UtilityPercentile, EdgeCases)
+	{
+		EXPECT_EQ(0, percentile({}, 50));
+		EXPECT_EQ(7, percentile({7}, 0));
+		EXPECT_EQ(7, percentile({7}, 100));
+		EXPECT_EQ(20, percentile({30, 10, 20}, 50));
+	}
+
+	INSTANTIATE_TEST_SUITE_P(UtilityPercentileSuite, UtilityPercentileTest, testing::Values(make_tuple(0.0, 1uLL), make_tuple(1.0, 1uLL), make_tuple(50.0, 50uLL), make_tuple(90.0, 90uLL), make_tuple(99.5, 100uLL), make_tuple(100.0, 100uLL)));
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,67 @@
+#include "definitions.h"
+#include "path-oram/utility.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+namespace DPORAM
+{
+	class UtilitySalaryTest : public testing::TestWithParam<string>
+	{
+		public:
+		inline static const number BLOCK_SIZE = 64;
+	};
+
+	TEST_P(UtilitySalaryTest, SameAsText)
+	{
+		auto line	= GetParam();
+		auto record = PathORAM::fromText(line, BLOCK_SIZE);
+
+		vector<string> fields;
+		boost::algorithm::split(fields, line, boost::is_any_of(","));
+
+		// a single attribute record is parsed as a whole line
+		EXPECT_EQ(salaryToNumber(line), salaryFromRecord(record));
+		for (auto i = 0uLL; i < fields.size(); i++)
+		{
+			if (fields[i].size() > 0 && (isdigit(fields[i][0]) || fields[i][0] == '-'))
+			{
+				EXPECT_EQ(salaryToNumber(fields[i]), salaryFromRecord(record, i));
+			}
+		}
+	}
+
+	TEST_P(UtilitySalaryTest, Unpadded)
+	{
+		auto line = GetParam();
+
+		EXPECT_EQ(salaryToNumber(line), salaryFromRecord(bytes(line.begin(), line.end())));
+	}
+
+	TEST_F(UtilitySalaryTest, NoField)
+	{
+		auto record = PathORAM::fromText("1.5,2.5", BLOCK_SIZE);
+
+		EXPECT_ANY_THROW(salaryFromRecord(record, 2));
+		EXPECT_ANY_THROW(salaryFromRecord(PathORAM::fromText("text", BLOCK_SIZE)));
+	}
+
+	vector<string> cases = {
+		"0",
+		"42",
+		"-199.99",
+		"123.45,-67.89",
+		"1e3,7,row-1",
+		"0.01,0.02,0.03",
+	};
+
+	INSTANTIATE_TEST_SUITE_P(UtilitySalarySuite, UtilitySalaryTest, testing::ValuesIn(cases));
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,177 @@
+#include "definitions.h"
+#include "path-oram/utility.hpp"
+#include "schema.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+namespace DPORAM
+{
+	class SchemaTest : public testing::Test
+	{
+	};
+
+	TEST_F(SchemaTest, Parse)
+	{
+		auto schema = parseSchema("salary:Decimal:indexed,name:Text,age:integer:indexed,bonus");
+
+		ASSERT_EQ(4, schema.columns.size());
+		EXPECT_EQ(vector<number>({0, 2}), schema.indexed);
+
+		EXPECT_EQ("salary", schema.columns[0].name);
+		EXPECT_EQ(Decimal, schema.columns[0].encoding);
+		EXPECT_TRUE(schema.columns[0].indexed);
+		EXPECT_EQ(Text, schema.columns[1].encoding);
+		EXPECT_FALSE(schema.columns[1].indexed);
+		EXPECT_EQ(Integer, schema.columns[2].encoding);
+		EXPECT_EQ(Decimal, schema.columns[3].encoding);
+		EXPECT_FALSE(schema.columns[3].indexed);
+
+		EXPECT_EQ(2, columnPosition(schema, "age"));
+		ASSERT_ANY_THROW(columnPosition(schema, "missing"));
+	}
+
+	TEST_F(SchemaTest, Malformed)
+	{
+		for (auto&& description : {"", "a", "a:Float:indexed", "a:Decimal:sorted", "a:Text:indexed", "a:Decimal:indexed,a", "a:Decimal:indexed,,b", "a:Decimal:indexed:x"})
+		{
+			ASSERT_ANY_THROW(parseSchema(description)) << description;
+		}
+	}
+
+	TEST_F(SchemaTest, Default)
+	{
+		auto schema = defaultSchema(3);
+
+		ASSERT_EQ(3, schema.columns.size());
+		EXPECT_EQ(vector<number>({0, 1, 2}), schema.indexed);
+		for (auto&& column : schema.columns)
+		{
+			EXPECT_EQ(Decimal, column.encoding);
+		}
+	}
+
+	TEST_F(SchemaTest, Encode)
+	{
+		for (auto&& text : {"0", "12.34", "-200", "99999.99", "5,rest"})
+		{
+			EXPECT_EQ(salaryToNumber(text), encodeValue(text, Decimal)) << text;
+		}
+
+		EXPECT_EQ(OFFSET + 42, encodeValue("42", Integer));
+		EXPECT_EQ(OFFSET - 7, encodeValue("-7", Integer));
+		EXPECT_LT(encodeValue("-7", Integer), encodeValue("3", Integer));
+
+		ASSERT_ANY_THROW(encodeValue("x", Decimal));
+		ASSERT_ANY_THROW(encodeValue("", Integer));
+		ASSERT_ANY_THROW(encodeValue("1", Text));
+		ASSERT_ANY_THROW(encodeValue(to_string(-2 * OFFSET), Integer));
+
+		EXPECT_EQ(100, encodingScale(Decimal));
+		EXPECT_EQ(1, encodingScale(Integer));
+	}
+
+	TEST_F(SchemaTest, Conditions)
+	{
+		auto record = PathORAM::fromText("1500.50,-3,name", 64);
+
+		EXPECT_EQ(salaryToNumber("1500.50"), valueFromRecord(record, 0, Decimal));
+		EXPECT_EQ(encodeValue("-3", Integer), valueFromRecord(record, 1, Integer));
+
+		vector<rangeCondition> conditions = {{0, Decimal, salaryToNumber("1000"), salaryToNumber("2000")}};
+		EXPECT_TRUE(matchesConditions(record, conditions));
+
+		conditions.push_back({1, Integer, encodeValue("-3", Integer), encodeValue("10", Integer)});
+		EXPECT_TRUE(matchesConditions(record, conditions));
+
+		conditions.push_back({1, Integer, encodeValue("0", Integer), encodeValue("10", Integer)});
+		EXPECT_FALSE(matchesConditions(record, conditions));
+
+		EXPECT_TRUE(matchesConditions(record, {}));
+
+		// past 2^53 a double cannot tell neighbouring integers apart
+		auto large = PathORAM::fromText("1,9007199254740993", 64);
+		EXPECT_EQ(encodeValue("9007199254740993", Integer), valueFromRecord(large, 1, Integer));
+		EXPECT_TRUE(matchesConditions(large, {{1, Integer, encodeValue("9007199254740993", Integer), encodeValue("9007199254740993", Integer)}}));
+	}
+
+	TEST_F(SchemaTest, NextRecord)
+	{
+		auto block = PathORAM::fromText("1,a\n2,b\n\n3,c", 64);
+
+		vector<string> records;
+		bytes record;
+		for (auto position = 0uLL; nextRecord(block, position, record);)
+		{
+			records.push_back(string(record.begin(), record.end()));
+		}
+		EXPECT_EQ(vector<string>({"1,a", "2,b", "", "3,c"}), records);
+
+		// a single record block
+		auto position = 0uLL;
+		ASSERT_TRUE(nextRecord(PathORAM::fromText("1500.50,x", 64), position, record));
+		EXPECT_EQ("1500.50,x", string(record.begin(), record.end()));
+		EXPECT_FALSE(nextRecord(PathORAM::fromText("1500.50,x", 64), position, record));
+	}
+
+	TEST_F(SchemaTest, Aggregate)
+	{
+		auto first = emptyAggregate(), second = emptyAggregate();
+		EXPECT_EQ(0, aggregateValue(first, AMin, Decimal));
+		EXPECT_EQ(0, aggregateValue(first, AAvg, Decimal));
+
+		aggregateRecord(first, PathORAM::fromText("10.50,-3,name", 64), 0, Decimal);
+		aggregateRecord(first, PathORAM::fromText("-2.25,7,name", 64), 0, Decimal);
+		aggregateRecord(second, PathORAM::fromText("4,1,name", 64), 0, Decimal);
+		mergeAggregates(first, second);
+
+		EXPECT_EQ(3, aggregateValue(first, ACount, Decimal));
+		EXPECT_NEAR(12.25, aggregateValue(first, ASum, Decimal), 1e-9);
+		EXPECT_NEAR(-2.25, aggregateValue(first, AMin, Decimal), 1e-9);
+		EXPECT_NEAR(10.50, aggregateValue(first, AMax, Decimal), 1e-9);
+		EXPECT_NEAR(12.25 / 3, aggregateValue(first, AAvg, Decimal), 1e-9);
+
+		// integers are in units, text is only counted
+		auto integers = emptyAggregate(), text = emptyAggregate();
+		for (auto&& line : {"0,-3,name", "0,7,name"})
+		{
+			aggregateRecord(integers, PathORAM::fromText(line, 64), 1, Integer);
+			aggregateRecord(text, PathORAM::fromText(line, 64), 2, Text);
+		}
+		EXPECT_EQ(4, aggregateValue(integers, ASum, Integer));
+		EXPECT_EQ(-3, aggregateValue(integers, AMin, Integer));
+		EXPECT_EQ(2, aggregateValue(text, ACount, Text));
+		EXPECT_EQ(0, aggregateValue(text, ASum, Text));
+
+		ASSERT_ANY_THROW(aggregateValue(first, ANone, Decimal));
+	}
+
+	TEST_F(SchemaTest, Projection)
+	{
+		vector<projectedColumn> columns = {{2, Text}, {0, Decimal}, {1, Integer}};
+		auto projection					= emptyProjection(columns);
+		EXPECT_EQ(0, projectedRows(projection));
+
+		projectRecord(projection, PathORAM::fromText("10.50,-3,first,rest", 64), columns);
+		projectRecord(projection, PathORAM::fromText("4,7,second", 64), columns);
+
+		ASSERT_EQ(2, projectedRows(projection));
+		ASSERT_EQ(2, projection.first.size());
+		ASSERT_EQ(1, projection.second.size());
+
+		EXPECT_EQ(vector<number>({salaryToNumber("10.50"), salaryToNumber("4")}), projection.first[0]);
+		EXPECT_EQ(vector<number>({encodeValue("-3", Integer), encodeValue("7", Integer)}), projection.first[1]);
+		EXPECT_EQ(vector<string>({"first", "second"}), projection.second[0]);
+
+		EXPECT_EQ("", textFromRecord(PathORAM::fromText("1,,x", 64), 1));
+		ASSERT_ANY_THROW(textFromRecord(PathORAM::fromText("1,2", 64), 3));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,263 @@
+#include "definitions.h"
+#include "snapshot.hpp"
+
+#include "gtest/gtest.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+using namespace std;
+
+namespace DPORAM
+{
+	class SnapshotTest : public testing::Test
+	{
+		public:
+		inline static const number BLOCK_SIZE = 64;
+		inline static const number CAPACITY	  = 1000;
+
+		protected:
+		string file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("snapshot-%%%%-%%%%.bin")).string();
+
+		~SnapshotTest() override
+		{
+			boost::filesystem::remove(file);
+			boost::filesystem::remove(file + ".tmp");
+		}
+	};
+
+	TEST_F(SnapshotTest, Sections)
+	{
+		vector<number> statistics = {5, 10, 15};
+		bytes key				  = {1, 2, 3, 4, 5};
+
+		SnapshotWriter writer(42);
+		writer.add(SnapshotStatistics, 0, statistics);
+		writer.add(SnapshotKey, 3, key);
+		writer.add(SnapshotQueries, 0, vector<number>());
+		writer.write(file);
+
+		Snapshot snapshot(file);
+		EXPECT_EQ(42, snapshot.fingerprint());
+		EXPECT_EQ(statistics, snapshot.values<number>(SnapshotStatistics));
+		EXPECT_EQ(key, snapshot.values<uchar>(SnapshotKey, 3));
+		EXPECT_TRUE(snapshot.has(SnapshotQueries));
+		EXPECT_EQ(0, snapshot.values<number>(SnapshotQueries).size());
+
+		EXPECT_FALSE(snapshot.has(SnapshotKey, 0));
+		EXPECT_ANY_THROW(snapshot.section(SnapshotKey, 0));
+	}
+
+	TEST_F(SnapshotTest, PositionMapCopyOnWrite)
+	{
+		auto original = make_shared<SnapshotPositionMapAdapter>(CAPACITY);
+		for (auto i = 0uLL; i < CAPACITY; i++)
+		{
+			original->set(i, i * 7);
+		}
+
+		SnapshotWriter writer(0);
+		writer.add(SnapshotPositionMap, 1, CAPACITY * sizeof(number), [original](uchar* destination) {
+			memcpy(destination, original->data(), CAPACITY * sizeof(number));
+		});
+		writer.write(file);
+
+		{
+			auto snapshot = make_shared<Snapshot>(file);
+			SnapshotPositionMapAdapter map(snapshot, 1, CAPACITY);
+			for (auto i = 0uLL; i < CAPACITY; i++)
+			{
+				ASSERT_EQ(i * 7, map.get(i));
+			}
+			map.set(5, 0);
+			EXPECT_EQ(0, map.get(5));
+
+			EXPECT_ANY_THROW(SnapshotPositionMapAdapter(snapshot, 1, CAPACITY + 1));
+			EXPECT_ANY_THROW(SnapshotPositionMapAdapter(snapshot, 2, CAPACITY));
+		}
+
+		// the file is not modified through the mapping
+		auto snapshot = make_shared<Snapshot>(file);
+		SnapshotPositionMapAdapter map(snapshot, 1, CAPACITY);
+		EXPECT_EQ(35, map.get(5));
+	}
+
+	TEST_F(SnapshotTest, Stash)
+	{
+		auto stash = make_shared<PathORAM::InMemoryStashAdapter>(10);
+		stash->add(3, bytes(BLOCK_SIZE, 0x03));
+		stash->add(17, bytes(BLOCK_SIZE, 0x11));
+
+		SnapshotWriter writer(0);
+		writer.add(SnapshotStash, 0, stashToSection(stash, BLOCK_SIZE));
+		writer.write(file);
+
+		Snapshot snapshot(file);
+		auto restored = make_shared<PathORAM::InMemoryStashAdapter>(10);
+		stashFromSection(restored, snapshot, 0, BLOCK_SIZE);
+
+		vector<PathORAM::block> expected, actual;
+		stash->getAll(expected);
+		restored->getAll(actual);
+		sort(expected.begin(), expected.end());
+		sort(actual.begin(), actual.end());
+		EXPECT_EQ(expected, actual);
+
+		EXPECT_ANY_THROW(stashFromSection(restored, snapshot, 0, BLOCK_SIZE + 1));
+	}
+
+	TEST_F(SnapshotTest, Rewrite)
+	{
+		SnapshotWriter first(1);
+		first.add(SnapshotStatistics, 0, vector<number>{1});
+		first.write(file);
+
+		auto mapped = make_shared<Snapshot>(file);
+
+		SnapshotWriter second(2);
+		second.add(SnapshotStatistics, 0, vector<number>{2});
+		second.write(file);
+
+		// the old mapping stays valid, the file is replaced as a whole
+		EXPECT_EQ(vector<number>{1}, mapped->values<number>(SnapshotStatistics));
+		EXPECT_EQ(vector<number>{2}, Snapshot(file).values<number>(SnapshotStatistics));
+		EXPECT_FALSE(boost::filesystem::exists(file + ".tmp"));
+	}
+
+	TEST_F(SnapshotTest, RelativePath)
+	{
+		// a path without a directory is synced in the working directory
+		auto relative = boost::filesystem::unique_path("snapshot-%%%%-%%%%.bin").string();
+
+		SnapshotWriter writer(5);
+		writer.add(SnapshotStatistics, 0, vector<number>{1});
+		EXPECT_NO_THROW(writer.write(relative));
+		EXPECT_EQ(5, Snapshot(relative).fingerprint());
+
+		boost::filesystem::remove(relative);
+	}
+
+	TEST_F(SnapshotTest, RemovedSection)
+	{
+		SnapshotWriter writer(0);
+		writer.add(SnapshotNoise, 0, vector<number>{1, 2, 3});
+		writer.add(SnapshotNoise, 1, vector<number>{4, 5, 6});
+		writer.remove(SnapshotNoise, 1);
+		writer.remove(SnapshotNoise, 2);
+		writer.write(file);
+
+		Snapshot snapshot(file);
+		EXPECT_TRUE(snapshot.has(SnapshotNoise, 0));
+		EXPECT_FALSE(snapshot.has(SnapshotNoise, 1));
+	}
+
+	TEST_F(SnapshotTest, ManySectionsParallel)
+	{
+		const auto SECTIONS = 300uLL;
+
+		SnapshotWriter writer(7);
+		for (auto i = 0uLL; i < SECTIONS; i++)
+		{
+			// fixed and produced sections of varying lengths
+			if (i % 2 == 0)
+			{
+				writer.add(SnapshotPositionMap, i, vector<number>(i * 13, i));
+			}
+			else
+			{
+				writer.add(SnapshotStash, i, [i]() { return bytes(i * 101, (uchar)i); });
+			}
+		}
+		writer.write(file, 8);
+
+		Snapshot snapshot(file);
+		EXPECT_NO_THROW(snapshot.verify(8));
+		for (auto i = 0uLL; i < SECTIONS; i++)
+		{
+			if (i % 2 == 0)
+			{
+				ASSERT_EQ(vector<number>(i * 13, i), snapshot.values<number>(SnapshotPositionMap, i));
+			}
+			else
+			{
+				ASSERT_EQ(bytes(i * 101, (uchar)i), snapshot.values<uchar>(SnapshotStash, i));
+			}
+		}
+	}
+
+	TEST_F(SnapshotTest, Corrupted)
+	{
+		SnapshotWriter writer(0);
+		writer.add(SnapshotStatistics, 0, vector<number>{1, 2, 3});
+		writer.add(SnapshotQueries, 0, vector<number>(1000, 5));
+		writer.write(file);
+
+		EXPECT_NO_THROW(Snapshot(file).verify());
+
+		// flip one byte of the second section (the header and the table take one page)
+		{
+			fstream output(file, ios::in | ios::out | ios::binary);
+			output.seekp(4096 * 2 + 100);
+			output.put(0x7F);
+		}
+
+		Snapshot snapshot(file);
+		EXPECT_ANY_THROW(snapshot.verify());
+		EXPECT_ANY_THROW(snapshot.verify(1));
+	}
+
+	TEST_F(SnapshotTest, FailedFill)
+	{
+		SnapshotWriter writer(0);
+		writer.add(SnapshotStatistics, 0, 8, [](uchar*) { throw Exception("cannot fill"); });
+
+		EXPECT_ANY_THROW(writer.write(file));
+		EXPECT_FALSE(boost::filesystem::exists(file));
+		EXPECT_FALSE(boost::filesystem::exists(file + ".tmp"));
+	}
+
+	TEST_F(SnapshotTest, FailedRename)
+	{
+		// a file cannot be renamed over a directory
+		boost::filesystem::create_directory(file);
+		ofstream((boost::filesystem::path(file) / "inside").string()) << "x";
+
+		SnapshotWriter writer(0);
+		writer.add(SnapshotStatistics, 0, vector<number>{1});
+
+		EXPECT_ANY_THROW(writer.write(file));
+		EXPECT_FALSE(boost::filesystem::exists(file + ".tmp"));
+
+		boost::filesystem::remove_all(file);
+	}
+
+	TEST_F(SnapshotTest, Invalid)
+	{
+		EXPECT_ANY_THROW(Snapshot(file + "-missing"));
+
+		{
+			ofstream output(file);
+			output << "not a snapshot, but long enough to have a header";
+		}
+		EXPECT_ANY_THROW(Snapshot snapshot(file));
+
+		SnapshotWriter writer(0);
+		writer.add(SnapshotStatistics, 0, vector<number>(1000));
+		writer.write(file);
+		boost::filesystem::resize_file(file, 4096 + 100);
+		EXPECT_ANY_THROW(Snapshot snapshot(file));
+	}
+
+	TEST(SnapshotFingerprint, Fingerprint)
+	{
+		EXPECT_EQ(fingerprint({"a", "b"}), fingerprint({"a", "b"}));
+		EXPECT_NE(fingerprint({"a", "b"}), fingerprint({"b", "a"}));
+		// parts are separated
+		EXPECT_NE(fingerprint({"ab", ""}), fingerprint({"a", "b"}));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,166 @@
+#include "definitions.h"
+#include "tuner.hpp"
+#include "utility.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+namespace DPORAM
+{
+	class TunerTest : public testing::Test
+	{
+		public:
+		inline static const number COUNT = 10000;
+
+		protected:
+		vector<number> values;
+		vector<pair<number, number>> queries;
+
+		tuningSpace space;
+		hardwareProfile hardware;
+
+		TunerTest()
+		{
+			// one record per dollar, queries of 1% of the domain
+			for (auto i = 0uLL; i < COUNT; i++)
+			{
+				values.push_back(salaryToNumber(to_string(i)));
+			}
+			for (auto i = 0uLL; i < 20; i++)
+			{
+				auto from = salaryToNumber(to_string(i * 450 + 17));
+				queries.push_back({from, from + salaryToNumber("100") - salaryToNumber("0")});
+			}
+
+			hardware.roundTrip = 100'000;
+			hardware.bandwidth = 1e8;
+			hardware.byteCost  = 1;
+		}
+	};
+
+	TEST_F(TunerTest, PathBuckets)
+	{
+		// a single path, or the whole tree
+		EXPECT_NEAR(10, pathBuckets(1, 10, true), 1e-9);
+		EXPECT_NEAR(1023, pathBuckets(1'000'000, 10, true), 1e-6);
+		EXPECT_EQ(0, pathBuckets(0, 10, true));
+
+		// batches share the top of the tree
+		EXPECT_LT(pathBuckets(100, 10, true), pathBuckets(100, 10, false));
+		EXPECT_EQ(1000, pathBuckets(100, 10, false));
+	}
+
+	TEST_F(TunerTest, PredictCost)
+	{
+		hardware.parallelism = 2;
+		auto cost			 = predictCost({10, 0, 10, 0}, 10, 3, 256, false, hardware);
+
+		// the first worker serves two ORAMs of 10 records, each read and written back path by path
+		auto bytes = 2 * 10 * 10 * 3 * (256 + 32.0);
+		EXPECT_NEAR(2 * bytes, cost.bytes, 1e-6);
+		EXPECT_NEAR(2 * (2 * 10 * hardware.roundTrip + bytes * (1e9 / hardware.bandwidth + hardware.byteCost)), cost.latency, 1e-3);
+
+		// batched requests are fewer and smaller
+		auto batched = predictCost({10, 0, 10, 0}, 10, 3, 256, true, hardware);
+		EXPECT_LT(batched.bytes, cost.bytes);
+		EXPECT_LT(batched.latency, cost.latency);
+	}
+
+	TEST_F(TunerTest, FetchesAtLeastReal)
+	{
+		for (auto&& gamma : {true, false})
+		{
+			space.gamma = gamma;
+			auto result = estimate(values, queries, 4, 4, 1024, 256, space, hardware);
+
+			ASSERT_GT(result.levels, 0);
+			EXPECT_GE(result.real, 100);
+			EXPECT_GT(result.records, result.real);
+			EXPECT_GT(result.mu, 0);
+			EXPECT_GT(result.bytes, 0);
+			EXPECT_GT(result.latency, 0);
+		}
+	}
+
+	TEST_F(TunerTest, LevelsFitQueries)
+	{
+		auto result = estimate(values, queries, 1, 2, 8192, 256, space, hardware);
+		ASSERT_GT(result.levels, 0);
+
+		for (auto&& query : queries)
+		{
+			auto [fromBucket, toBucket, from, to] = padToBuckets(query, values.front(), values.back(), 8192);
+			for (auto&& node : BRC(2, fromBucket, toBucket))
+			{
+				EXPECT_LT(node.first, result.levels);
+			}
+		}
+
+		// a query over the whole domain needs the root, which main does not keep
+		EXPECT_EQ(0, estimate(values, {{values.front(), values.back()}}, 1, 2, 8192, 256, space, hardware).levels);
+	}
+
+	TEST_F(TunerTest, LevelsUpToExactPower)
+	{
+		// a tenth of the domain is one node two levels above the leaves, and 1000 is exactly 10^3
+		vector<pair<number, number>> tenth	  = {{values.front(), values[COUNT / 10 - 2]}};
+		auto [fromBucket, toBucket, from, to] = padToBuckets(tenth[0], values.front(), values.back(), 1000);
+		ASSERT_EQ((vector<pair<number, number>>{{2, 0}}), BRC(10, fromBucket, toBucket));
+
+		EXPECT_EQ(3, estimate(values, tenth, 1, 10, 1000, 256, space, hardware).levels);
+	}
+
+	TEST_F(TunerTest, BlockSizeOnlyAffectsBytes)
+	{
+		auto small = estimate(values, queries, 4, 4, 1024, 256, space, hardware);
+		auto large = estimate(values, queries, 4, 4, 1024, 4096, space, hardware);
+
+		EXPECT_EQ(small.records, large.records);
+		EXPECT_LT(small.bytes, large.bytes);
+		EXPECT_LT(small.latency, large.latency);
+	}
+
+	TEST_F(TunerTest, ParallelismHelpsManyOrams)
+	{
+		hardware.parallelism = 1;
+		auto sequential		 = estimate(values, queries, 16, 4, 1024, 256, space, hardware);
+		hardware.parallelism = 16;
+		auto parallel		 = estimate(values, queries, 16, 4, 1024, 256, space, hardware);
+
+		EXPECT_EQ(sequential.records, parallel.records);
+		EXPECT_NEAR(sequential.latency, parallel.latency * 16, sequential.latency * 1e-9);
+	}
+
+	TEST_F(TunerTest, RankedByObjective)
+	{
+		for (auto&& objective : {Latency, Bandwidth})
+		{
+			space.objective = objective;
+			auto results	= tune(values, queries, 300, space, hardware);
+			ASSERT_GT(results.size(), 0);
+
+			for (auto i = 0uLL; i < results.size(); i++)
+			{
+				EXPECT_GT(results[i].blockSize, 300);
+				EXPECT_GT(results[i].levels, 0);
+				if (i > 0)
+				{
+					EXPECT_LE(objective == Latency ? results[i - 1].latency : results[i - 1].bytes, objective == Latency ? results[i].latency : results[i].bytes);
+				}
+			}
+		}
+	}
+
+	TEST_F(TunerTest, Empty)
+	{
+		EXPECT_EQ(0, tune({}, queries, 0, space, hardware).size());
+		EXPECT_EQ(0, estimate(values, {}, 1, 2, 1024, 256, space, hardware).levels);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
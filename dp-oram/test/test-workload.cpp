@@ -0,0 +1,149 @@
+#include "definitions.h"
+#include "utility.hpp"
+#include "workload.hpp"
+
+#include "gtest/gtest.h"
+#include <numeric>
+#include <random>
+
+using namespace std;
+
+namespace DPORAM
+{
+	class WorkloadTest : public testing::TestWithParam<number>
+	{
+		public:
+		inline static const number COUNT = 10000;
+
+		protected:
+		vector<number> keys;
+		vector<pair<number, number>> queries;
+
+		WorkloadTest()
+		{
+			mt19937_64 generator(1305);
+			uniform_int_distribution<number> value(1000, 50000);
+
+			for (auto i = 0uLL; i < COUNT; i++)
+			{
+				keys.push_back(value(generator));
+			}
+			for (auto i = 0uLL; i < 500; i++)
+			{
+				auto from = value(generator);
+				queries.push_back({from, from + value(generator) / 10});
+			}
+
+			// outside the keys, around them and reversed
+			queries.push_back({0, 500});
+			queries.push_back({0, 100000});
+			queries.push_back({2000, 1000});
+		}
+	};
+
+	TEST_P(WorkloadTest, Sort)
+	{
+		auto expected = keys;
+		sort(expected.begin(), expected.end());
+
+		parallelSort(keys, GetParam());
+
+		EXPECT_EQ(expected, keys);
+	}
+
+	TEST_P(WorkloadTest, SortSmall)
+	{
+		for (auto size : {0uLL, 1uLL, 2uLL, 5uLL})
+		{
+			vector<number> small(keys.begin(), keys.begin() + size);
+			auto expected = small;
+			sort(expected.begin(), expected.end());
+
+			parallelSort(small, GetParam());
+
+			EXPECT_EQ(expected, small);
+		}
+	}
+
+	TEST_P(WorkloadTest, RangeCounts)
+	{
+		parallelSort(keys, GetParam());
+		auto counts = rangeCounts(keys, queries, GetParam());
+
+		ASSERT_EQ(queries.size(), counts.size());
+		for (auto i = 0uLL; i < queries.size(); i++)
+		{
+			auto expected = count_if(keys.begin(), keys.end(), [&](number key) { return key >= queries[i].first && key <= queries[i].second; });
+			EXPECT_EQ(expected, counts[i]);
+		}
+	}
+
+	TEST_P(WorkloadTest, Histograms)
+	{
+		const auto buckets = 64uLL;
+
+		parallelSort(keys, GetParam());
+		auto result = histograms(keys, queries, buckets, GetParam());
+
+		ASSERT_EQ(buckets, result.records.size());
+		ASSERT_EQ(buckets, result.queries.size());
+		ASSERT_EQ(buckets + 1, result.spans.size());
+
+		EXPECT_EQ(COUNT, accumulate(result.records.begin(), result.records.end(), 0uLL));
+		EXPECT_EQ(queries.size(), accumulate(result.spans.begin(), result.spans.end(), 0uLL));
+		EXPECT_EQ(2, result.spans[0]);
+		EXPECT_GE(result.spans[buckets], 1);
+
+		// the same as padding every query and key on its own
+		vector<number> records(buckets, 0), overlapping(buckets, 0);
+		for (auto&& key : keys)
+		{
+			records[get<0>(padToBuckets({key, key}, keys.front(), keys.back(), buckets))]++;
+		}
+		auto spans = 0uLL;
+		for (auto&& [left, right] : queries)
+		{
+			if (left > right || right < keys.front() || left > keys.back())
+			{
+				continue;
+			}
+			auto [fromBucket, toBucket, from, to] = padToBuckets({max(left, keys.front()), min(right, keys.back())}, keys.front(), keys.back(), buckets);
+			for (auto b = fromBucket; b <= toBucket; b++)
+			{
+				overlapping[b]++;
+			}
+			spans += toBucket - fromBucket + 1;
+		}
+		EXPECT_EQ(records, result.records);
+		EXPECT_EQ(overlapping, result.queries);
+		EXPECT_EQ(spans, accumulate(result.queries.begin(), result.queries.end(), 0uLL));
+	}
+
+	TEST_F(WorkloadTest, Empty)
+	{
+		EXPECT_EQ(vector<number>(queries.size(), 0), rangeCounts({}, queries));
+		EXPECT_EQ(0, rangeCounts(keys, {}).size());
+
+		auto result = histograms({}, queries, 8);
+		EXPECT_EQ(queries.size(), result.spans[0]);
+		EXPECT_EQ(vector<number>(8, 0), result.records);
+
+		// a single distinct key falls into the first bucket
+		result = histograms({7, 7, 7}, {{7, 7}}, 8);
+		EXPECT_EQ(3, result.records[0]);
+		EXPECT_EQ(1, result.spans[1]);
+	}
+
+	string printTestName(testing::TestParamInfo<number> input)
+	{
+		return boost::str(boost::format("threads%1%") % input.param);
+	}
+
+	INSTANTIATE_TEST_SUITE_P(WorkloadSuite, WorkloadTest, testing::Values(1, 3, 8), printTestName);
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}